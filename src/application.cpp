@@ -10,34 +10,32 @@
 #include "imgui/backends/imgui_impl_vulkan.h"
 #include <future>
 #include <array>
+#include <algorithm>
 #include <chrono>
+#include <thread>
+#include <filesystem>
 #include "defines.h"
+#include "physics/fmmSolver.h"
+#include "physics/diagnostics.h"
+#include "physics/checkpoint.h"
+#include "physics/stateFile.h"
+#include "physics/generators.h"
 
 std::unordered_map<std::string, const char*> map;
 static const char* Skyboxes[] = { "Milky Way", "Nebula", "Stars", "Red Galaxy"};// I tried to make this map but imgui only works with c-string array
 static int skyboxImageSelected = SkyboxTextureImage::Stars;
-
-static double realTime = 0;
-
-static double DELTA = 300.0;
-
-class Timer
-{
-public:
-    std::chrono::time_point<std::chrono::high_resolution_clock> m_Start, m_End;
-
-    Timer()
-    {
-        m_Start = std::chrono::high_resolution_clock::now();
-    }
-
-    ~Timer()
-    {
-        m_End = std::chrono::high_resolution_clock::now();
-        double duration = (m_End - m_Start).count() / 1000.0;
-        std::cout << "Timer Took " << duration << "ms" << std::endl;
-    }
-};
+static const char* Integrators[] = { "Semi-implicit Euler", "Leapfrog", "Yoshida 4", "Yoshida 6", "Hermite (block steps)", "Wisdom-Holman", "IAS15", "Patched Conics" };
+static const char* Solvers[] = { "Direct", "Barnes-Hut", "Fast Multipole" };
+
+#define WARP_FRAME_SLEEP 50 // ms, progress bar doesn't need 60 fps and the simulation wants every core
+#define CHECKPOINT_FILE "checkpoint.bin"
+#define CHECKPOINT_KEEP 3 // rotated autosaves, older ones are checkpoint.bin.1, checkpoint.bin.2
+#define TRAJECTORY_FILE "trajectory.bin"
+#define EPHEMERIS_FILE "trajectory.eph" // fit of the recording, rebuilt when the recording is newer
+#define EPHEMERIS_IMPORT_FILE "ephemeris.txt"
+#define EPHEMERIS_SPAN (4.0 * 86400.0) // seconds per segment of imported tables, recordings pick their own
+#define SCENARIO_FILE "../assets/scenarios/solarSystem.txt"
+#define DIRECT_SUM_BODY_LIMIT 2000 // larger scenarios start on the fast multipole solver
 
 static void CheckVkResult(VkResult err)
 {
@@ -65,7 +63,9 @@ Application::Application()
         .AddPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
         .Build();
     
+    m_Settings = m_Simulation.GetSettings();
     LoadGameObjects();
+    ResumeCheckpoint();
     m_Skybox = std::make_unique<Skybox>(m_Device, skyboxImageSelected);
 }
 
@@ -155,6 +155,13 @@ void Application::Run()
     
     auto lastUpdate = std::chrono::high_resolution_clock::now();
 
+    // from here on the simulation belongs to its thread, everything below reads snapshots
+    m_SimulationThread.SetSettings(m_Settings, m_Pacing);
+    m_SentSettings = m_Settings;
+    m_SentPacing = m_Pacing;
+    m_SimulationThread.Start();
+    m_CheckpointWriter.Start(CHECKPOINT_FILE, CHECKPOINT_KEEP);
+
     m_Descriptor = ImGui_ImplVulkan_AddTexture(m_Sampler.GetSampler(), m_Renderer->GetGeometryFramebufferImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	// Main Loop
     while(!m_Window.ShouldClose())
@@ -181,16 +188,27 @@ void Application::Run()
 		// Delta Time
         auto now = std::chrono::high_resolution_clock::now();
         float delta = std::chrono::duration<float, std::chrono::seconds::period>(now - lastUpdate).count();
-        if (m_Pause)
+        lastUpdate = now;
+        m_FPSaccumulator += delta;
+        m_AutosaveAccumulator += delta;
+        if (m_AutosaveMinutes > 0.0f && m_AutosaveAccumulator >= m_AutosaveMinutes * 60.0f)
         {
-            lastUpdate = std::chrono::high_resolution_clock::now();
+            m_AutosaveAccumulator = 0.0f;
+            RequestCheckpoint();
         }
-        if (!m_Pause)
+
+        // every push wakes the thread, a paused one would otherwise spin at frame rate
+        if (m_Settings != m_SentSettings || m_Pacing != m_SentPacing)
         {
-            lastUpdate = now;
-            m_MainLoopAccumulator += delta;
+            m_SimulationThread.SetSettings(m_Settings, m_Pacing);
+            m_SentSettings = m_Settings;
+            m_SentPacing = m_Pacing;
         }
-        m_FPSaccumulator += delta;
+        m_SimulationThread.AcquireSnapshot();
+        const SimulationSnapshot& snapshot = m_SimulationThread.GetSnapshot();
+        bool warping = m_SimulationThread.IsWarping();
+        if (warping)
+            std::this_thread::sleep_for(std::chrono::milliseconds(WARP_FRAME_SLEEP));
 
 		// Frame Begin
         if (auto commandBuffer = m_Renderer->BeginFrame())
@@ -202,20 +220,31 @@ void Application::Run()
             frameInfo.frameTime = delta;
             frameInfo.commandBuffer = commandBuffer;
             frameInfo.globalDescriptorSet = globalDescriptorSets[frameIndex];
-            frameInfo.gameObjects = m_GameObjects;
+            frameInfo.bodies = &snapshot.bodies;
+            frameInfo.gameObjects = &m_GameObjects;
 
-			// Update Every 160ms(every frame with 60fps) independent of actual framerate
-            while (m_MainLoopAccumulator > 0.016f && !m_Pause)
+            ProcessSimulationEvents(commandBuffer);
+            bool replaying = !m_Ephemeris.IsEmpty();
+            if (replaying)
             {
-                Update(frameInfo, DELTA); // making delta value larger will speed up simulation while loosing its accuracy but I guess making it 0.016 and waiting 10 thousand days for some orbit to complete is not good idea so we have to do that
-				m_MainLoopAccumulator -= 0.016f;
+                UpdateReplay(commandBuffer, delta);
+                frameInfo.bodies = &m_ReplayBodies;
             }
-            frameInfo.offset = m_GameObjects[m_TargetLock]->GetObjectTransform().translation;
-            
+
+            // tables may not cover the current time and a scenario can hold only particles, nothing to lock on then
+            const BodyStore& bodies = *frameInfo.bodies;
+            frameInfo.offset = glm::dvec3(0.0);
+            if (bodies.GetCount() > 0)
+            {
+                if (!bodies.IsValid(m_TargetLock))
+                    m_TargetLock = bodies.GetHandle(0);
+                frameInfo.offset = bodies.GetPositions()[bodies.GetIndex(m_TargetLock)];
+            }
+
 			// Camera Update
             float aspectRatio = m_ViewportPanelSize.x / m_ViewportPanelSize.y;
             m_Camera.SetPerspectiveProjection(glm::radians(50.0f), aspectRatio, 0.000001f, 1000.0f);
-            m_CameraController.Update(0.016f, m_Camera, m_TargetLock, m_GameObjects, m_IsViewportHovered);
+            m_CameraController.Update(0.016f, m_Camera, m_TargetLock, bodies, m_IsViewportHovered);
             m_Camera.SetViewTarget({0.0, 0.0, 0.0});
             
             // UBO update
@@ -224,11 +253,13 @@ void Application::Run()
                 ubo.projection = m_Camera.GetProjection();
                 ubo.view = m_Camera.GetView();
                 
-                for (auto& kv : m_GameObjects)
+                auto& positions = bodies.GetPositions();
+                for (uint32_t i = 0; i < bodies.GetCount(); i++)
                 {
-                    if (kv.second->GetObjectType() == OBJ_TYPE_STAR)
+                    auto iter = m_GameObjects.find(bodies.GetHandle(i).index);
+                    if (iter != m_GameObjects.end() && iter->second->GetObjectType() == OBJ_TYPE_STAR)
                     {
-                        ubo.lightPosition = glm::vec4(kv.second->GetObjectTransform().translation/SCALE_DOWN - glm::dvec3(frameInfo.offset/SCALE_DOWN), 1.0);
+                        ubo.lightPosition = glm::vec4(positions[i]/SCALE_DOWN - glm::dvec3(frameInfo.offset/SCALE_DOWN), 1.0);
                     }
                 }
                 m_UboBuffers[frameIndex]->WriteToBuffer(&ubo);
@@ -238,11 +269,21 @@ void Application::Run()
 
             // ------------------- GEOMETRY RENDER PASS -----------------
             m_Renderer->BeginGeometryRenderPass(commandBuffer, {0.0f, 0.0f, 0.0f});
-            #ifndef FAST_LOAD
-                m_Renderer->RenderSkybox(frameInfo, *m_Skybox, m_SkyboxDescriptorSet); // Skybox has to be rendered first
-            #endif
-
-            m_Renderer->RenderGameObjects(frameInfo);
+            // mid warp snapshots are stale the moment they arrive, viewport stays black and cores go to the simulation
+            if (!warping)
+            {
+                #ifndef FAST_LOAD
+                    m_Renderer->RenderSkybox(frameInfo, *m_Skybox, m_SkyboxDescriptorSet); // Skybox has to be rendered first
+                #endif
+
+                m_Renderer->RenderGameObjects(frameInfo);
+                // particles aren't recorded
+                if (!replaying)
+                    CollectPoints(*frameInfo.bodies, snapshot.particlePositions, snapshot.particleVelocities);
+                else
+                    CollectPoints(*frameInfo.bodies, {}, {});
+                m_Renderer->RenderParticles(frameInfo, m_PointPositions, m_PointVelocities, {0.55f, 0.5f, 0.45f});
+            }
 
             m_Renderer->EndGeometryRenderPass(commandBuffer);
 
@@ -257,365 +298,258 @@ void Application::Run()
         }
     }
 
+    m_SimulationThread.Stop();
     vkDeviceWaitIdle(m_Device.GetDevice());
-}
 
-#pragma region Planets
+    if (m_ResumeNextStart)
+        m_CheckpointWriter.Capture(m_Simulation);
+    m_CheckpointWriter.Stop();
+    CheckpointMetrics metrics = m_CheckpointWriter.GetMetrics();
+    if (metrics.failed > 0)
+        std::cerr << metrics.lastError << std::endl;
+    if (!m_ResumeNextStart)
+        std::filesystem::remove(CHECKPOINT_FILE);
+}
 
 /**
- * @brief Loads game objects with their parameters
- * @note All the data comes from https://nssdc.gsfc.nasa.gov/planetary/factsheet/
-*/
+ * @brief Loads the scenario into the simulation and creates render objects for its styled bodies,
+ * every other body is only drawn as a point
+ */
 void Application::LoadGameObjects()
 {
     // Main texture sampler creation
     m_Sampler.CreateSimpleSampler();
 
-    int id = 0;
     ObjectInfo objInfo{};
     objInfo.descriptorPool = m_GlobalPool.get();
     objInfo.device = &m_Device;
     objInfo.sampler = &m_Sampler;
 
-    int orbitLenghts = 2000;
-	//
-	// SUN
-	//
-	{
-		Properties properties{};
-        properties.label = "Sun";
-        properties.orbitUpdateFrequency = 0; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-		properties.velocity = {0.0f, 0.0f, 0.0}; // km/s
-		properties.mass = 1.99 * pow(10, 30); // kg
-		properties.orbitTraceLenght = 0;
-		properties.rotationSpeed = {0.0f, 0.0f, 0.0f}; // Degree per hour
-		properties.objType = OBJ_TYPE_STAR;
-		properties.radius = 695508.0f; // km
-		properties.color = {0.98f, 0.97f, 0.1f}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 0;
-
-		Transform transform{};
-		transform.translation = {0.0f, 0.0f, 0.0f}; // km
-		transform.rotation = {0.0f, 0.0f, 0.0f}; // starting rotation in degrees
-		std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
-			"../assets/models/sphere.obj", transform, properties);
-		m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-	}
-
-	//
-	// MERCURY
-	//
-	{
-		Properties properties{};
-        properties.label = "Mercury";
-        properties.orbitUpdateFrequency = 50; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-		properties.velocity = {0.0, 0.0, 58.97}; // km/s
-		properties.mass = 0.33010 * pow(10, 24); // kg
-		properties.orbitTraceLenght = orbitLenghts;
-		properties.rotationSpeed = {0.0, 0.0, 0.0}; // Degree per hour
-		properties.objType = OBJ_TYPE_PLANET;
-		properties.radius = 2440.0f; // km
-		properties.color = {0.788, 0.627, 0.42}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 7.0;
-
-		Transform transform{};
-		transform.translation = {46000000.0, 0.0, 0.0}; // km
-		transform.rotation = {0.0, 180.0, 0.0}; // starting rotation in degrees
-		std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
-			"../assets/models/sphere.obj", transform, properties, "../assets/textures/mercury.jpg");
-		m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-	}
-
-	//
-	// VENUS
-	//
-	{
-		Properties properties{};
-        properties.label = "Venus";
-        properties.orbitUpdateFrequency = 150; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-		properties.velocity = {0.0, 0.0, 35.26}; // km/s
-		properties.mass = 4.8673 * pow(10, 24); // kg
-		properties.orbitTraceLenght = orbitLenghts;
-		properties.rotationSpeed = {0.0, 0.0, 0.0}; // Degree per hour
-		properties.objType = OBJ_TYPE_PLANET;
-		properties.radius = 6051.8; // km
-		properties.color = {0.941, 0.78, 0.263}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 3.4;
-
-		Transform transform{};
-		transform.translation = {107480000.0, 0.0, 0.0}; // km
-		transform.rotation = {0.0, 180.0, 0.0}; // starting rotation in degrees
-		std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
-			"../assets/models/sphere.obj", transform, properties, "../assets/textures/venus.jpg");
-		m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-	}
-
-    //
-    // EARTH
-    //
+    std::vector<BodyStyle> styles;
+    LoadScenario(SCENARIO_FILE, m_Simulation, &styles);
+
+    // a handful of bodies is both faster and exact with direct summation
+    const BodyStore& bodies = m_Simulation.GetBodies();
+    m_Settings.solver = bodies.GetCount() <= DIRECT_SUM_BODY_LIMIT ? SolverType::DirectSum : SolverType::FastMultipole;
+
+    uint32_t id = 0;
+    for (const BodyStyle& style : styles)
     {
+        uint32_t index = bodies.GetIndex(style.handle);
+
         Properties properties{};
-        properties.label = "Earth";
-        properties.orbitUpdateFrequency = 200; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-        properties.velocity = {0.0, 0.0, 30.29}; // km/s
-        properties.mass = 5.9722 * pow(10, 24); // kg
-        properties.orbitTraceLenght = orbitLenghts;
-        properties.rotationSpeed = {0.0, 15.0, 0.0}; // Degree per hour
-        properties.objType = OBJ_TYPE_PLANET;
-        properties.radius = 6378.137; // km
-        properties.color = {0.5, 0.8, 0.94}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 0;
+        properties.label = style.label;
+        properties.orbitUpdateFrequency = (float)style.trailInterval;
+        properties.velocity = bodies.GetVelocities()[index];
+        properties.mass = bodies.GetMasses()[index];
+        properties.orbitTraceLenght = style.trailLength;
+        properties.rotationSpeed = glm::degrees(bodies.GetRotationSpeeds()[index]) * 3600.0; // Degree per hour
+        properties.objType = style.star ? OBJ_TYPE_STAR : OBJ_TYPE_PLANET;
+        properties.radius = bodies.GetRadii()[index];
+        properties.color = style.color;
+        properties.inclination = 0.0; // already part of the velocity
 
         Transform transform{};
-        transform.translation = {147095000.0, 0.0, 0.0}; // km
-        transform.rotation = {0.0, 0.0, 180.0}; // starting rotation in degrees
-        std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo, 
-            "../assets/models/sphere.obj", transform, properties, "../assets/textures/earth.jpg");
-        m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
+        transform.translation = bodies.GetPositions()[index];
+        transform.rotation = glm::degrees(bodies.GetRotations()[index]);
+        std::string texture = style.texture.empty() ? "" : "../assets/textures/" + style.texture;
+        std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
+            "../assets/models/sphere.obj", transform, properties, texture);
+
+        m_SimulationThread.SetTraceInterval(style.handle, style.trailInterval, style.trailLength);
+        m_GameObjects.emplace(style.handle.index, std::move(obj));
     }
+}
 
-    //
-    // MOON
-    //
+/**
+ * @brief Bodies without an object and particles end up in one list, the renderer has a single point
+ * buffer per frame
+ */
+void Application::CollectPoints(const BodyStore& bodies, const std::vector<glm::dvec3>& particlePositions,
+    const std::vector<glm::dvec3>& particleVelocities)
+{
+    m_PointPositions.clear();
+    m_PointVelocities.clear();
+    if (bodies.GetCount() > m_GameObjects.size())
     {
-        Properties properties{};
-        properties.label = "Moon";
-        properties.orbitUpdateFrequency = 200; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-        properties.velocity = {0.0, 0.0, 30.29 + 1.022}; // km/s
-        properties.mass = 0.07346 * pow(10, 24); // kg
-        properties.orbitTraceLenght = orbitLenghts;
-        properties.rotationSpeed = {0.0f, 0.0, 0.0f}; // Degree per hour
-        properties.objType = OBJ_TYPE_PLANET;
-        properties.radius = 1737.5f; // km
-        properties.color = {0.678, 0.678, 0.678}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 0.0; // 5.1 Not working for some reason
+        auto& positions = bodies.GetPositions();
+        auto& velocities = bodies.GetVelocities();
+        for (uint32_t i = 0; i < bodies.GetCount(); i++)
+        {
+            if (m_GameObjects.count(bodies.GetHandle(i).index) > 0)
+                continue;
+            m_PointPositions.push_back(positions[i]);
+            m_PointVelocities.push_back(velocities[i]);
+        }
+    }
+    m_PointPositions.insert(m_PointPositions.end(), particlePositions.begin(), particlePositions.end());
+    m_PointVelocities.insert(m_PointVelocities.end(), particleVelocities.begin(), particleVelocities.end());
+}
 
-        Transform transform{};
-        properties.orbitUpdateFrequency = 100;
-        transform.translation = {363300  + 147095000.0, 0.0f, 0.0f}; // km
-        transform.rotation = {0.0f, 180.0f, 0.0f}; // starting rotation in degrees
-        std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo, 
-            "../assets/models/sphere.obj", transform, properties, "../assets/textures/moon.jpg");
-        m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-    }
-
-	//
-	// MARS
-	//
-	{
-		Properties properties{};
-        properties.label = "Mars";
-        properties.orbitUpdateFrequency = 400; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-		properties.velocity = {0.0, 0.0, 26.50}; // km/s
-		properties.mass = 0.64169 * pow(10, 24); // kg
-		properties.orbitTraceLenght = orbitLenghts;
-		properties.rotationSpeed = {0.0, 0.0, 0.0}; // Degree per hour
-		properties.objType = OBJ_TYPE_PLANET;
-		properties.radius = 3396.2; // km
-		properties.color = {0.988, 0.537, 0.333}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 1.8;
-
-		Transform transform{};
-		transform.translation = {206650000.0, 0.0, 0.0}; // km
-		transform.rotation = {0.0, 180.0, 0.0}; // starting rotation in degrees
-		std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
-			"../assets/models/sphere.obj", transform, properties, "../assets/textures/mars.jpg");
-		m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-	}
-
-	//
-	// JUPITER
-	//
-	{
-		Properties properties{};
-        properties.label = "Jupiter";
-        properties.orbitUpdateFrequency = 2500; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-		properties.velocity = {0.0, 0.0, 13.72}; // km/s
-		properties.mass = 1898.13 * pow(10, 24); // kg
-		properties.orbitTraceLenght = orbitLenghts;
-		properties.rotationSpeed = {0.0, 0.0, 0.0}; // Degree per hour
-		properties.objType = OBJ_TYPE_PLANET;
-		properties.radius = 69911.0; // km
-		properties.color = {0.839, 0.718, 0.541}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 1.3;
-
-		Transform transform{};
-		transform.translation = {740595000.0, 0.0, 0.0}; // km
-		transform.rotation = {0.0, 180.0, 0.0}; // starting rotation in degrees
-		std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
-			"../assets/models/sphere.obj", transform, properties);
-		m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-	}
-
-	//
-	// SATURN
-	//
-	{
-		Properties properties{};
-        properties.label = "Saturn";
-        properties.orbitUpdateFrequency = 6500; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-		properties.velocity = {0.0, 0.0, 10.14}; // km/s
-		properties.mass = 568.32 * pow(10, 24); // kg
-		properties.orbitTraceLenght = orbitLenghts;
-		properties.rotationSpeed = {0.0, 0.0, 0.0}; // Degree per hour
-		properties.objType = OBJ_TYPE_PLANET;
-		properties.radius = 60268.0; // km
-		properties.color = {0.961, 0.906, 0.827}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 2.5;
-
-		Transform transform{};
-		transform.translation = {1357554000, 0.0, 0.0}; // km
-		transform.rotation = {0.0, 180.0, 0.0}; // starting rotation in degrees
-		std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
-			"../assets/models/sphere.obj", transform, properties, "../assets/textures/saturn.png");
-		m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-	}
-
-	//
-	// UR ANUS
-	//
-	{
-		Properties properties{};
-        properties.label = "Uranus";
-        properties.orbitUpdateFrequency = 20000; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-		properties.velocity = {0.0, 0.0, 7.13}; // km/s
-		properties.mass = 86.811 * pow(10, 24); // kg
-		properties.orbitTraceLenght = orbitLenghts;
-		properties.rotationSpeed = {0.0, 0.0, 0.0}; // Degree per hour
-		properties.objType = OBJ_TYPE_PLANET;
-		properties.radius = 25362.0; // km
-		properties.color = {0.659, 0.835, 0.859}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 0.8;
-
-		Transform transform{};
-		transform.translation = {2732696000, 0.0, 0.0}; // km
-		transform.rotation = {0.0, 180.0, 0.0}; // starting rotation in degrees
-		std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
-			"../assets/models/sphere.obj", transform, properties, "../assets/textures/uranus.jpg");
-		m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-	}
-
-    //
-	// NEPTUNE
-	//
-	{
-		Properties properties{};
-        properties.label = "Neptune";
-        properties.orbitUpdateFrequency = 40000; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-		properties.velocity = {0.0, 0.0, 5.47}; // km/s
-		properties.mass = 102.409 * pow(10, 24); // kg
-		properties.orbitTraceLenght = orbitLenghts;
-		properties.rotationSpeed = {0.0, 0.0, 0.0}; // Degree per hour
-		properties.objType = OBJ_TYPE_PLANET;
-		properties.radius = 24622.0; // km
-		properties.color = {0.4, 0.49, 0.89}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 1.8;
-
-		Transform transform{};
-		transform.translation = {4471050000, 0.0, 0.0}; // km
-		transform.rotation = {0.0, 180.0, 0.0}; // starting rotation in degrees
-		std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
-			"../assets/models/sphere.obj", transform, properties, "../assets/textures/neptune.jpg");
-		m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-	}
-
-    //
-	// PLUTO
-	//
-	{
-		Properties properties{};
-        properties.label = "Pluto";
-        properties.orbitUpdateFrequency = 60000; // Update orbits less frequently to make them longer. It is usefull if planets are far from sun and move really slow
-		properties.velocity = {0.0, 0.0, 3.71}; // km/s
-		properties.mass = 0.01303 * pow(10, 24); // kg
-		properties.orbitTraceLenght = orbitLenghts;
-		properties.rotationSpeed = {0.0, 0.0, 0.0}; // Degree per hour
-		properties.objType = OBJ_TYPE_PLANET;
-		properties.radius = 1188.0; // km
-		properties.color = {0.839, 0.514, 0.514}; // color of the icon and orbit trace not planet itself
-        properties.inclination = 17.0;
-
-		Transform transform{};
-		transform.translation = {7304326000, 0.0, 0.0}; // km
-		transform.rotation = {0.0, 180.0, 0.0}; // starting rotation in degrees
-		std::unique_ptr<Object> obj = std::make_unique<Object>(id++, objInfo,
-			"../assets/models/sphere.obj", transform, properties);
-		m_GameObjects.emplace(obj->GetObjectID(), std::move(obj));
-	}
+/**
+ * @brief Continues where the last session stopped if it left a checkpoint. Objects still come from
+ * LoadGameObjects, bodies are added in the same order so handles match, objects of bodies that were
+ * absorbed before the checkpoint are dropped.
+ */
+void Application::ResumeCheckpoint()
+{
+    if (!std::filesystem::exists(CHECKPOINT_FILE))
+        return;
+
+    try
+    {
+        LoadCheckpoint(CHECKPOINT_FILE, m_Simulation);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << ", starting from the beginning" << std::endl;
+        return;
+    }
+
+    const BodyStore& bodies = m_Simulation.GetBodies();
+    for (auto iter = m_GameObjects.begin(); iter != m_GameObjects.end();)
+    {
+        bool alive = false;
+        for (uint32_t i = 0; i < bodies.GetCount() && !alive; i++)
+            alive = bodies.GetHandle(i).index == iter->first;
+        iter = alive ? std::next(iter) : m_GameObjects.erase(iter);
+    }
+    m_Settings = m_Simulation.GetSettings();
+    m_SimulationThread.RebuildTrails();
 }
 
-#pragma endregion Planets
+/**
+ * @brief Simulation thread only copies its state, compression and disk are left to the checkpoint writer
+ */
+void Application::RequestCheckpoint()
+{
+    m_SimulationThread.Enqueue([this](Simulation& simulation) { m_CheckpointWriter.Capture(simulation); });
+}
 
 /**
- * @brief Updates game objects and their orbit traces
+ * @brief Plays the last recording or the imported ephemeris text back from Chebyshev segments, every
+ * frame is then a lookup no matter where the slider is and the simulation stays paused
  */
-void Application::Update(const FrameInfo& frameInfo, float delta)
+void Application::StartReplay(bool imported)
 {
-    //m_Pause = true;
+    namespace fs = std::filesystem;
+    try
+    {
+        std::error_code error;
+        if (imported)
+            m_Ephemeris.ImportText(EPHEMERIS_IMPORT_FILE, EPHEMERIS_SPAN);
+        else if (fs::exists(EPHEMERIS_FILE) && fs::last_write_time(EPHEMERIS_FILE, error) >= fs::last_write_time(TRAJECTORY_FILE, error))
+            m_Ephemeris.Load(EPHEMERIS_FILE);
+        else
+        {
+            TrajectoryReader reader;
+            reader.Open(TRAJECTORY_FILE);
+            m_Ephemeris.Build(reader);
+            m_Ephemeris.Save(EPHEMERIS_FILE);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        m_Ephemeris.Clear();
+        return;
+    }
+    m_Pacing.pause = true;
+    m_ReplayTime = m_Ephemeris.GetStartTime();
+    m_ReplayPlaying = false;
+    m_ReplaySeek = true;
+    m_ReplayTrailTimes.clear();
+}
 
-    double substepDelta = delta / (double)m_StepCount;
-    for (int i = 0; i < m_GameSpeed; i++)
+void Application::StopReplay()
+{
+    m_Ephemeris.Clear();
+    m_ReplayBodies = BodyStore();
+    // trails still show the recording
+    m_SimulationThread.RebuildTrails();
+}
+
+/**
+ * @brief Advances playback and evaluates the ephemeris. Trails get a point whenever replay time passes
+ * the spacing the simulation thread would record them at, after a seek or a long jump they are
+ * evaluated back over their whole length.
+ * @note Bodies absorbed before the replay started have no object anymore and aren't drawn.
+ */
+void Application::UpdateReplay(VkCommandBuffer commandBuffer, float delta)
+{
+    if (m_ReplayPlaying)
     {
-        for (int j = 0; j < m_StepCount; j++)
+        m_ReplayTime += (double)m_ReplaySpeed * 86400.0 * (double)delta;
+        if (m_ReplayTime >= m_Ephemeris.GetEndTime())
         {
-            // Loop through pairs of objects and applies velocity to them
-            for (auto iterA = m_GameObjects.begin(); iterA != m_GameObjects.end(); iterA++)
-            {
-                auto& objA = iterA->second;
-                
-                if (m_GameObjects.size() == 1) // if there is only one object still apply it's velocity
-                {
-                    objA->GetObjectTransform().translation += objA->GetObjectProperties().velocity;
-                }
-                else
-                {
-                    for (auto iterB = iterA; iterB != m_GameObjects.end(); iterB++)
-                    {
-                        auto& objB = iterB->second;
-                        if (objA == objB)
-                            continue;
-                        
-                        // convert translations from km to m
-                        glm::dvec3 offset = objA->GetObjectTransform().translation*1000.0 - objB->GetObjectTransform().translation*1000.0;
-                        double distanceSquared = glm::dot(offset, offset);
-                        if (std::sqrt(distanceSquared)/1000.0 < objA->GetObjectProperties().radius + objB->GetObjectProperties().radius)
-                        {
-                            std::cout << "HIT" << std::endl;
-                            // something should go in here
-                        }
-                        double G = 6.67 / (pow(10, 11));
-                        double force = G * objA->GetObjectProperties().mass * objB->GetObjectProperties().mass / distanceSquared;
-                        glm::dvec3 trueForce = force * offset / glm::sqrt(distanceSquared);
-                        objA->GetObjectProperties().velocity += substepDelta * -trueForce / objA->GetObjectProperties().mass / 1000.0;// convert back to km
-                        objB->GetObjectProperties().velocity += substepDelta * trueForce / objB->GetObjectProperties().mass / 1000.0;// convert back to km
-                    }
-                }
-                
-                objA->GetObjectTransform().rotation += objA->GetObjectProperties().rotationSpeed * (double)substepDelta;
-            }
+            m_ReplayTime = m_Ephemeris.GetEndTime();
+            m_ReplayPlaying = false;
+        }
+    }
+    m_Ephemeris.Evaluate(m_ReplayTime, m_ReplayBodies);
 
-            // Update each object position by it's final velocity
-            for (auto& kv : m_GameObjects)
-            {
-                auto& obj = kv.second;
-                obj->GetObjectTransform().translation += substepDelta * obj->GetObjectProperties().velocity;
-            }
+    uint32_t burst = (uint32_t)std::max(int(m_Pacing.delta/60.0), 1);
+    for (uint32_t i = 0; i < m_ReplayBodies.GetCount(); i++)
+    {
+        BodyHandle handle = m_ReplayBodies.GetHandle(i);
+        auto object = m_GameObjects.find(handle.index);
+        if (object == m_GameObjects.end())
+            continue;
+        Properties& properties = object->second->GetObjectProperties();
+        uint32_t length = properties.orbitTraceLenght;
+        if (length == 0 || properties.orbitUpdateFrequency <= 0.0f)
+            continue;
+
+        double spacing = m_Pacing.delta * (double)properties.orbitUpdateFrequency / (double)burst;
+        auto trail = m_ReplayTrailTimes.find(handle.index);
+        if (m_ReplaySeek || trail == m_ReplayTrailTimes.end() || m_ReplayTime < trail->second || m_ReplayTime - trail->second > spacing * length)
+        {
+            // before the body existed it stays on its first recorded position
+            std::vector<glm::dvec3> positions(length, m_ReplayBodies.GetPositions()[i]);
+            for (uint32_t k = 0; k < length; k++)
+                m_Ephemeris.EvaluatePosition(handle, m_ReplayTime - spacing * (double)(length - 1 - k), positions[k]);
+            object->second->ResetOrbit(commandBuffer, positions);
+            m_ReplayTrailTimes[handle.index] = m_ReplayTime;
+            continue;
         }
 
-        static uint32_t orbitUpdateCount = 0;
-        orbitUpdateCount = (orbitUpdateCount + 1) % uint32_t(0-1);
-        
-        for (auto& kv : m_GameObjects)
+        while (m_ReplayTime - trail->second >= spacing)
         {
-            auto& obj = kv.second;
-            // Update orbits less frequently to make them longer
-            if (orbitUpdateCount % obj->GetObjectOrbitUpdateFreq()/int(DELTA/60.0) == 0)
-            {
-                obj->OrbitUpdate(frameInfo.commandBuffer);
-            }
+            trail->second += spacing;
+            glm::dvec3 position;
+            if (m_Ephemeris.EvaluatePosition(handle, trail->second, position))
+                object->second->OrbitUpdate(commandBuffer, position);
         }
+    }
+    m_ReplaySeek = false;
+}
+
+/**
+ * @brief Feeds orbit traces recorded by the simulation thread and drops objects of absorbed bodies
+ */
+void Application::ProcessSimulationEvents(VkCommandBuffer commandBuffer)
+{
+    // objects absorbed last frame may still be referenced by its command buffer, it has been submitted by now
+    for (uint32_t index : m_AbsorbedObjects)
+        m_GameObjects.erase(index);
+    m_AbsorbedObjects.clear();
+
+    m_SimulationThread.TakeEvents(m_Events);
+    for (const BodyMerge& merge : m_Events.merges)
+        m_AbsorbedObjects.push_back(merge.absorbed.index);
+
+    for (const TrailSeed& trail : m_Events.trails)
+    {
+        auto iter = m_GameObjects.find(trail.handle.index);
+        if (iter != m_GameObjects.end())
+            iter->second->ResetOrbit(commandBuffer, trail.positions);
+    }
 
-        realTime += ((double)delta/3600);
+    for (const TraceSample& sample : m_Events.traces)
+    {
+        auto iter = m_GameObjects.find(sample.handle.index);
+        if (iter != m_GameObjects.end())
+            iter->second->OrbitUpdate(commandBuffer, sample.position);
     }
 }
 
@@ -641,25 +575,198 @@ void Application::RenderImGui(const FrameInfo& frameInfo)
         m_FPSaccumulator -= 0.5f;
     }
     ImGui::Text("FPS %.1f (%fms)", m_FPS, frameInfo.frameTime);
-    ImGui::Checkbox("Pause", &m_Pause);
+    ImGui::Checkbox("Pause", &m_Pacing.pause);
+    ImGui::SameLine();
+    ImGui::Checkbox("Collisions", &m_Settings.collisions);
+    const SimulationSnapshot& snapshot = m_SimulationThread.GetSnapshot();
+    double realTime = snapshot.time / 3600.0;
     ImGui::Text("Simulation Time: %.2f hours | %.0f days | %.0f years", std::floor(realTime), std::floor(realTime/24.0), std::floor(realTime/24.0/365.25));
 
     ImGui::Combo("Skybox", &skyboxImageSelected, Skyboxes, IM_ARRAYSIZE(Skyboxes));
+    if (ImGui::Button("Save Checkpoint"))
+        RequestCheckpoint();
+    ImGui::SameLine();
+    ImGui::Checkbox("Resume Next Start", &m_ResumeNextStart);
+    ImGui::SliderFloat("Autosave (min)", &m_AutosaveMinutes, 0.0f, 60.0f, "%.0f");
+    CheckpointMetrics checkpoint = m_CheckpointWriter.GetMetrics();
+    if (checkpoint.written > 0)
+    {
+        ImGui::Text("Checkpoint %.0f days | pause %.2f ms | write %.0f ms | %.1f MB", checkpoint.time/86400.0, 
+            checkpoint.pause * 1000.0, checkpoint.writeTime * 1000.0, checkpoint.fileBytes / (1024.0 * 1024.0));
+    }
+    if (checkpoint.failed > 0)
+        ImGui::TextColored({1.0f, 0.3f, 0.3f, 1.0f}, "%s", checkpoint.lastError.c_str());
 
-    ImGui::SliderInt("Speed", &m_GameSpeed, 1, 10000);
-    ImGui::SliderInt("StepCount", &m_StepCount, 1, 20);
-    for (auto& kv : m_GameObjects)
+    if (!m_Ephemeris.IsEmpty())
     {
-        auto& obj = kv.second;
+        RenderReplayControls();
+        RenderCameraLocks(*frameInfo.bodies);
+        ImGui::End();
+        RenderViewport(frameInfo);
+        return;
+    }
+    if (snapshot.recording)
+    {
+        if (ImGui::Button("Stop Recording"))
+            m_SimulationThread.StopRecording();
+        ImGui::SameLine();
+        ImGui::Text("%llu frames | %.1f MB", (unsigned long long)snapshot.recordedFrames, snapshot.recordedBytes / (1024.0 * 1024.0));
+    }
+    else
+    {
+        if (ImGui::Button("Record"))
+            m_SimulationThread.StartRecording(TRAJECTORY_FILE, m_RecordCadence * 3600.0);
+        ImGui::SameLine();
+        if (ImGui::Button("Replay"))
+            StartReplay(false);
+        ImGui::SameLine();
+        if (ImGui::Button("Import Ephemeris"))
+            StartReplay(true);
+        ImGui::SliderFloat("Record Cadence (h)", &m_RecordCadence, 0.1f, 240.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+    }
 
-        std::string text = "Camera Lock on " + obj->GetObjectLabel();          
-        if (ImGui::Button(text.c_str()))
+    if (m_SimulationThread.IsWarping())
+    {
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%.0f / %.0f days", realTime/24.0, m_WarpTarget/86400.0);
+        ImGui::ProgressBar((float)snapshot.warpProgress, ImVec2(-1.0f, 0.0f), overlay);
+        if (ImGui::Button("Cancel Warp"))
+            m_SimulationThread.CancelWarp();
+        ImGui::End();
+        RenderViewport(frameInfo);
+        return;
+    }
+    ImGui::InputDouble("Warp Years", &m_WarpYears, 1.0, 10.0, "%.2f");
+    ImGui::SameLine();
+    if (ImGui::Button("Warp"))
+    {
+        m_WarpTarget = snapshot.time + m_WarpYears * 365.25 * 86400.0;
+        m_SimulationThread.WarpTo(m_WarpTarget);
+    }
+
+    ImGui::SliderInt("Speed", &m_Pacing.gameSpeed, 1, 10000);
+    ImGui::SliderFloat("Frame Budget (ms)", &m_Pacing.budget, 1.0f, 16.0f, "%.1f");
+    // speed the budget can't carry is dropped, show what is actually achieved rather than what was asked for
+    if (snapshot.budgetLimited && !m_Pacing.pause)
+        ImGui::TextColored({1.0f, 0.6f, 0.2f, 1.0f}, "Warp %.0fx of %.0fx (%.3f ms per iteration)", snapshot.warp, snapshot.requestedWarp, snapshot.iterationCost * 1000.0);
+    else
+        ImGui::Text("Warp %.0fx", m_Pacing.pause ? 0.0 : snapshot.warp);
+    SimulationSettings& settings = m_Settings;
+    ImGui::Combo("Integrator", &settings.integrator, Integrators, IM_ARRAYSIZE(Integrators));
+    // adaptive integrator picks its own steps, pacing delta only decides how often we get to see the state
+    if (settings.integrator == IntegratorType::Ias15)
+        ImGui::SliderFloat("Tolerance", &settings.tolerance, 1e-12f, 1e-4f, "%.1e", ImGuiSliderFlags_Logarithmic);
+    else if (settings.integrator == IntegratorType::PatchedConics)
+    {
+        ImGui::SliderFloat("Perturbation Threshold", &settings.perturbationThreshold, 1e-4f, 1e-1f, "%.1e", ImGuiSliderFlags_Logarithmic);
+        ImGui::Text("Analytic %u | Numeric %u", snapshot.analyticCount, snapshot.numericCount);
+    }
+    else
+        ImGui::SliderInt("StepCount", &m_Pacing.stepCount, 1, 1000);
+    ImGui::Combo("Solver", &settings.solver, Solvers, IM_ARRAYSIZE(Solvers));
+    if (settings.solver == SolverType::DirectSum)
+    {
+        static const char* simdLevel = GetSimdLevelName(DetectSimdLevel());
+        ImGui::Checkbox("SIMD", &settings.vectorize);
+        ImGui::SameLine();
+        ImGui::Text("(%s)", settings.vectorize ? simdLevel : GetSimdLevelName(SimdScalar));
+    }
+    if (settings.solver == SolverType::BarnesHut || settings.solver == SolverType::FastMultipole)
+        ImGui::SliderFloat("Opening Angle", &settings.openingAngle, 0.0f, 1.5f);
+    if (settings.solver == SolverType::FastMultipole)
+        ImGui::SliderInt("Expansion Order", &settings.expansionOrder, 1, FmmSolver::MAX_ORDER);
+    if (settings.solver != SolverType::FastMultipole)
+    {
+        static const int maxThreads = (int)std::max(std::thread::hardware_concurrency(), 1u);
+        ImGui::SliderInt("Threads", &settings.threadCount, 1, maxThreads);
+    }
+    if (settings.solver != SolverType::DirectSum)
+    {
+        if (ImGui::Button("Measure Error") && !m_PendingSolverError.valid())
         {
-            m_TargetLock = obj->GetObjectID();
+            auto promise = std::make_shared<std::promise<SolverError>>();
+            m_PendingSolverError = promise->get_future();
+            m_SimulationThread.Enqueue([promise](Simulation& simulation) { promise->set_value(simulation.MeasureSolverError()); });
         }
+        if (m_PendingSolverError.valid() && m_PendingSolverError.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            m_SolverError = m_PendingSolverError.get();
+        ImGui::SameLine();
+        ImGui::Text("max %.2e | rms %.2e (%u samples)", m_SolverError.maxRelative, m_SolverError.rmsRelative, m_SolverError.samples);
     }
+
+    ImGui::Text("Test Particles: %u", (uint32_t)snapshot.particlePositions.size());
+    ImGui::SliderInt("Belt Size", &m_BeltSize, 1000, 200000);
+    if (ImGui::Button("Add Asteroid Belt"))
+    {
+        GeneratorSettings belt{};
+        belt.type = GeneratorType::AsteroidBelt;
+        belt.count = (uint32_t)m_BeltSize;
+        belt.seed = m_BeltSeed++;
+        m_SimulationThread.Enqueue([belt](Simulation& simulation)
+        {
+            // everything may have been absorbed, a belt has nothing to orbit then
+            if (simulation.GetBodies().GetCount() > 0)
+                Generate(belt, simulation);
+        });
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear Particles"))
+        m_SimulationThread.Enqueue([](Simulation& simulation) { simulation.GetParticles().Clear(); });
+
+    RenderCameraLocks(snapshot.bodies);
     ImGui::End();
 
+    RenderViewport(frameInfo);
+}
+
+void Application::RenderReplayControls()
+{
+    double days = m_ReplayTime / 86400.0;
+    double startDays = m_Ephemeris.GetStartTime() / 86400.0;
+    double endDays = m_Ephemeris.GetEndTime() / 86400.0;
+    if (ImGui::SliderScalar("Replay (days)", ImGuiDataType_Double, &days, &startDays, &endDays, "%.1f"))
+    {
+        m_ReplayTime = days * 86400.0;
+        m_ReplaySeek = true;
+    }
+    if (ImGui::Button(m_ReplayPlaying ? "Pause Replay" : "Play"))
+    {
+        // playing from the end starts over
+        if (!m_ReplayPlaying && m_ReplayTime >= m_Ephemeris.GetEndTime())
+        {
+            m_ReplayTime = m_Ephemeris.GetStartTime();
+            m_ReplaySeek = true;
+        }
+        m_ReplayPlaying = !m_ReplayPlaying;
+    }
+    ImGui::SameLine();
+    ImGui::SliderFloat("Days per Second", &m_ReplaySpeed, 0.01f, 10000.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+    ImGui::Text("%u segments of %.1f days | fit within %.3f km", m_Ephemeris.GetSegmentCount(), m_Ephemeris.GetSpan() / 86400.0, m_Ephemeris.GetMaxFitError());
+    if (ImGui::Button("Exit Replay"))
+        StopReplay();
+}
+
+void Application::RenderCameraLocks(const BodyStore& bodies)
+{
+    for (uint32_t i = 0; i < bodies.GetCount(); i++)
+    {
+        auto iter = m_GameObjects.find(bodies.GetHandle(i).index);
+        if (iter == m_GameObjects.end())
+            continue;
+
+        std::string text = "Camera Lock on " + iter->second->GetObjectLabel();          
+        if (ImGui::Button(text.c_str()))
+        {
+            m_TargetLock = bodies.GetHandle(i);
+        }
+    }
+}
+
+/**
+ * @brief Viewport window showing the geometry pass, closes the ImGui frame
+ */
+void Application::RenderViewport(const FrameInfo& frameInfo)
+{
     static glm::vec2 lastViewportSize = {0,0};
     static bool firstTime = true;
 
@@ -7,11 +7,16 @@
 #include "cameraController.h"
 #include "vulkan/descriptors.h"
 #include "vulkan/skybox.h"
+#include "physics/simulation.h"
+#include "physics/simulationThread.h"
+#include "physics/checkpointWriter.h"
+#include "physics/ephemeris.h"
 
 #include <iostream>
 #include <memory>
 #include <vector>
 #include <chrono>
+#include <future>
 
 class Application
 {
@@ -22,10 +27,19 @@ public:
     void Run();
 private:
     void LoadGameObjects();
-
-    void Update(const FrameInfo& frameInfo, float delta);
+    void ResumeCheckpoint();
+    void RequestCheckpoint();
+    void StartReplay(bool imported);
+    void StopReplay();
+    void UpdateReplay(VkCommandBuffer commandBuffer, float delta);
+    void ProcessSimulationEvents(VkCommandBuffer commandBuffer);
+    void CollectPoints(const BodyStore& bodies, const std::vector<glm::dvec3>& particlePositions,
+        const std::vector<glm::dvec3>& particleVelocities);
 
     void RenderImGui(const FrameInfo& frameInfo);
+    void RenderViewport(const FrameInfo& frameInfo);
+    void RenderReplayControls();
+    void RenderCameraLocks(const BodyStore& bodies);
 
     Window m_Window{1600, 900, "Gravity"};
     Device m_Device{m_Window};
@@ -34,6 +48,9 @@ private:
     CameraController m_CameraController{m_Window.GetGLFWwindow()};
 
     std::unique_ptr<DescriptorPool> m_GlobalPool{};
+    Simulation m_Simulation;
+    CheckpointWriter m_CheckpointWriter; // outlives the simulation thread, captures are queued there
+    SimulationThread m_SimulationThread{m_Simulation};
     Map m_GameObjects;
 
     Sampler m_Sampler{m_Device};
@@ -43,13 +60,36 @@ private:
     VkDescriptorSet m_SkyboxDescriptorSet{};
     std::unique_ptr<DescriptorSetLayout> m_SkyboxSetLayout;
 private:
-    float m_MainLoopAccumulator = 0;
     float m_FPSaccumulator = 0;
     float m_FPS = 0;
-    uint32_t m_TargetLock = 0;
-    int m_StepCount = 1; // TODO: fix step count, when step count is high float starts to break because we're dividing 0.016 by something like 2500
-    int m_GameSpeed = 1;
-    bool m_Pause = true;
+    BodyHandle m_TargetLock{};
+    SolverError m_SolverError{};
+    std::future<SolverError> m_PendingSolverError;
+    // edited by ImGui and handed to the simulation thread when they change
+    SimulationSettings m_Settings;
+    SimulationPacing m_Pacing;
+    SimulationSettings m_SentSettings;
+    SimulationPacing m_SentPacing;
+    SimulationEvents m_Events;
+    std::vector<uint32_t> m_AbsorbedObjects; // erased one frame late, last command buffer may still use them
+    int m_BeltSize = 10000;
+    uint64_t m_BeltSeed = 42; // every belt added gets a different one
+    double m_WarpYears = 10.0;
+    double m_WarpTarget = 0.0; // seconds
+    bool m_ResumeNextStart = true; // checkpoint is written on exit, otherwise the old one is deleted
+    float m_AutosaveMinutes = 10.0f; // 0 turns periodic checkpoints off
+    float m_AutosaveAccumulator = 0.0f; // seconds
+    float m_RecordCadence = 1.0f; // hours of simulation time between recorded frames
+    // replay shows a recording or imported ephemeris instead of the simulation, which stays paused meanwhile
+    Ephemeris m_Ephemeris;
+    BodyStore m_ReplayBodies;
+    double m_ReplayTime = 0.0; // seconds
+    float m_ReplaySpeed = 10.0f; // simulated days per real second
+    bool m_ReplayPlaying = false;
+    bool m_ReplaySeek = false; // trails are redrawn instead of extended on the next frame
+    std::unordered_map<uint32_t, double> m_ReplayTrailTimes; // object index -> time of its newest trail point
+    std::vector<glm::dvec3> m_PointPositions; // unstyled bodies followed by particles, rebuilt every frame
+    std::vector<glm::dvec3> m_PointVelocities;
     glm::dvec3 m_Offset;
     TextureImage m_IconImage{m_Device, "../assets/textures/icon.png"};
     bool m_IsViewportHovered = true;
@@ -0,0 +1,469 @@
+#include "physics/simulation.h"
+#include "physics/barnesHutSolver.h"
+#include "physics/fmmSolver.h"
+#include "physics/generators.h"
+#include "physics/timer.h"
+#include "headless/commandLine.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <thread>
+
+/*
+    Times the physics hot paths without window or GPU, force evaluation per solver and full steps per
+    integrator. Results go to JSON with one result per line, so files from two commits can be diffed
+    by eye or compared with --baseline.
+*/
+
+#ifndef GRAVITY_BENCH_COMMIT
+#define GRAVITY_BENCH_COMMIT "unknown"
+#endif
+
+#define BENCH_MIN_RUNS 3 // even when a single run takes longer than --min-time
+#define BENCH_SEED 1 // same Plummer sphere for every commit
+
+struct BenchOptions
+{
+    std::vector<uint32_t> sizes = { 1000, 10000, 100000 };
+    std::vector<uint32_t> threads; // powers of two up to every core unless given
+    std::vector<int> solvers = { SolverType::DirectSum, SolverType::BarnesHut, SolverType::FastMultipole };
+    std::vector<int> integrators = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    uint32_t directLimit = 50000; // larger sizes skip direct summation, one evaluation would take seconds
+    std::vector<uint32_t> stepBodies = { 100, 1000 }; // hierarchical systems the integrators step
+    double delta = 3600.0; // seconds per integrator step
+    double minTime = 0.5; // seconds spent on every measurement
+    std::string output = "bench.json";
+    std::string baseline; // earlier JSON to compare against, empty for none
+    double tolerance = 0.1; // slowdown over the baseline counted as a regression
+    std::string label = GRAVITY_BENCH_COMMIT;
+};
+
+struct BenchResult
+{
+    std::string kind; // "force" or "step"
+    std::string name; // solver or integrator
+    uint32_t bodies = 0;
+    uint32_t threads = 1;
+    uint32_t runs = 0;
+    double seconds = 0.0; // fastest run, least disturbed by the rest of the machine
+    double medianSeconds = 0.0;
+    double nsPerInteraction = 0.0; // seconds over N (N - 1) body pairs, what direct summation would have computed
+    double nsPerBody = 0.0;
+    double stepsPerSecond = 0.0;
+    double efficiency = 0.0; // single thread time over threads times this time, 0 when there's no single thread run
+};
+
+static void PrintUsage()
+{
+    std::cout <<
+        "Usage: gravity_bench [options]\n"
+        "  --sizes <n,n,...>     bodies of the force benchmarks (default 1000,10000,100000)\n"
+        "  --threads <n,n,...>   thread counts (default powers of two up to every core)\n"
+        "  --solvers <names>     direct, barnes-hut, fmm separated by commas (default all)\n"
+        "  --integrators <names> euler, leapfrog, yoshida4, yoshida6, hermite, wisdom-holman, ias15, conics (default all)\n"
+        "  --direct-limit <n>    largest size direct summation runs at (default 50000)\n"
+        "  --step-bodies <n,n,...>  bodies of the integrator benchmarks (default 100,1000)\n"
+        "  --delta <seconds>     integrator step size (default 3600)\n"
+        "  --min-time <seconds>  time spent on every measurement (default 0.5)\n"
+        "  --output <file>       JSON results (default bench.json)\n"
+        "  --baseline <file>     earlier results, exits with 1 when anything got slower than the tolerance\n"
+        "  --tolerance <value>   relative slowdown counted as a regression (default 0.1)\n"
+        "  --label <text>        stored with the results (default the commit built from)\n";
+}
+
+static void ParseOptions(int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        auto value = [&]() -> const char*
+        {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value for " + argument);
+            return argv[++i];
+        };
+
+        if (argument == "--sizes")
+            options.sizes = ParseValues<uint32_t>(value());
+        else if (argument == "--threads")
+            options.threads = ParseValues<uint32_t>(value());
+        else if (argument == "--solvers")
+            options.solvers = ParseNames(value(), SolverNames);
+        else if (argument == "--integrators")
+            options.integrators = ParseNames(value(), IntegratorNames);
+        else if (argument == "--direct-limit")
+            options.directLimit = (uint32_t)std::stoul(value());
+        else if (argument == "--step-bodies")
+            options.stepBodies = ParseValues<uint32_t>(value());
+        else if (argument == "--delta")
+            options.delta = std::stod(value());
+        else if (argument == "--min-time")
+            options.minTime = std::stod(value());
+        else if (argument == "--output")
+            options.output = value();
+        else if (argument == "--baseline")
+            options.baseline = value();
+        else if (argument == "--tolerance")
+            options.tolerance = std::stod(value());
+        else if (argument == "--label")
+            options.label = value();
+        else if (argument == "--help" || argument == "-h")
+        {
+            PrintUsage();
+            std::exit(EXIT_SUCCESS);
+        }
+        else
+            throw std::runtime_error("Unknown option " + argument);
+    }
+
+    if (options.threads.empty())
+    {
+        uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+        for (uint32_t threads = 1; threads < cores; threads *= 2)
+            options.threads.push_back(threads);
+        options.threads.push_back(cores);
+    }
+    if (options.delta <= 0.0)
+        throw std::runtime_error("--delta has to be positive");
+    if (*std::min_element(options.stepBodies.begin(), options.stepBodies.end()) < 2)
+        throw std::runtime_error("--step-bodies needs a star and a planet at least");
+}
+
+/**
+ * @brief Runs work once to warm caches and allocations up, then until minTime passed. Setup runs untimed
+ * before every run of work, when there is one.
+ * @return seconds of every timed run, sorted
+ */
+static std::vector<double> Measure(const std::function<void()>& work, double minTime, const std::function<void()>& setup = nullptr)
+{
+    if (setup)
+        setup();
+    work();
+
+    std::vector<double> samples;
+    Timer total;
+    while (samples.size() < BENCH_MIN_RUNS || total.GetSeconds() < minTime)
+    {
+        if (setup)
+            setup();
+        Timer timer;
+        work();
+        samples.push_back(timer.GetSeconds());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+static void FillTimes(BenchResult& result, const std::vector<double>& samples)
+{
+    result.runs = (uint32_t)samples.size();
+    result.seconds = samples.front();
+    result.medianSeconds = samples[samples.size() / 2];
+}
+
+static std::unique_ptr<GravitySolver> CreateSolver(int solver)
+{
+    switch (solver)
+    {
+    case SolverType::BarnesHut:
+        return std::make_unique<BarnesHutSolver>();
+    case SolverType::FastMultipole:
+        return std::make_unique<FmmSolver>();
+    default:
+        return std::make_unique<DirectSolver>();
+    }
+}
+
+/**
+ * @brief One ComputeAccelerations per run on a Plummer sphere, the usual clustered benchmark input
+ */
+static void RunForceBenchmarks(const BenchOptions& options, std::vector<BenchResult>& results)
+{
+    ThreadPool threadPool;
+    for (uint32_t size : options.sizes)
+    {
+        Simulation simulation;
+        GeneratorSettings sphere{};
+        sphere.type = GeneratorType::PlummerSphere;
+        sphere.count = size;
+        sphere.seed = BENCH_SEED;
+        Generate(sphere, simulation);
+        const BodyStore& bodies = simulation.GetBodies();
+        std::vector<glm::dvec3> accelerations;
+
+        for (int solverType : options.solvers)
+        {
+            if (solverType == SolverType::DirectSum && size > options.directLimit)
+                continue;
+
+            std::unique_ptr<GravitySolver> solver = CreateSolver(solverType);
+            for (uint32_t threads : options.threads)
+            {
+                threadPool.Resize(threads);
+                solver->SetThreadPool(&threadPool);
+                std::vector<double> samples = Measure([&]()
+                {
+                    solver->ComputeAccelerations(bodies.GetPositions(), bodies.GetMasses(), accelerations);
+                }, options.minTime);
+
+                BenchResult result{};
+                result.kind = "force";
+                result.name = SolverNames[solverType];
+                result.bodies = size;
+                result.threads = threads;
+                FillTimes(result, samples);
+                result.nsPerInteraction = result.seconds * 1e9 / ((double)size * (double)std::max(size - 1, 1u));
+                result.nsPerBody = result.seconds * 1e9 / (double)size;
+                results.push_back(result);
+                std::cout << std::left << std::setw(12) << result.name << std::setw(10) << size << std::setw(4) << threads
+                    << std::right << std::setw(14) << result.seconds * 1e3 << " ms" << std::setw(12) << result.nsPerInteraction
+                    << " ns/interaction" << std::endl;
+            }
+        }
+    }
+}
+
+/**
+ * @brief One Simulation::Step per run on a star with planets and moons, so adaptive integrators
+ * have orbits of very different periods to resolve. Every run starts over from the generated system
+ * with a new integrator, otherwise later runs would time a different state and step size.
+ * Collisions are off, merges would change the work.
+ */
+static void RunStepBenchmarks(const BenchOptions& options, std::vector<BenchResult>& results)
+{
+    for (uint32_t size : options.stepBodies)
+    {
+        Simulation system;
+        GeneratorSettings generator{};
+        generator.type = GeneratorType::HierarchicalSystem;
+        generator.count = size;
+        generator.seed = BENCH_SEED;
+        Generate(generator, system);
+
+        for (int integrator : options.integrators)
+        {
+            for (uint32_t threads : options.threads)
+            {
+                SimulationSettings settings = system.GetSettings();
+                settings.integrator = integrator;
+                settings.solver = SolverType::DirectSum;
+                settings.threadCount = (int)threads;
+                settings.collisions = false;
+
+                std::unique_ptr<Simulation> simulation;
+                auto setup = [&]()
+                {
+                    simulation = std::make_unique<Simulation>();
+                    simulation->GetBodies() = system.GetBodies();
+                    simulation->GetSettings() = settings;
+                    // creates solver, integrator and threads now instead of inside the timed step
+                    simulation->LoadIntegratorState({});
+                };
+                std::vector<double> samples = Measure([&]() { simulation->Step(options.delta); }, options.minTime, setup);
+
+                BenchResult result{};
+                result.kind = "step";
+                result.name = IntegratorNames[integrator];
+                result.bodies = size;
+                result.threads = threads;
+                FillTimes(result, samples);
+                result.nsPerBody = result.seconds * 1e9 / (double)size;
+                result.stepsPerSecond = 1.0 / result.medianSeconds;
+                results.push_back(result);
+                std::cout << std::left << std::setw(16) << result.name << std::setw(10) << result.bodies << std::setw(4) << threads
+                    << std::right << std::setw(14) << result.stepsPerSecond << " steps/s" << std::endl;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Efficiency of every result against the single thread run of the same solver or integrator and size
+ */
+static void ComputeEfficiency(std::vector<BenchResult>& results)
+{
+    for (BenchResult& result : results)
+    {
+        for (const BenchResult& single : results)
+        {
+            if (single.kind == result.kind && single.name == result.name && single.bodies == result.bodies && single.threads == 1)
+                result.efficiency = single.seconds / ((double)result.threads * result.seconds);
+        }
+    }
+}
+
+/**
+ * @brief Quotes, backslashes and control characters escaped for a JSON string
+ */
+static std::string EscapeJson(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", (unsigned char)c);
+            escaped += code;
+        }
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+static void WriteJson(const std::string& filepath, const BenchOptions& options, const std::vector<BenchResult>& results)
+{
+    std::ofstream file(filepath);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open " + filepath);
+
+    file.precision(6);
+    file << "{\n";
+    file << "  \"label\": \"" << EscapeJson(options.label) << "\",\n";
+    file << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n";
+    file << "  \"simd\": \"" << GetSimdLevelName(DetectSimdLevel()) << "\",\n";
+    file << "  \"minTime\": " << options.minTime << ",\n";
+    file << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult& result = results[i];
+        file << "    {\"kind\": \"" << result.kind << "\", \"name\": \"" << result.name << "\", \"bodies\": " << result.bodies
+            << ", \"threads\": " << result.threads << ", \"runs\": " << result.runs << ", \"seconds\": " << result.seconds
+            << ", \"medianSeconds\": " << result.medianSeconds;
+        if (result.kind == "force")
+            file << ", \"nsPerInteraction\": " << result.nsPerInteraction;
+        else
+            file << ", \"stepsPerSecond\": " << result.stepsPerSecond;
+        file << ", \"nsPerBody\": " << result.nsPerBody << ", \"efficiency\": ";
+        if (result.efficiency > 0.0)
+            file << result.efficiency;
+        else
+            file << "null";
+        file << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+
+    if (!file.good())
+        throw std::runtime_error("Failed to write " + filepath);
+}
+
+/**
+ * @brief Value of key in one result line as written by WriteJson, empty when it isn't there
+ */
+static std::string FindField(const std::string& line, const std::string& key)
+{
+    std::string pattern = "\"" + key + "\": ";
+    size_t start = line.find(pattern);
+    if (start == std::string::npos)
+        return "";
+    start += pattern.size();
+    if (line[start] == '"')
+    {
+        // undoes EscapeJson, \u escapes only come from control characters and are dropped
+        std::string text;
+        for (size_t i = start + 1; i < line.size() && line[i] != '"'; i++)
+        {
+            if (line[i] != '\\')
+                text += line[i];
+            else if (i + 1 < line.size() && line[i + 1] == 'u')
+                i += 5;
+            else if (i + 1 < line.size())
+                text += line[++i];
+        }
+        return text;
+    }
+    return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+/**
+ * @brief Matches results by kind, name, bodies and threads and prints how the fastest runs moved
+ * @return number of results slower than the tolerance allows
+ */
+static uint32_t CompareBaseline(const BenchOptions& options, const std::vector<BenchResult>& results)
+{
+    std::ifstream file(options.baseline);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open baseline " + options.baseline);
+
+    std::string label = options.baseline;
+    uint32_t regressions = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::string baselineLabel = FindField(line, "label");
+        if (!baselineLabel.empty())
+            label = baselineLabel;
+        std::string kind = FindField(line, "kind");
+        if (kind.empty())
+            continue;
+
+        std::string name = FindField(line, "name");
+        uint32_t bodies = (uint32_t)std::stoul(FindField(line, "bodies"));
+        uint32_t threads = (uint32_t)std::stoul(FindField(line, "threads"));
+        double seconds = std::stod(FindField(line, "seconds"));
+        for (const BenchResult& result : results)
+        {
+            if (result.kind != kind || result.name != name || result.bodies != bodies || result.threads != threads)
+                continue;
+
+            double change = result.seconds / seconds - 1.0;
+            bool regressed = change > options.tolerance;
+            regressions += regressed ? 1 : 0;
+            std::cout << std::left << std::setw(6) << kind << std::setw(16) << name << std::setw(10) << bodies << std::setw(4) << threads
+                << std::right << std::showpos << std::setw(10) << std::fixed << std::setprecision(1) << change * 100.0 << "%"
+                << std::noshowpos << std::defaultfloat << std::setprecision(6) << (regressed ? "  REGRESSION" : "") << std::endl;
+        }
+    }
+    std::cout << regressions << " regressions against " << label << std::endl;
+    return regressions;
+}
+
+static int Run(int argc, char** argv)
+{
+    BenchOptions options;
+    ParseOptions(argc, argv, options);
+    std::cout << "gravity_bench " << options.label << ", " << std::thread::hardware_concurrency() << " hardware threads, "
+        << GetSimdLevelName(DetectSimdLevel()) << std::endl;
+
+    std::vector<BenchResult> results;
+    if (!options.sizes.empty() && !options.solvers.empty())
+        RunForceBenchmarks(options, results);
+    if (!options.integrators.empty())
+        RunStepBenchmarks(options, results);
+    ComputeEfficiency(results);
+
+    WriteJson(options.output, options, results);
+    std::cout << results.size() << " results written to " << options.output << std::endl;
+
+    if (!options.baseline.empty() && CompareBaseline(options, results) > 0)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        return Run(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
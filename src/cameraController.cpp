@@ -52,10 +52,11 @@ CameraController::~CameraController()
 /*
     * @brief Updates camera position based on mouse movement
 */
-void CameraController::Update(const float& delta, Camera& camera, const int& target, Map& gameObjects, bool inputOn)
+void CameraController::Update(const float& delta, Camera& camera, BodyHandle target, const BodyStore& bodies, bool inputOn)
 {
-    if (scrollY < gameObjects[target]->GetObjectProperties().radius*2/SCALE_DOWN)
-        scrollY = gameObjects[target]->GetObjectProperties().radius*2/SCALE_DOWN;
+    double targetRadius = bodies.IsValid(target) ? bodies.GetRadii()[bodies.GetIndex(target)] : 0.0;
+    if (scrollY < targetRadius*2/SCALE_DOWN)
+        scrollY = targetRadius*2/SCALE_DOWN;
     static double radius;
     if (!inputOn)
     {
@@ -10,7 +10,7 @@ public:
     CameraController(GLFWwindow* window);
     ~CameraController();
 
-    void Update(const float& delta, Camera& camera, const int& target, Map& gameObjects, bool inputOn);
+    void Update(const float& delta, Camera& camera, BodyHandle target, const BodyStore& bodies, bool inputOn);
 private:
     GLFWwindow* m_Window;
 };
\ No newline at end of file
@@ -4,12 +4,14 @@
 #include "object.h"
 #include "vulkan/descriptors.h"
 #include "vulkan/sampler.h"
+#include "physics/bodyStore.h"
 
 #include <vulkan/vulkan.h>
 #include <unordered_map>
 #include <memory>
 
-using Map = std::unordered_map<int, std::shared_ptr<Object>>;
+// Render side objects keyed by BodyHandle::index of the body they belong to
+using Map = std::unordered_map<uint32_t, std::shared_ptr<Object>>;
 
 struct FrameInfo
 {
@@ -19,5 +21,6 @@ struct FrameInfo
     VkCommandBuffer commandBuffer;
     Camera* camera;
     VkDescriptorSet globalDescriptorSet;
-    Map gameObjects;
+    const BodyStore* bodies; // latest simulation snapshot
+    Map* gameObjects;
 };
\ No newline at end of file
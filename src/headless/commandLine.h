@@ -0,0 +1,75 @@
+#pragma once
+
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+    Names and list parsing shared by the command line tools, indices follow IntegratorType,
+    SolverType and GeneratorType.
+*/
+
+inline const char* IntegratorNames[] = { "euler", "leapfrog", "yoshida4", "yoshida6", "hermite", "wisdom-holman", "ias15", "conics" };
+inline const char* SolverNames[] = { "direct", "barnes-hut", "fmm" };
+inline const char* GeneratorNames[] = { "plummer", "hernquist", "disk", "belt", "hierarchical" };
+
+template<size_t Count>
+inline int FindName(const std::string& name, const char* const (&names)[Count])
+{
+    for (size_t i = 0; i < Count; i++)
+    {
+        if (name == names[i])
+            return (int)i;
+    }
+    throw std::runtime_error("Unknown name " + name);
+}
+
+/**
+ * @brief Comma separated items, empty ones are skipped
+ * @throws std::runtime_error when nothing is left
+ */
+inline std::vector<std::string> SplitList(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    if (items.empty())
+        throw std::runtime_error("Empty list " + list);
+    return items;
+}
+
+template<size_t Count>
+inline std::vector<int> ParseNames(const std::string& list, const char* const (&names)[Count])
+{
+    std::vector<int> indices;
+    for (const std::string& item : SplitList(list))
+        indices.push_back(FindName(item, names));
+    return indices;
+}
+
+/**
+ * @brief Checked before the cast, negative or too large values don't convert to integer types
+ * @throws std::runtime_error when a value isn't positive or doesn't fit T
+ */
+template<typename T>
+inline std::vector<T> ParseValues(const std::string& list)
+{
+    std::vector<T> values;
+    for (const std::string& item : SplitList(list))
+    {
+        double value = std::stod(item);
+        if (!(value > 0.0) || value > (double)std::numeric_limits<T>::max())
+            throw std::runtime_error("Values have to be positive in " + list);
+        values.push_back((T)value);
+        if (values.back() <= (T)0)
+            throw std::runtime_error("Values have to be positive in " + list);
+    }
+    return values;
+}
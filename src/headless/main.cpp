@@ -0,0 +1,545 @@
+#include "physics/simulation.h"
+#include "physics/stateFile.h"
+#include "physics/ensemble.h"
+#include "physics/checkpointWriter.h"
+#include "physics/trajectory.h"
+#include "physics/ephemeris.h"
+#include "physics/generators.h"
+#include "physics/workPrecision.h"
+#include "commandLine.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+    Runs the simulation without window, GPU or ImGui. Nothing here may include GLFW or Vulkan
+    headers, this executable is meant for machines that have neither.
+*/
+
+struct HeadlessOptions
+{
+    std::string scenario = "../assets/scenarios/solarSystem.txt";
+    std::string output = "state.txt";
+    std::string resume; // checkpoint to continue from instead of the scenario
+    std::string checkpoint; // binary checkpoint written next to the text output
+    bool compress = false;
+    uint64_t checkpointEvery = 0; // steps between background checkpoints, 0 for only the final one
+    uint32_t keep = 3; // rotated checkpoints kept
+    std::string record; // trajectory recording, empty for none
+    double recordEvery = 3600.0; // simulation seconds between recorded frames
+    std::string ephemeris; // Chebyshev fit of the recording, empty for none
+    double delta = 300.0; // seconds per step
+    uint64_t steps = 0;
+    double endTime = -1.0; // seconds, used instead of steps when set
+    uint64_t progressEvery = 0; // steps between progress lines, 0 for none
+    uint32_t ensemble = 0; // perturbed members run instead of the scenario itself, 0 for none
+    EnsemblePerturbation perturbation;
+    std::string summary = "ensemble.txt";
+    bool generate = false; // belts are added to the scenario, everything else replaces it
+    GeneratorSettings generator;
+    std::string workPrecision; // results of running every configuration against a reference, empty for a normal run
+    // configurations are every combination of these, empty lists take the single value flag
+    std::vector<int> integrators;
+    std::vector<int> solvers;
+    std::vector<double> deltas;
+    std::vector<uint32_t> stepCounts;
+    std::vector<float> thetas; // Barnes-Hut and FMM only
+    std::vector<float> tolerances; // IAS15 only
+    float referenceTolerance = 1e-10f; // IAS15 with direct summation integrates the reference
+    std::string checkResume; // checkpoint written halfway by the resume check, empty for a normal run
+    SimulationSettings settings;
+};
+
+static void PrintUsage()
+{
+    std::cout << 
+        "Usage: GravityHeadless [options]\n"
+        "  --scenario <file>     text or binary scenario to start from (default ../assets/scenarios/solarSystem.txt)\n"
+        "  --output <file>       where the final state is written, binary when it ends in .bin (default state.txt)\n"
+        "  --resume <file>       continue from a binary checkpoint instead of the scenario\n"
+        "  --checkpoint <file>   also write the final state as a binary checkpoint\n"
+        "  --compress            compress the checkpoint\n"
+        "  --checkpoint-every <n>  write the checkpoint in the background every n steps as well\n"
+        "  --keep <n>            checkpoints kept by --checkpoint-every, older ones get .1, .2, ... (default 3)\n"
+        "  --record <file>       record a trajectory for replay in the viewer\n"
+        "  --record-every <seconds>  simulation time between recorded frames (default 3600)\n"
+        "  --ephemeris <file>    fit the recording with Chebyshev segments for instant playback\n"
+        "  --integrator <name>   euler, leapfrog, yoshida4, yoshida6, hermite, wisdom-holman, ias15, conics\n"
+        "  --solver <name>       direct, barnes-hut, fmm\n"
+        "  --delta <seconds>     step size (default 300)\n"
+        "  --steps <n>           number of steps\n"
+        "  --time <seconds>      integrate until this simulation time, last step is shortened to hit it\n"
+        "  --threads <n>         force evaluation threads (default all cores)\n"
+        "  --tolerance <value>   IAS15 tolerance\n"
+        "  --theta <value>       Barnes-Hut and FMM opening angle\n"
+        "  --order <n>           FMM expansion order\n"
+        "  --no-collisions       don't merge touching bodies\n"
+        "  --progress <n>        print a line every n steps\n"
+        "  --ensemble <n>        run n perturbed copies of the scenario in parallel and write their summaries\n"
+        "  --perturb-position <sigma>  relative position noise of ensemble members\n"
+        "  --perturb-velocity <sigma>  relative velocity noise of ensemble members\n"
+        "  --perturb-mass <sigma>      relative mass noise of ensemble members\n"
+        "  --perturb-central     perturb the heaviest body as well\n"
+        "  --seed <n>            seed of the first ensemble member (default 1)\n"
+        "  --summary <file>      where ensemble summaries are written (default ensemble.txt)\n"
+        "  --generate <type>     plummer, hernquist, disk, hierarchical instead of the scenario, or belt around its heaviest body\n"
+        "  --count <n>           generated bodies, belt particles (default 1000)\n"
+        "  --mass <kg>           total mass of a generated sphere or disk, star of a hierarchical system\n"
+        "  --scale <km>          scale radius of a sphere, scale length of a disk, innermost orbit of a hierarchical system\n"
+        "  --generate-seed <n>   seed of the generator (default 1)\n"
+        "  --work-precision <file>  time every configuration until --time and write its errors against a reference run\n"
+        "  --integrators <names>    integrators compared, separated by commas (default --integrator)\n"
+        "  --solvers <names>        solvers compared (default --solver)\n"
+        "  --deltas <s,s,...>       step sizes compared, DELTA of the viewer (default --delta)\n"
+        "  --step-counts <n,n,...>  substeps per delta compared, StepCount of the viewer (default 1)\n"
+        "  --thetas <v,v,...>       Barnes-Hut and FMM opening angles compared (default --theta)\n"
+        "  --tolerances <v,v,...>   IAS15 tolerances compared (default --tolerance)\n"
+        "  --reference-tolerance <value>  IAS15 tolerance of the reference run, checked against a tenth of it,\n"
+        "                                 fails when round-off keeps it from converging (default 1e-10)\n"
+        "  --check-resume <file>    run each of --integrators (default all) until --time once straight and once through\n"
+        "                           a checkpoint written to file halfway, fails unless both end in exactly the same state\n";
+}
+
+/**
+ * @brief Overrides whatever options already hold with command line values
+ */
+static void ParseOptions(int argc, char** argv, HeadlessOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        auto value = [&]() -> const char*
+        {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value for " + argument);
+            return argv[++i];
+        };
+
+        if (argument == "--scenario")
+            options.scenario = value();
+        else if (argument == "--output")
+            options.output = value();
+        else if (argument == "--resume")
+            options.resume = value();
+        else if (argument == "--checkpoint")
+            options.checkpoint = value();
+        else if (argument == "--compress")
+            options.compress = true;
+        else if (argument == "--checkpoint-every")
+            options.checkpointEvery = std::stoull(value());
+        else if (argument == "--keep")
+            options.keep = (uint32_t)std::stoul(value());
+        else if (argument == "--record")
+            options.record = value();
+        else if (argument == "--record-every")
+            options.recordEvery = std::stod(value());
+        else if (argument == "--ephemeris")
+            options.ephemeris = value();
+        else if (argument == "--integrator")
+            options.settings.integrator = FindName(value(), IntegratorNames);
+        else if (argument == "--solver")
+            options.settings.solver = FindName(value(), SolverNames);
+        else if (argument == "--delta")
+            options.delta = std::stod(value());
+        else if (argument == "--steps")
+            options.steps = std::stoull(value());
+        else if (argument == "--time")
+            options.endTime = std::stod(value());
+        else if (argument == "--threads")
+            options.settings.threadCount = std::stoi(value());
+        else if (argument == "--tolerance")
+            options.settings.tolerance = std::stof(value());
+        else if (argument == "--theta")
+            options.settings.openingAngle = std::stof(value());
+        else if (argument == "--order")
+            options.settings.expansionOrder = std::stoi(value());
+        else if (argument == "--no-collisions")
+            options.settings.collisions = false;
+        else if (argument == "--progress")
+            options.progressEvery = std::stoull(value());
+        else if (argument == "--ensemble")
+            options.ensemble = (uint32_t)std::stoul(value());
+        else if (argument == "--perturb-position")
+            options.perturbation.position = std::stod(value());
+        else if (argument == "--perturb-velocity")
+            options.perturbation.velocity = std::stod(value());
+        else if (argument == "--perturb-mass")
+            options.perturbation.mass = std::stod(value());
+        else if (argument == "--perturb-central")
+            options.perturbation.perturbCentral = true;
+        else if (argument == "--seed")
+            options.perturbation.seed = std::stoull(value());
+        else if (argument == "--summary")
+            options.summary = value();
+        else if (argument == "--generate")
+        {
+            options.generate = true;
+            options.generator.type = FindName(value(), GeneratorNames);
+        }
+        else if (argument == "--count")
+            options.generator.count = (uint32_t)std::stoul(value());
+        else if (argument == "--mass")
+            options.generator.mass = std::stod(value());
+        else if (argument == "--scale")
+            options.generator.scale = std::stod(value());
+        else if (argument == "--generate-seed")
+            options.generator.seed = std::stoull(value());
+        else if (argument == "--work-precision")
+            options.workPrecision = value();
+        else if (argument == "--integrators")
+            options.integrators = ParseNames(value(), IntegratorNames);
+        else if (argument == "--solvers")
+            options.solvers = ParseNames(value(), SolverNames);
+        else if (argument == "--deltas")
+            options.deltas = ParseValues<double>(value());
+        else if (argument == "--step-counts")
+            options.stepCounts = ParseValues<uint32_t>(value());
+        else if (argument == "--thetas")
+            options.thetas = ParseValues<float>(value());
+        else if (argument == "--tolerances")
+            options.tolerances = ParseValues<float>(value());
+        else if (argument == "--reference-tolerance")
+            options.referenceTolerance = std::stof(value());
+        else if (argument == "--check-resume")
+            options.checkResume = value();
+        else if (argument == "--help" || argument == "-h")
+        {
+            PrintUsage();
+            std::exit(EXIT_SUCCESS);
+        }
+        else
+            throw std::runtime_error("Unknown option " + argument);
+    }
+
+    if (options.delta <= 0.0)
+        throw std::runtime_error("--delta has to be positive");
+    if (options.checkpointEvery > 0 && options.checkpoint.empty())
+        throw std::runtime_error("--checkpoint-every needs --checkpoint");
+    if (options.recordEvery <= 0.0)
+        throw std::runtime_error("--record-every has to be positive");
+    if (!options.ephemeris.empty() && options.record.empty())
+        throw std::runtime_error("--ephemeris needs --record");
+    if (options.generate && !options.resume.empty())
+        throw std::runtime_error("--generate can't be combined with --resume");
+    if (!options.workPrecision.empty() && options.ensemble > 0)
+        throw std::runtime_error("--work-precision can't be combined with --ensemble");
+    if (!options.checkResume.empty() && (options.ensemble > 0 || !options.workPrecision.empty()))
+        throw std::runtime_error("--check-resume can't be combined with --ensemble or --work-precision");
+}
+
+/**
+ * @brief Members are single threaded, thread count sets how many of them run at once
+ */
+static int RunEnsemble(const Simulation& simulation, const HeadlessOptions& options)
+{
+    double endTime = options.endTime >= 0.0 ? options.endTime : simulation.GetTime() + options.delta * (double)options.steps;
+    EnsembleRunner runner(simulation, options.ensemble, options.perturbation);
+    ThreadPool threadPool((uint32_t)std::max(options.settings.threadCount, 1));
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t finished = 0;
+    runner.Run(threadPool, endTime, options.delta, [&](const EnsembleSummary& summary)
+    {
+        finished++;
+        if (options.progressEvery > 0)
+        {
+            std::cout << "member " << summary.member << " done (" << finished << "/" << options.ensemble << "), energy error "
+                << summary.energyError << ", " << summary.merges << " merges, " << summary.ejected << " ejected" << std::endl;
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    runner.WriteSummaries(options.summary);
+    std::cout << options.ensemble << " members to t = " << endTime << " s in " << seconds << " s, summaries written to "
+        << options.summary << std::endl;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Every combination of the listed values, parameters a configuration doesn't use aren't varied
+ */
+static std::vector<WorkPrecisionConfig> BuildConfigs(const HeadlessOptions& options)
+{
+    auto orDefault = [](const auto& values, auto value)
+    {
+        return values.empty() ? std::vector<decltype(value)>{ value } : values;
+    };
+    std::vector<int> integrators = orDefault(options.integrators, options.settings.integrator);
+    std::vector<int> solvers = orDefault(options.solvers, options.settings.solver);
+    std::vector<double> deltas = orDefault(options.deltas, options.delta);
+    std::vector<uint32_t> stepCounts = orDefault(options.stepCounts, 1u);
+    std::vector<float> thetas = orDefault(options.thetas, options.settings.openingAngle);
+    std::vector<float> tolerances = orDefault(options.tolerances, options.settings.tolerance);
+
+    std::vector<WorkPrecisionConfig> configs;
+    for (int integrator : integrators)
+    {
+        bool adaptive = integrator == IntegratorType::Ias15;
+        for (int solver : solvers)
+        {
+            // IAS15 picks its own steps, delta only caps them
+            for (size_t d = 0; d < (adaptive ? 1 : deltas.size()); d++)
+            {
+                for (size_t c = 0; c < (adaptive ? 1 : stepCounts.size()); c++)
+                {
+                    for (size_t t = 0; t < (solver == SolverType::DirectSum ? 1 : thetas.size()); t++)
+                    {
+                        for (size_t e = 0; e < (adaptive ? tolerances.size() : 1); e++)
+                        {
+                            WorkPrecisionConfig config{};
+                            config.label = std::string(IntegratorNames[integrator]) + "/" + SolverNames[solver];
+                            config.settings = options.settings;
+                            config.settings.integrator = integrator;
+                            config.settings.solver = solver;
+                            config.settings.openingAngle = thetas[t];
+                            config.settings.tolerance = tolerances[e];
+                            config.delta = adaptive ? *std::max_element(deltas.begin(), deltas.end()) : deltas[d];
+                            config.stepCount = adaptive ? 1 : stepCounts[c];
+                            configs.push_back(config);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return configs;
+}
+
+static int RunWorkPrecision(const Simulation& simulation, const HeadlessOptions& options)
+{
+    double endTime = options.endTime >= 0.0 ? options.endTime : simulation.GetTime() + options.delta * (double)options.steps;
+    if (endTime <= simulation.GetTime())
+        throw std::runtime_error("--work-precision needs --time or --steps");
+    std::vector<WorkPrecisionConfig> configs = BuildConfigs(options);
+    WorkPrecisionRunner runner(simulation, endTime);
+
+    // scalar kernels, vectorized ones trade the last bits for speed
+    SimulationSettings reference = options.settings;
+    reference.integrator = IntegratorType::Ias15;
+    reference.solver = SolverType::DirectSum;
+    reference.tolerance = options.referenceTolerance;
+    reference.vectorize = false;
+    double referenceDelta = options.deltas.empty() ? options.delta : *std::max_element(options.deltas.begin(), options.deltas.end());
+    runner.RunReference(reference, referenceDelta);
+    std::cout << "reference to t = " << endTime << " s in " << runner.GetReferenceSeconds() << " s, energy error "
+        << runner.GetReferenceEnergyError() << ", position error " << runner.GetReferencePositionError()
+        << " against a tenth of its tolerance, round-off limited " << runner.GetCheckRoundOffSteps() << " steps of that run" << std::endl;
+    // the tighter run stopping at round-off still checks the reference down to it, the reference itself has to converge
+    if (runner.GetReferenceRoundOffSteps() > 0)
+    {
+        throw std::runtime_error("Reference didn't converge, round-off kept " + std::to_string(runner.GetReferenceRoundOffSteps())
+            + " steps above tolerance, raise --reference-tolerance");
+    }
+
+    uint32_t finished = 0;
+    runner.Run(configs, [&](const WorkPrecisionResult& result)
+    {
+        finished++;
+        std::cout << result.config.label << " delta " << result.config.delta << " x" << result.config.stepCount << " ("
+            << finished << "/" << configs.size() << ") " << result.wallSeconds << " s, energy " << result.energyError
+            << ", angular momentum " << result.angularMomentumError << ", position " << result.relativePositionError << std::endl;
+    });
+
+    runner.WriteResults(options.workPrecision);
+    std::cout << configs.size() << " configurations written to " << options.workPrecision << std::endl;
+    return EXIT_SUCCESS;
+}
+
+static void Advance(Simulation& simulation, double endTime, double delta)
+{
+    while (simulation.GetTime() < endTime)
+        simulation.Step(std::min(delta, endTime - simulation.GetTime()));
+}
+
+/**
+ * @brief Integrator state that isn't saved shows up as a resumed run drifting away from one that never stopped.
+ * Both take the same steps, so anything short of identical bodies is a failure.
+ */
+static int RunResumeCheck(const Simulation& simulation, const HeadlessOptions& options)
+{
+    double endTime = options.endTime >= 0.0 ? options.endTime : simulation.GetTime() + options.delta * (double)options.steps;
+    if (endTime <= simulation.GetTime())
+        throw std::runtime_error("--check-resume needs --time or --steps");
+    double halfTime = simulation.GetTime() + 0.5 * (endTime - simulation.GetTime());
+
+    std::vector<int> integrators = options.integrators;
+    if (integrators.empty())
+    {
+        for (int i = 0; i < (int)std::size(IntegratorNames); i++)
+            integrators.push_back(i);
+    }
+
+    uint32_t failed = 0;
+    for (int integrator : integrators)
+    {
+        // simulations don't copy, the starting state goes through the checkpoint as well
+        Simulation straight;
+        SaveCheckpoint(options.checkResume, simulation);
+        LoadCheckpoint(options.checkResume, straight);
+        straight.GetSettings().integrator = integrator;
+        straight.GetSettings().threadCount = options.settings.threadCount;
+        Advance(straight, halfTime, options.delta);
+        SaveCheckpoint(options.checkResume, straight);
+        Advance(straight, endTime, options.delta);
+
+        Simulation resumed;
+        LoadCheckpoint(options.checkResume, resumed);
+        resumed.GetSettings().threadCount = options.settings.threadCount;
+        Advance(resumed, endTime, options.delta);
+
+        const BodyStore& expected = straight.GetBodies();
+        const BodyStore& actual = resumed.GetBodies();
+        bool identical = expected.GetCount() == actual.GetCount();
+        double positionDifference = 0.0;
+        for (uint32_t i = 0; identical && i < expected.GetCount(); i++)
+        {
+            positionDifference = std::max(positionDifference, glm::length(expected.GetPositions()[i] - actual.GetPositions()[i]));
+            identical = identical && expected.GetVelocities()[i] == actual.GetVelocities()[i];
+        }
+        identical = identical && positionDifference == 0.0;
+        failed += identical ? 0 : 1;
+
+        std::cout << IntegratorNames[integrator] << ": ";
+        if (identical)
+            std::cout << "resumed run identical" << std::endl;
+        else if (expected.GetCount() != actual.GetCount())
+            std::cout << "resumed run ended with " << actual.GetCount() << " bodies instead of " << expected.GetCount() << std::endl;
+        else
+            std::cout << "resumed run differs, positions by up to " << positionDifference << " km" << std::endl;
+    }
+    std::cout << failed << " of " << integrators.size() << " integrators don't resume exactly" << std::endl;
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int Run(int argc, char** argv)
+{
+    Simulation simulation;
+    HeadlessOptions options{};
+    options.settings = simulation.GetSettings(); // thread count defaults to every core
+    ParseOptions(argc, argv, options);
+
+    if (!options.resume.empty())
+    {
+        // checkpoint brings its own settings, flags given explicitly still win over them
+        LoadCheckpoint(options.resume, simulation);
+        options.settings = simulation.GetSettings();
+        ParseOptions(argc, argv, options);
+    }
+    else
+    {
+        if (!options.generate || options.generator.type == GeneratorType::AsteroidBelt)
+            LoadScenario(options.scenario, simulation);
+        if (options.generate)
+            Generate(options.generator, simulation);
+    }
+    simulation.GetSettings() = options.settings;
+    std::string source = options.resume.empty() ? options.scenario : options.resume;
+    if (options.generate)
+    {
+        bool belt = options.generator.type == GeneratorType::AsteroidBelt;
+        source = belt ? source + " with a generated belt" : std::string("the ") + GeneratorNames[options.generator.type] + " generator";
+    }
+    std::cout << "Loaded " << simulation.GetBodies().GetCount() << " bodies and " << simulation.GetParticles().GetCount() 
+        << " particles at t = " << simulation.GetTime() << " s from " << source << std::endl;
+    if (options.ensemble > 0)
+        return RunEnsemble(simulation, options);
+    if (!options.workPrecision.empty())
+        return RunWorkPrecision(simulation, options);
+    if (!options.checkResume.empty())
+        return RunResumeCheck(simulation, options);
+
+    CheckpointWriter checkpoints;
+    if (options.checkpointEvery > 0)
+        checkpoints.Start(options.checkpoint, options.keep, options.compress);
+    TrajectoryRecorder recorder;
+    if (!options.record.empty())
+    {
+        recorder.Open(options.record, options.recordEvery);
+        recorder.Record(simulation.GetBodies(), simulation.GetTime());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t step = 0;
+    while (true)
+    {
+        double delta = options.delta;
+        if (options.endTime >= 0.0)
+        {
+            double remaining = options.endTime - simulation.GetTime();
+            if (remaining <= 0.0)
+                break;
+            delta = std::min(delta, remaining);
+        }
+        else if (step >= options.steps)
+            break;
+
+        simulation.Step(delta);
+        step++;
+        if (recorder.IsOpen())
+            recorder.Record(simulation.GetBodies(), simulation.GetTime());
+        if (options.checkpointEvery > 0 && step % options.checkpointEvery == 0)
+            checkpoints.Capture(simulation);
+
+        if (options.progressEvery > 0 && step % options.progressEvery == 0)
+        {
+            std::cout << "step " << step << " time " << simulation.GetTime() << " s, " 
+                << simulation.GetBodies().GetCount() << " bodies" << std::endl;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    SaveScenario(options.output, simulation);
+    if (recorder.IsOpen())
+    {
+        recorder.Close();
+        std::cout << recorder.GetFrameCount() << " frames recorded, " << recorder.GetBytesWritten() << " bytes written to "
+            << options.record << std::endl;
+    }
+    if (!options.ephemeris.empty())
+    {
+        // same segments the viewer picks when it fits a recording itself
+        TrajectoryReader reader;
+        reader.Open(options.record);
+        Ephemeris ephemeris;
+        ephemeris.Build(reader);
+        ephemeris.Save(options.ephemeris);
+        std::cout << ephemeris.GetSegmentCount() << " ephemeris segments, fit within " << ephemeris.GetMaxFitError() << " km, written to "
+            << options.ephemeris << std::endl;
+    }
+    if (options.checkpointEvery > 0)
+    {
+        checkpoints.Capture(simulation);
+        checkpoints.Stop();
+        CheckpointMetrics metrics = checkpoints.GetMetrics();
+        std::cout << metrics.written << " checkpoints written, " << metrics.skipped << " skipped, " << metrics.failed 
+            << " failed, last one " << metrics.fileBytes << " bytes, pause " << metrics.pause * 1000.0 << " ms (max "
+            << metrics.maxPause * 1000.0 << " ms), write " << metrics.writeTime * 1000.0 << " ms" << std::endl;
+        if (metrics.failed > 0)
+            throw std::runtime_error(metrics.lastError);
+    }
+    else if (!options.checkpoint.empty())
+    {
+        SaveCheckpoint(options.checkpoint, simulation, options.compress);
+    }
+    std::cout << step << " steps to t = " << simulation.GetTime() << " s in " << seconds << " s, state written to " 
+        << options.output << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    try 
+    {
+        return Run(argc, argv);
+    }
+    catch(const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
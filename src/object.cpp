@@ -8,6 +8,7 @@
 #include <stbimage/stb_image.h>
 
 #include <iostream>
+#include <algorithm>
 
 Object::Object(uint32_t ID, ObjectInfo objInfo, const std::string& modelfilepath, Transform transform, 
     Properties properties, const std::string& textureFilepath)
@@ -94,11 +95,11 @@ void Object::DrawOrbit(VkCommandBuffer commandBuffer)
     }
 }
 
-void Object::OrbitUpdate(VkCommandBuffer commandBuffer)
+void Object::OrbitUpdate(VkCommandBuffer commandBuffer, const glm::dvec3& position)
 {
     if (m_Properties.orbitTraceLenght > 0)
     {
-        m_OrbitPositions[m_Count] = {m_Transform.translation/SCALE_DOWN};
+        m_OrbitPositions[m_Count] = {position/SCALE_DOWN};
 
         m_OrbitModel->UpdateBuffer(commandBuffer, m_OrbitModel->GetVertexBuffer(), m_Count * sizeof(CustomModelPosOnly::Vertex), sizeof(CustomModelPosOnly::Vertex), (void*)&m_OrbitPositions[m_Count]);
         
@@ -124,4 +125,38 @@ void Object::OrbitUpdate(VkCommandBuffer commandBuffer)
         
         m_Count = (m_Count+1) % m_Properties.orbitTraceLenght;
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Replaces the whole orbit trace, positions go from oldest to newest. Must be recorded outside of a render pass.
+ */
+void Object::ResetOrbit(VkCommandBuffer commandBuffer, const std::vector<glm::dvec3>& positions)
+{
+    if (m_Properties.orbitTraceLenght == 0 || positions.empty())
+        return;
+
+    for (uint32_t i = 0; i < m_Properties.orbitTraceLenght; i++)
+    {
+        m_OrbitPositions[i] = {positions[std::min<size_t>(i, positions.size() - 1)]/SCALE_DOWN};
+    }
+
+    // vkCmdUpdateBuffer takes at most 65536 bytes at once
+    const uint32_t maxUpdateSize = 65536;
+    uint32_t vertexBytes = (uint32_t)(m_OrbitPositions.size() * sizeof(CustomModelPosOnly::Vertex));
+    for (uint32_t offset = 0; offset < vertexBytes; offset += maxUpdateSize)
+    {
+        m_OrbitModel->UpdateBuffer(commandBuffer, m_OrbitModel->GetVertexBuffer(), offset, std::min(maxUpdateSize, vertexBytes - offset), 
+            (const char*)m_OrbitPositions.data() + offset
+        );
+    }
+
+    // initial indices draw the ring from 0 to the end in one strip, next OrbitUpdate overwrites the oldest point at 0
+    uint32_t indexBytes = (uint32_t)(m_IndexPositions.size() * sizeof(uint32_t));
+    for (uint32_t offset = 0; offset < indexBytes; offset += maxUpdateSize)
+    {
+        m_OrbitModel->UpdateBuffer(commandBuffer, m_OrbitModel->GetIndexBuffer(), offset, std::min(maxUpdateSize, indexBytes - offset), 
+            (const char*)m_IndexPositions.data() + offset
+        );
+    }
+    m_Count = 0;
+}
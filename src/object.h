@@ -53,6 +53,11 @@ struct Properties
     double inclination;
 };
 
+/**
+ * @brief Render side of a body. Meshes, descriptor sets and orbit traces live here,
+ * position, velocity, mass and rotation are stored in BodyStore.
+ * @note m_Transform and m_Properties only hold initial conditions after the body is added to BodyStore.
+*/
 class Object
 {
 public:
@@ -61,7 +66,8 @@ public:
     );
     void Draw(VkPipelineLayout layout, VkCommandBuffer commandBuffer);
     void DrawOrbit(VkCommandBuffer commandBuffer);
-    void OrbitUpdate(VkCommandBuffer commandBuffer);
+    void OrbitUpdate(VkCommandBuffer commandBuffer, const glm::dvec3& position);
+    void ResetOrbit(VkCommandBuffer commandBuffer, const std::vector<glm::dvec3>& positions);
     inline Transform& GetObjectTransform() { return m_Transform; }
     inline Properties& GetObjectProperties() { return m_Properties; }
     inline uint32_t GetObjectID() { return m_ID; }
@@ -0,0 +1,98 @@
+#include "barnesHutSolver.h"
+
+#include <cmath>
+#include <algorithm>
+
+BarnesHutSolver::BarnesHutSolver(float openingAngle)
+    : m_OpeningAngle(openingAngle)
+{
+
+}
+
+void BarnesHutSolver::ComputeAccelerations(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+    std::vector<glm::dvec3>& accelerations)
+{
+    uint32_t count = (uint32_t)positions.size();
+    accelerations.assign(count, glm::dvec3(0.0));
+    if (count < 2)
+        return;
+
+    m_Tree.Build(positions, masses, LEAF_CAPACITY);
+
+    // every body walks the tree on its own and writes only its own acceleration
+    if (m_ThreadPool)
+    {
+        uint32_t chunks = (count + WALK_CHUNK_SIZE - 1) / WALK_CHUNK_SIZE;
+        m_ThreadPool->ParallelFor(chunks, [&](uint32_t chunk)
+        {
+            uint32_t end = std::min((chunk + 1) * WALK_CHUNK_SIZE, count);
+            for (uint32_t i = chunk * WALK_CHUNK_SIZE; i < end; i++)
+                accelerations[i] = ComputeAcceleration(i, positions, masses);
+        });
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        accelerations[i] = ComputeAcceleration(i, positions, masses);
+    }
+}
+
+glm::dvec3 BarnesHutSolver::ComputeAcceleration(uint32_t body, const std::vector<glm::dvec3>& positions, const std::vector<double>& masses)
+{
+    const glm::dvec3& position = positions[body];
+    double openingAngleSquared = (double)m_OpeningAngle * (double)m_OpeningAngle;
+    glm::dvec3 acceleration{0.0};
+    auto& nodes = m_Tree.GetNodes();
+    auto& order = m_Tree.GetOrder();
+
+    uint32_t stack[Octree::MAX_DEPTH * 8 + 8];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const Octree::Node& node = nodes[stack[--stackSize]];
+        if (node.mass <= 0.0)
+            continue;
+
+        if (node.leaf)
+        {
+            for (uint32_t i = node.firstBody; i < node.firstBody + node.bodyCount; i++)
+            {
+                uint32_t other = order[i];
+                if (other == body)
+                    continue;
+
+                glm::dvec3 offset = positions[other] - position;
+                double distanceSquared = glm::dot(offset, offset);
+                if (distanceSquared <= 0.0)
+                    continue;
+                double inverseDistance = 1.0 / std::sqrt(distanceSquared);
+                acceleration += offset * (masses[other] * inverseDistance * inverseDistance * inverseDistance);
+            }
+            continue;
+        }
+
+        glm::dvec3 offset = node.centerOfMass - position;
+        double distanceSquared = glm::dot(offset, offset);
+        double size = node.halfSize * 2.0;
+        glm::dvec3 fromCenter = glm::abs(position - node.center);
+        bool inside = fromCenter.x <= node.halfSize && fromCenter.y <= node.halfSize && fromCenter.z <= node.halfSize;
+
+        // far enough, whole node acts like one body at its center of mass
+        if (!inside && size * size < openingAngleSquared * distanceSquared)
+        {
+            double inverseDistance = 1.0 / std::sqrt(distanceSquared);
+            acceleration += offset * (node.mass * inverseDistance * inverseDistance * inverseDistance);
+            continue;
+        }
+
+        for (uint32_t octant = 0; octant < 8; octant++)
+        {
+            if (node.children[octant] >= 0)
+                stack[stackSize++] = (uint32_t)node.children[octant];
+        }
+    }
+
+    return acceleration * GRAVITATIONAL_CONSTANT;
+}
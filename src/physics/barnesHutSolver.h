@@ -0,0 +1,31 @@
+#pragma once
+
+#include "gravitySolver.h"
+#include "octree.h"
+
+/**
+ * @brief Barnes-Hut tree code. Octree is rebuilt every evaluation and far away nodes
+ * are approximated by their center of mass, which gives O(N log N) force evaluation.
+ * @note Opening angle controls accuracy, node is opened when size / distance >= theta.
+ * 0 degenerates to direct summation, 0.5 - 0.7 is the usual trade-off.
+ */
+class BarnesHutSolver : public GravitySolver
+{
+public:
+    BarnesHutSolver(float openingAngle = 0.5f);
+
+    void ComputeAccelerations(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+        std::vector<glm::dvec3>& accelerations
+    ) override;
+
+    inline void SetOpeningAngle(float openingAngle) { m_OpeningAngle = openingAngle; }
+    inline float GetOpeningAngle() const { return m_OpeningAngle; }
+private:
+    static constexpr uint32_t LEAF_CAPACITY = 8;
+    static constexpr uint32_t WALK_CHUNK_SIZE = 256;
+
+    glm::dvec3 ComputeAcceleration(uint32_t body, const std::vector<glm::dvec3>& positions, const std::vector<double>& masses);
+
+    float m_OpeningAngle;
+    Octree m_Tree;
+};
@@ -0,0 +1,192 @@
+#include "bodyStore.h"
+
+#include <cassert>
+#include <algorithm>
+
+BodyHandle BodyStore::Add(const glm::dvec3& position, const glm::dvec3& velocity, double mass, double radius,
+    const glm::dvec3& rotation, const glm::dvec3& rotationSpeed)
+{
+    uint32_t slotIndex;
+    if (!m_FreeSlots.empty())
+    {
+        slotIndex = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+    }
+    else
+    {
+        slotIndex = (uint32_t)m_Slots.size();
+        m_Slots.push_back({});
+    }
+
+    Slot& slot = m_Slots[slotIndex];
+    slot.denseIndex = GetCount();
+    slot.alive = true;
+
+    BodyHandle handle{slotIndex, slot.generation};
+
+    m_Positions.push_back(position);
+    m_Velocities.push_back(velocity);
+    m_Masses.push_back(mass);
+    m_Radii.push_back(radius);
+    m_Rotations.push_back(rotation);
+    m_RotationSpeeds.push_back(rotationSpeed);
+    m_Handles.push_back(handle);
+
+    return handle;
+}
+
+uint32_t BodyStore::Append(uint32_t count)
+{
+    uint32_t first = GetCount();
+    size_t total = (size_t)first + count;
+    m_Positions.resize(total, glm::dvec3(0.0));
+    m_Velocities.resize(total, glm::dvec3(0.0));
+    m_Masses.resize(total, 0.0);
+    m_Radii.resize(total, 0.0);
+    m_Rotations.resize(total, glm::dvec3(0.0));
+    m_RotationSpeeds.resize(total, glm::dvec3(0.0));
+    m_Handles.reserve(total);
+
+    for (uint32_t i = first; i < total; i++)
+    {
+        uint32_t slotIndex;
+        if (!m_FreeSlots.empty())
+        {
+            slotIndex = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+        else
+        {
+            slotIndex = (uint32_t)m_Slots.size();
+            m_Slots.push_back({});
+        }
+
+        Slot& slot = m_Slots[slotIndex];
+        slot.denseIndex = i;
+        slot.alive = true;
+        m_Handles.push_back({slotIndex, slot.generation});
+    }
+    return first;
+}
+
+/**
+ * @brief Removes body by moving the last one into its place, nothing else is rebuilt
+ */
+void BodyStore::Remove(BodyHandle handle)
+{
+    assert(IsValid(handle) && "Trying to remove body that doesn't exist");
+
+    Slot& slot = m_Slots[handle.index];
+    uint32_t index = slot.denseIndex;
+    uint32_t last = GetCount() - 1;
+
+    if (index != last)
+    {
+        m_Positions[index] = m_Positions[last];
+        m_Velocities[index] = m_Velocities[last];
+        m_Masses[index] = m_Masses[last];
+        m_Radii[index] = m_Radii[last];
+        m_Rotations[index] = m_Rotations[last];
+        m_RotationSpeeds[index] = m_RotationSpeeds[last];
+        m_Handles[index] = m_Handles[last];
+        m_Slots[m_Handles[index].index].denseIndex = index;
+    }
+
+    m_Positions.pop_back();
+    m_Velocities.pop_back();
+    m_Masses.pop_back();
+    m_Radii.pop_back();
+    m_Rotations.pop_back();
+    m_RotationSpeeds.pop_back();
+    m_Handles.pop_back();
+
+    slot.alive = false;
+    slot.generation++;
+    m_FreeSlots.push_back(handle.index);
+}
+
+void BodyStore::Clear()
+{
+    m_Positions.clear();
+    m_Velocities.clear();
+    m_Masses.clear();
+    m_Radii.clear();
+    m_Rotations.clear();
+    m_RotationSpeeds.clear();
+    // keep slots around and bump their generation so old handles stay invalid
+    for (BodyHandle handle : m_Handles)
+    {
+        m_Slots[handle.index].alive = false;
+        m_Slots[handle.index].generation++;
+        m_FreeSlots.push_back(handle.index);
+    }
+    m_Handles.clear();
+}
+
+void BodyStore::Reserve(uint32_t count)
+{
+    m_Positions.reserve(count);
+    m_Velocities.reserve(count);
+    m_Masses.reserve(count);
+    m_Radii.reserve(count);
+    m_Rotations.reserve(count);
+    m_RotationSpeeds.reserve(count);
+    m_Handles.reserve(count);
+}
+
+std::vector<uint32_t> BodyStore::GetSlotGenerations() const
+{
+    std::vector<uint32_t> generations(m_Slots.size());
+    for (size_t i = 0; i < m_Slots.size(); i++)
+        generations[i] = m_Slots[i].generation;
+    return generations;
+}
+
+void BodyStore::RestoreSlots(const std::vector<BodyHandle>& handles, const std::vector<uint32_t>& generations, const std::vector<uint32_t>& freeSlots)
+{
+    assert(handles.size() == GetCount() && "Every body needs a handle");
+
+    m_Handles = handles;
+    m_FreeSlots = freeSlots;
+    m_Slots.assign(generations.size(), {});
+    for (size_t i = 0; i < generations.size(); i++)
+        m_Slots[i].generation = generations[i];
+    for (uint32_t i = 0; i < GetCount(); i++)
+    {
+        Slot& slot = m_Slots[handles[i].index];
+        slot.denseIndex = i;
+        slot.alive = true;
+    }
+}
+
+void BodyStore::RestoreSlots(const std::vector<BodyHandle>& handles)
+{
+    uint32_t slotCount = 0;
+    for (BodyHandle handle : handles)
+        slotCount = std::max(slotCount, handle.index + 1);
+    std::vector<uint32_t> generations(slotCount, 0);
+    std::vector<uint8_t> used(slotCount, 0);
+    for (BodyHandle handle : handles)
+    {
+        generations[handle.index] = handle.generation;
+        used[handle.index] = 1;
+    }
+    std::vector<uint32_t> freeSlots;
+    for (uint32_t i = 0; i < slotCount; i++)
+    {
+        if (!used[i])
+            freeSlots.push_back(i);
+    }
+    RestoreSlots(handles, generations, freeSlots);
+}
+
+bool BodyStore::IsValid(BodyHandle handle) const
+{
+    return handle.index < m_Slots.size() && m_Slots[handle.index].alive && m_Slots[handle.index].generation == handle.generation;
+}
+
+uint32_t BodyStore::GetIndex(BodyHandle handle) const
+{
+    assert(IsValid(handle) && "Invalid body handle");
+    return m_Slots[handle.index].denseIndex;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Stable reference to a body inside BodyStore.
+ * @note Index points into the slot table, not into the dense arrays. Generation is bumped
+ * every time a slot is freed so handles to removed bodies can be detected.
+ */
+struct BodyHandle
+{
+    uint32_t index = 0xFFFFFFFF;
+    uint32_t generation = 0;
+
+    bool operator==(const BodyHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const BodyHandle& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Dense structure of arrays holding everything physics touches every step.
+ * Positions are in km, velocities in km/s, masses in kg, radii in km, rotations in radians.
+ * @note Arrays are always packed, removing a body moves the last one into its place so
+ * dense indices are not stable. Use BodyHandle to refer to a body across frames.
+ */
+class BodyStore
+{
+public:
+    BodyHandle Add(const glm::dvec3& position, const glm::dvec3& velocity, double mass, double radius,
+        const glm::dvec3& rotation = glm::dvec3(0.0), const glm::dvec3& rotationSpeed = glm::dvec3(0.0)
+    );
+    /**
+     * @brief Adds count bodies with everything zeroed in one go, for loaders that fill the arrays in place
+     * @return dense index of the first new body
+     */
+    uint32_t Append(uint32_t count);
+    void Remove(BodyHandle handle);
+    void Clear();
+    void Reserve(uint32_t count);
+
+    bool IsValid(BodyHandle handle) const;
+    uint32_t GetIndex(BodyHandle handle) const;
+    inline BodyHandle GetHandle(uint32_t index) const { return m_Handles[index]; }
+    inline uint32_t GetCount() const { return (uint32_t)m_Positions.size(); }
+
+    inline std::vector<glm::dvec3>& GetPositions() { return m_Positions; }
+    inline std::vector<glm::dvec3>& GetVelocities() { return m_Velocities; }
+    inline std::vector<double>& GetMasses() { return m_Masses; }
+    inline std::vector<double>& GetRadii() { return m_Radii; }
+    inline std::vector<glm::dvec3>& GetRotations() { return m_Rotations; }
+    inline std::vector<glm::dvec3>& GetRotationSpeeds() { return m_RotationSpeeds; }
+
+    inline const std::vector<glm::dvec3>& GetPositions() const { return m_Positions; }
+    inline const std::vector<glm::dvec3>& GetVelocities() const { return m_Velocities; }
+    inline const std::vector<double>& GetMasses() const { return m_Masses; }
+    inline const std::vector<double>& GetRadii() const { return m_Radii; }
+    inline const std::vector<glm::dvec3>& GetRotations() const { return m_Rotations; }
+    inline const std::vector<glm::dvec3>& GetRotationSpeeds() const { return m_RotationSpeeds; }
+
+    /**
+     * @brief Slot map as plain arrays so it can be saved next to the dense ones and handles stay valid across restarts
+     */
+    inline const std::vector<BodyHandle>& GetHandles() const { return m_Handles; }
+    inline const std::vector<uint32_t>& GetFreeSlots() const { return m_FreeSlots; }
+    std::vector<uint32_t> GetSlotGenerations() const;
+    /**
+     * @brief Rebuilds slot map after dense arrays were filled in bulk, handles[i] belongs to body i
+     */
+    void RestoreSlots(const std::vector<BodyHandle>& handles, const std::vector<uint32_t>& generations, const std::vector<uint32_t>& freeSlots);
+    /**
+     * @brief Same for bodies that come with nothing but their handles, slots none of them use are free
+     */
+    void RestoreSlots(const std::vector<BodyHandle>& handles);
+private:
+    struct Slot
+    {
+        uint32_t denseIndex = 0;
+        uint32_t generation = 0;
+        bool alive = false;
+    };
+
+    // hot data, iterated by the force loop
+    std::vector<glm::dvec3> m_Positions;
+    std::vector<glm::dvec3> m_Velocities;
+    std::vector<double> m_Masses;
+    std::vector<double> m_Radii;
+
+    // only touched once per substep
+    std::vector<glm::dvec3> m_Rotations;
+    std::vector<glm::dvec3> m_RotationSpeeds;
+
+    // slot map, dense index -> handle and handle -> dense index
+    std::vector<BodyHandle> m_Handles;
+    std::vector<Slot> m_Slots;
+    std::vector<uint32_t> m_FreeSlots;
+};
@@ -0,0 +1,234 @@
+#include "checkpoint.h"
+#include "compression.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+static_assert(sizeof(glm::dvec3) == 3 * sizeof(double), "Checkpoint arrays are written as packed doubles");
+static_assert(sizeof(BodyHandle) == 2 * sizeof(uint32_t), "Checkpoint handles are written as uint32 pairs");
+
+namespace
+{
+    constexpr char MAGIC[8] = { 'G', 'R', 'A', 'V', 'C', 'K', 'P', 'T' };
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr uint32_t FLAG_COMPRESSED = 0x1;
+
+    struct CheckpointHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t flags;
+        uint32_t bodyCount;
+        uint32_t slotCount;
+        uint32_t freeSlotCount;
+        uint32_t particleCount;
+        uint32_t integratorStateCount;
+        double time;
+
+        // settings, thread count is left out on purpose
+        int32_t integrator;
+        int32_t solver;
+        int32_t expansionOrder;
+        uint32_t collisions;
+        double tolerance;
+        double perturbationThreshold;
+        double openingAngle;
+
+        uint64_t payloadSize; // bytes following the header
+        uint64_t rawSize; // bytes of the arrays once unpacked
+        uint64_t checksum; // of the unpacked arrays
+    };
+
+    template<typename T>
+    void Append(std::vector<uint8_t>& payload, const std::vector<T>& values)
+    {
+        const uint8_t* begin = reinterpret_cast<const uint8_t*>(values.data());
+        payload.insert(payload.end(), begin, begin + values.size() * sizeof(T));
+    }
+
+    template<typename T>
+    void Take(const std::vector<uint8_t>& payload, size_t& offset, std::vector<T>& values, size_t count)
+    {
+        values.resize(count);
+        if (count > 0)
+            std::memcpy(values.data(), payload.data() + offset, count * sizeof(T));
+        offset += count * sizeof(T);
+    }
+}
+
+void CaptureCheckpoint(const Simulation& simulation, CheckpointData& data)
+{
+    const BodyStore& bodies = simulation.GetBodies();
+    const TestParticles& particles = simulation.GetParticles();
+    const SimulationSettings& settings = simulation.GetSettings();
+    std::vector<double> integratorState = simulation.SaveIntegratorState();
+    std::vector<uint32_t> generations = bodies.GetSlotGenerations();
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.bodyCount = bodies.GetCount();
+    header.slotCount = (uint32_t)generations.size();
+    header.freeSlotCount = (uint32_t)bodies.GetFreeSlots().size();
+    header.particleCount = particles.GetCount();
+    header.integratorStateCount = (uint32_t)integratorState.size();
+    header.time = simulation.GetTime();
+    header.integrator = settings.integrator;
+    header.solver = settings.solver;
+    header.expansionOrder = settings.expansionOrder;
+    header.collisions = settings.collisions ? 1 : 0;
+    header.tolerance = settings.tolerance;
+    header.perturbationThreshold = settings.perturbationThreshold;
+    header.openingAngle = settings.openingAngle;
+
+    // capacity of the previous capture is reused, after the first one this is a memcpy per array
+    std::vector<uint8_t>& bytes = data.bytes;
+    bytes.clear();
+    bytes.insert(bytes.end(), reinterpret_cast<const uint8_t*>(&header), reinterpret_cast<const uint8_t*>(&header) + sizeof(header));
+    // 8 byte arrays first, 4 byte ones after them can't break alignment
+    Append(bytes, bodies.GetPositions());
+    Append(bytes, bodies.GetVelocities());
+    Append(bytes, bodies.GetMasses());
+    Append(bytes, bodies.GetRadii());
+    Append(bytes, bodies.GetRotations());
+    Append(bytes, bodies.GetRotationSpeeds());
+    Append(bytes, particles.GetPositions());
+    Append(bytes, particles.GetVelocities());
+    Append(bytes, integratorState);
+    Append(bytes, bodies.GetHandles());
+    Append(bytes, generations);
+    Append(bytes, bodies.GetFreeSlots());
+    data.time = header.time;
+}
+
+uint64_t WriteCheckpoint(const std::string& filepath, const CheckpointData& data, bool compress)
+{
+    if (data.bytes.size() < sizeof(CheckpointHeader))
+        throw std::runtime_error("Nothing was captured for checkpoint " + filepath);
+
+    CheckpointHeader header;
+    std::memcpy(&header, data.bytes.data(), sizeof(header));
+    const uint8_t* arrays = data.bytes.data() + sizeof(header);
+    header.rawSize = data.bytes.size() - sizeof(header);
+    header.checksum = HashBytes(arrays, header.rawSize);
+    header.payloadSize = header.rawSize;
+
+    std::vector<uint8_t> compressed;
+    if (compress)
+    {
+        compressed = CompressRuns(ShuffleBytes(arrays, header.rawSize));
+        // noisy mantissas don't compress, literal markers would only make the file bigger
+        if (compressed.size() < header.rawSize)
+        {
+            header.flags |= FLAG_COMPRESSED;
+            header.payloadSize = compressed.size();
+            arrays = compressed.data();
+        }
+    }
+
+    std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open checkpoint file " + filepath);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(arrays), (std::streamsize)header.payloadSize);
+    if (!file.good())
+        throw std::runtime_error("Failed to write checkpoint file " + filepath);
+    return sizeof(header) + header.payloadSize;
+}
+
+void SaveCheckpoint(const std::string& filepath, const Simulation& simulation, bool compress)
+{
+    CheckpointData data;
+    CaptureCheckpoint(simulation, data);
+    WriteCheckpoint(filepath, data, compress);
+}
+
+void LoadCheckpoint(const std::string& filepath, Simulation& simulation)
+{
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open checkpoint file " + filepath);
+
+    size_t fileSize = (size_t)file.tellg();
+    if (fileSize < sizeof(CheckpointHeader))
+        throw std::runtime_error(filepath + " is not a checkpoint");
+
+    // the whole file in a single read, header is copied out and arrays sit right behind it
+    std::vector<uint8_t> buffer(fileSize);
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(buffer.data()), (std::streamsize)fileSize))
+        throw std::runtime_error("Failed to read checkpoint file " + filepath);
+
+    CheckpointHeader header;
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error(filepath + " is not a checkpoint");
+    if (header.byteOrder != BYTE_ORDER_MARK)
+        throw std::runtime_error(filepath + " was written on a machine with different byte order");
+    if (header.version != CHECKPOINT_VERSION)
+    {
+        throw std::runtime_error(filepath + " has checkpoint version " + std::to_string(header.version)
+            + ", expected " + std::to_string(CHECKPOINT_VERSION));
+    }
+    if (header.payloadSize != fileSize - sizeof(header))
+        throw std::runtime_error(filepath + " is truncated");
+
+    size_t expectedSize = (size_t)header.bodyCount * (4 * sizeof(glm::dvec3) + 2 * sizeof(double) + sizeof(BodyHandle))
+        + (size_t)header.particleCount * 2 * sizeof(glm::dvec3) + (size_t)header.integratorStateCount * sizeof(double)
+        + ((size_t)header.slotCount + header.freeSlotCount) * sizeof(uint32_t);
+    if (header.rawSize != expectedSize)
+        throw std::runtime_error(filepath + " is damaged");
+
+    std::vector<uint8_t> payload;
+    if (header.flags & FLAG_COMPRESSED)
+    {
+        std::vector<uint8_t> unpacked = DecompressRuns(buffer.data() + sizeof(header), header.payloadSize, header.rawSize);
+        payload = UnshuffleBytes(unpacked.data(), unpacked.size());
+        if (payload.size() != header.rawSize)
+            throw std::runtime_error(filepath + " is damaged");
+    }
+    else
+    {
+        buffer.erase(buffer.begin(), buffer.begin() + sizeof(header));
+        payload = std::move(buffer);
+    }
+    if (HashBytes(payload.data(), payload.size()) != header.checksum)
+        throw std::runtime_error(filepath + " failed checksum");
+
+    // everything is validated, only from here on the simulation is touched
+    BodyStore& bodies = simulation.GetBodies();
+    TestParticles& particles = simulation.GetParticles();
+    std::vector<double> integratorState;
+    std::vector<BodyHandle> handles;
+    std::vector<uint32_t> generations, freeSlots;
+    size_t offset = 0;
+    Take(payload, offset, bodies.GetPositions(), header.bodyCount);
+    Take(payload, offset, bodies.GetVelocities(), header.bodyCount);
+    Take(payload, offset, bodies.GetMasses(), header.bodyCount);
+    Take(payload, offset, bodies.GetRadii(), header.bodyCount);
+    Take(payload, offset, bodies.GetRotations(), header.bodyCount);
+    Take(payload, offset, bodies.GetRotationSpeeds(), header.bodyCount);
+    particles.Resize(header.particleCount);
+    Take(payload, offset, particles.GetPositions(), header.particleCount);
+    Take(payload, offset, particles.GetVelocities(), header.particleCount);
+    Take(payload, offset, integratorState, header.integratorStateCount);
+    Take(payload, offset, handles, header.bodyCount);
+    Take(payload, offset, generations, header.slotCount);
+    Take(payload, offset, freeSlots, header.freeSlotCount);
+    bodies.RestoreSlots(handles, generations, freeSlots);
+
+    SimulationSettings& settings = simulation.GetSettings();
+    settings.integrator = header.integrator;
+    settings.solver = header.solver;
+    settings.expansionOrder = header.expansionOrder;
+    settings.collisions = header.collisions != 0;
+    settings.tolerance = (float)header.tolerance;
+    settings.perturbationThreshold = (float)header.perturbationThreshold;
+    settings.openingAngle = (float)header.openingAngle;
+    simulation.SetTime(header.time);
+    simulation.LoadIntegratorState(integratorState);
+}
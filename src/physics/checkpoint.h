@@ -0,0 +1,57 @@
+#pragma once
+
+#include "simulation.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#define CHECKPOINT_VERSION 1
+
+/**
+ * @brief Binary snapshot of everything needed to continue a run exactly where it stopped: bodies with
+ * their handles, test particles, time, settings and integrator state.
+ *
+ * Layout is a fixed size header followed by raw arrays in a fixed order, 8 byte values first so every
+ * array stays aligned. Loading is one read of the whole file and a memcpy per array, nothing is parsed.
+ * Compressed files shuffle bytes by significance and run length encode them, exponents and the many
+ * zeros in rotations compress well, mantissas don't. They are smaller but have to be unpacked first,
+ * when compression wouldn't make the file smaller it is written raw.
+ *
+ * @note Arrays are stored in native byte order, the header refuses files from the other endianness.
+ */
+
+/**
+ * @brief State copied out of a simulation, header followed by the raw arrays
+ */
+struct CheckpointData
+{
+    std::vector<uint8_t> bytes;
+    double time = 0.0; // seconds
+};
+
+/**
+ * @brief Copies state into data reusing its capacity, costs about a memcpy of the arrays. Checksum and
+ * compression are left to WriteCheckpoint so they can run on another thread.
+ */
+void CaptureCheckpoint(const Simulation& simulation, CheckpointData& data);
+
+/**
+ * @return bytes written
+ * @throws std::runtime_error when the file can't be written
+ */
+uint64_t WriteCheckpoint(const std::string& filepath, const CheckpointData& data, bool compress = false);
+
+/**
+ * @brief Capture and write in one go on the calling thread
+ * @throws std::runtime_error when the file can't be written
+ */
+void SaveCheckpoint(const std::string& filepath, const Simulation& simulation, bool compress = false);
+
+/**
+ * @brief Replaces bodies, particles, time, settings and integrator state. Thread count is machine
+ * specific and kept as it is.
+ * @throws std::runtime_error when the file can't be read, is from another version or is damaged,
+ * simulation is left untouched then
+ */
+void LoadCheckpoint(const std::string& filepath, Simulation& simulation);
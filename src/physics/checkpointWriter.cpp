@@ -0,0 +1,122 @@
+#include "checkpointWriter.h"
+
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+
+CheckpointWriter::~CheckpointWriter()
+{
+    Stop();
+}
+
+void CheckpointWriter::Start(const std::string& filepath, uint32_t keep, bool compress)
+{
+    if (m_Thread.joinable())
+        return;
+
+    m_Filepath = filepath;
+    m_Keep = std::max(keep, 1u);
+    m_Compress = compress;
+    m_Quit = false;
+    m_Thread = std::thread(&CheckpointWriter::Run, this);
+}
+
+void CheckpointWriter::Stop()
+{
+    if (!m_Thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_Wake.notify_one();
+    m_Thread.join();
+}
+
+void CheckpointWriter::Capture(const Simulation& simulation)
+{
+    auto start = std::chrono::steady_clock::now();
+    {
+        // worker only holds the lock to swap buffers, this never waits for a disk write
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_HasPending)
+            m_Metrics.skipped++;
+        CaptureCheckpoint(simulation, m_Pending);
+        m_HasPending = true;
+
+        double pause = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        m_Metrics.pause = pause;
+        m_Metrics.maxPause = std::max(m_Metrics.maxPause, pause);
+    }
+    m_Wake.notify_one();
+}
+
+CheckpointMetrics CheckpointWriter::GetMetrics() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Metrics;
+}
+
+void CheckpointWriter::Run()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait(lock, [this]() { return m_Quit || m_HasPending; });
+            if (!m_HasPending)
+                return;
+            std::swap(m_Pending, m_Writing);
+            m_HasPending = false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t fileBytes = 0;
+        std::string error;
+        try
+        {
+            // written next to the real file first, a crash mid write never leaves a broken newest checkpoint
+            fileBytes = WriteCheckpoint(m_Filepath + ".tmp", m_Writing, m_Compress);
+            Rotate();
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        double writeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (error.empty())
+        {
+            m_Metrics.written++;
+            m_Metrics.writeTime = writeTime;
+            m_Metrics.rawBytes = m_Writing.bytes.size();
+            m_Metrics.fileBytes = fileBytes;
+            m_Metrics.time = m_Writing.time;
+        }
+        else
+        {
+            m_Metrics.failed++;
+            m_Metrics.lastError = error;
+        }
+    }
+}
+
+/**
+ * @brief Shifts filepath.i to filepath.(i + 1), dropping the oldest, and moves the new file into place
+ */
+void CheckpointWriter::Rotate()
+{
+    namespace fs = std::filesystem;
+    auto rotated = [this](uint32_t index) { return index == 0 ? m_Filepath : m_Filepath + "." + std::to_string(index); };
+
+    std::error_code error;
+    fs::remove(rotated(m_Keep - 1), error);
+    for (uint32_t i = m_Keep - 1; i > 0; i--)
+    {
+        if (fs::exists(rotated(i - 1)))
+            fs::rename(rotated(i - 1), rotated(i));
+    }
+    fs::rename(m_Filepath + ".tmp", m_Filepath);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "checkpoint.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+
+/**
+ * @brief How the last checkpoints went, pause is what the simulation thread paid, the rest happened on the writer
+ */
+struct CheckpointMetrics
+{
+    uint32_t written = 0;
+    uint32_t skipped = 0; // captures replaced by a newer one before the writer got to them
+    uint32_t failed = 0;
+    double pause = 0.0; // seconds the last capture held the simulation
+    double maxPause = 0.0;
+    double writeTime = 0.0; // seconds of checksum, compression and disk for the last write
+    uint64_t rawBytes = 0; // last checkpoint before compression
+    uint64_t fileBytes = 0; // last checkpoint on disk
+    double time = 0.0; // simulation seconds of the last written checkpoint
+    std::string lastError;
+};
+
+/**
+ * @brief Periodic checkpoints that don't stall the simulation. Capture only copies state into a buffer,
+ * a worker thread compresses and writes it and rotates older files, so the newest is always at filepath
+ * and the ones before it at filepath.1 up to filepath.(keep - 1).
+ * @note When the writer falls behind, a pending capture is replaced by the newer one instead of queueing.
+ */
+class CheckpointWriter
+{
+public:
+    CheckpointWriter() = default;
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    /**
+     * @brief Starts the worker, files are written under filepath from now on
+     */
+    void Start(const std::string& filepath, uint32_t keep = 3, bool compress = true);
+    /**
+     * @brief Writes whatever was captured and joins the worker
+     */
+    void Stop();
+
+    /**
+     * @brief Copies simulation state for the worker, call from the thread that steps the simulation
+     */
+    void Capture(const Simulation& simulation);
+
+    CheckpointMetrics GetMetrics() const;
+    inline const std::string& GetFilepath() const { return m_Filepath; }
+private:
+    void Run();
+    void Rotate();
+
+    std::string m_Filepath;
+    uint32_t m_Keep = 3;
+    bool m_Compress = true;
+
+    std::thread m_Thread;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_Quit = false;
+    bool m_HasPending = false;
+    // captured into pending, swapped with writing by the worker so neither is ever reallocated
+    CheckpointData m_Pending;
+    CheckpointData m_Writing;
+    CheckpointMetrics m_Metrics;
+};
@@ -0,0 +1,57 @@
+#include "collisions.h"
+
+#include <numeric>
+#include <algorithm>
+
+void CollisionDetector::FindPairs(const BodyStore& bodies, std::vector<std::pair<uint32_t, uint32_t>>& pairs)
+{
+    auto& positions = bodies.GetPositions();
+    auto& radii = bodies.GetRadii();
+    uint32_t count = bodies.GetCount();
+    pairs.clear();
+
+    m_Min.resize(count);
+    m_Max.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_Min[i] = positions[i].x - radii[i];
+        m_Max[i] = positions[i].x + radii[i];
+    }
+
+    auto byMin = [&](uint32_t a, uint32_t b) { return m_Min[a] < m_Min[b]; };
+    if (m_Order.size() != count)
+    {
+        // bodies were added or removed, dense indices moved so old order means nothing
+        m_Order.resize(count);
+        std::iota(m_Order.begin(), m_Order.end(), 0);
+        std::sort(m_Order.begin(), m_Order.end(), byMin);
+    }
+    else
+    {
+        // insertion sort, nearly sorted input from last step makes this O(N)
+        for (uint32_t i = 1; i < count; i++)
+        {
+            uint32_t body = m_Order[i];
+            uint32_t j = i;
+            while (j > 0 && byMin(body, m_Order[j - 1]))
+            {
+                m_Order[j] = m_Order[j - 1];
+                j--;
+            }
+            m_Order[j] = body;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t a = m_Order[i];
+        for (uint32_t j = i + 1; j < count && m_Min[m_Order[j]] <= m_Max[a]; j++)
+        {
+            uint32_t b = m_Order[j];
+            glm::dvec3 offset = positions[a] - positions[b];
+            double radiusSum = radii[a] + radii[b];
+            if (glm::dot(offset, offset) < radiusSum * radiusSum)
+                pairs.emplace_back(std::min(a, b), std::max(a, b));
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "bodyStore.h"
+
+#include <vector>
+#include <utility>
+
+/**
+ * @brief Sweep and prune broad phase. Bodies are kept sorted by the lower end of their extent
+ * along x, order from the previous step is reused so sorting is close to linear while bodies
+ * move a little every step. Only bodies whose x extents overlap go to the sphere test.
+ */
+class CollisionDetector
+{
+public:
+    /**
+     * @brief Writes dense index pairs of touching bodies, every pair once
+     */
+    void FindPairs(const BodyStore& bodies, std::vector<std::pair<uint32_t, uint32_t>>& pairs);
+private:
+    std::vector<uint32_t> m_Order;
+    std::vector<double> m_Min;
+    std::vector<double> m_Max;
+};
+
+/**
+ * @brief Result of a perfectly inelastic collision, absorbed body is already removed from the store
+ */
+struct BodyMerge
+{
+    BodyHandle survivor;
+    BodyHandle absorbed;
+};
@@ -0,0 +1,110 @@
+#include "compression.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+// longest literal run a single control byte can describe, repeats go one further
+#define MAX_RUN 128
+
+std::vector<uint8_t> ShuffleBytes(const uint8_t* data, size_t size)
+{
+    size_t words = size / 8;
+    std::vector<uint8_t> shuffled(data, data + size);
+    for (size_t word = 0; word < words; word++)
+    {
+        for (size_t byte = 0; byte < 8; byte++)
+            shuffled[byte * words + word] = data[word * 8 + byte];
+    }
+    return shuffled;
+}
+
+std::vector<uint8_t> UnshuffleBytes(const uint8_t* data, size_t size)
+{
+    size_t words = size / 8;
+    std::vector<uint8_t> unshuffled(data, data + size);
+    for (size_t word = 0; word < words; word++)
+    {
+        for (size_t byte = 0; byte < 8; byte++)
+            unshuffled[word * 8 + byte] = data[byte * words + word];
+    }
+    return unshuffled;
+}
+
+std::vector<uint8_t> CompressRuns(const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> output;
+    output.reserve(data.size() / 2);
+    size_t literalStart = 0;
+    size_t i = 0;
+    auto flushLiterals = [&](size_t end)
+    {
+        while (literalStart < end)
+        {
+            size_t count = std::min<size_t>(end - literalStart, MAX_RUN);
+            output.push_back((uint8_t)(count - 1));
+            output.insert(output.end(), data.begin() + literalStart, data.begin() + literalStart + count);
+            literalStart += count;
+        }
+    };
+
+    while (i < data.size())
+    {
+        size_t run = 1;
+        while (i + run < data.size() && run < MAX_RUN + 1 && data[i + run] == data[i])
+            run++;
+
+        if (run >= 3)
+        {
+            flushLiterals(i);
+            output.push_back((uint8_t)(run + 126));
+            output.push_back(data[i]);
+            i += run;
+            literalStart = i;
+        }
+        else
+        {
+            i += run;
+        }
+    }
+    flushLiterals(data.size());
+    return output;
+}
+
+std::vector<uint8_t> DecompressRuns(const uint8_t* data, size_t size, size_t rawSize)
+{
+    std::vector<uint8_t> output;
+    output.reserve(rawSize);
+    size_t i = 0;
+    while (i < size)
+    {
+        uint8_t control = data[i++];
+        if (control < 128)
+        {
+            size_t count = (size_t)control + 1;
+            if (i + count > size)
+                throw std::runtime_error("Compressed data is truncated");
+            output.insert(output.end(), data + i, data + i + count);
+            i += count;
+        }
+        else
+        {
+            if (i >= size)
+                throw std::runtime_error("Compressed data is truncated");
+            output.insert(output.end(), (size_t)control - 126, data[i++]);
+        }
+        if (output.size() > rawSize)
+            throw std::runtime_error("Compressed data is damaged");
+    }
+    return output;
+}
+
+uint64_t HashBytes(const uint8_t* data, size_t size, uint64_t seed)
+{
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Small lossless helpers for files full of doubles, no external library needed. Shuffling groups
+ * byte k of every 8 byte word together so sign and exponent bytes of neighbouring values line up, run
+ * length encoding then squeezes the repeats. Works well on zeros and on values XORed with their
+ * previous version, noisy mantissas don't compress.
+ */
+
+/**
+ * @brief Bytes past the last whole 8 byte word stay where they are
+ */
+std::vector<uint8_t> ShuffleBytes(const uint8_t* data, size_t size);
+std::vector<uint8_t> UnshuffleBytes(const uint8_t* data, size_t size);
+
+/**
+ * @brief Control byte below 128 is followed by that many + 1 literal bytes, from 128 up it repeats
+ * the next byte (control - 126) times
+ */
+std::vector<uint8_t> CompressRuns(const std::vector<uint8_t>& data);
+/**
+ * @throws std::runtime_error when data is truncated or unpacks to more than rawSize bytes
+ */
+std::vector<uint8_t> DecompressRuns(const uint8_t* data, size_t size, size_t rawSize);
+
+/**
+ * @brief 64 bit FNV-1a, catches damaged files, not meant against tampering. Passing the hash of earlier
+ * bytes as seed continues it.
+ */
+uint64_t HashBytes(const uint8_t* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
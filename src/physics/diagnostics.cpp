@@ -0,0 +1,62 @@
+#include "diagnostics.h"
+#include "gravitySolver.h"
+
+#include <cmath>
+#include <algorithm>
+
+double ComputeTotalEnergy(const BodyStore& bodies)
+{
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+
+    double kinetic = 0.0;
+    double potential = 0.0;
+    for (uint32_t i = 0; i < bodies.GetCount(); i++)
+    {
+        kinetic += 0.5 * masses[i] * glm::dot(velocities[i], velocities[i]);
+        for (uint32_t j = i + 1; j < bodies.GetCount(); j++)
+        {
+            double distance = glm::length(positions[j] - positions[i]);
+            if (distance > 0.0)
+                potential -= GRAVITATIONAL_CONSTANT * masses[i] * masses[j] / distance;
+        }
+    }
+    return kinetic + potential;
+}
+
+glm::dvec3 ComputeTotalMomentum(const BodyStore& bodies)
+{
+    glm::dvec3 momentum{0.0};
+    for (uint32_t i = 0; i < bodies.GetCount(); i++)
+        momentum += bodies.GetVelocities()[i] * bodies.GetMasses()[i];
+    return momentum;
+}
+
+glm::dvec3 ComputeTotalAngularMomentum(const BodyStore& bodies)
+{
+    glm::dvec3 angularMomentum{0.0};
+    for (uint32_t i = 0; i < bodies.GetCount(); i++)
+        angularMomentum += glm::cross(bodies.GetPositions()[i], bodies.GetVelocities()[i]) * bodies.GetMasses()[i];
+    return angularMomentum;
+}
+
+uint32_t FindHeaviestBody(const BodyStore& bodies)
+{
+    auto& masses = bodies.GetMasses();
+    return (uint32_t)(std::max_element(masses.begin(), masses.end()) - masses.begin());
+}
+
+double ComputeEccentricity(const BodyStore& bodies, uint32_t body, uint32_t center)
+{
+    glm::dvec3 position = bodies.GetPositions()[body] - bodies.GetPositions()[center];
+    glm::dvec3 velocity = bodies.GetVelocities()[body] - bodies.GetVelocities()[center];
+    double mu = GRAVITATIONAL_CONSTANT * (bodies.GetMasses()[body] + bodies.GetMasses()[center]);
+    double distance = glm::length(position);
+    if (distance <= 0.0 || mu <= 0.0)
+        return 0.0;
+
+    // eccentricity vector, points at periapsis with length e
+    glm::dvec3 eccentricity = glm::cross(velocity, glm::cross(position, velocity)) / mu - position / distance;
+    return glm::length(eccentricity);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "bodyStore.h"
+
+/**
+ * @brief Kinetic plus pairwise potential energy in kg km^2/s^2, O(N^2) so keep it out of the step loop
+ */
+double ComputeTotalEnergy(const BodyStore& bodies);
+
+/**
+ * @brief Total momentum in kg km/s
+ */
+glm::dvec3 ComputeTotalMomentum(const BodyStore& bodies);
+
+/**
+ * @brief Total angular momentum around the origin in kg km^2/s
+ */
+glm::dvec3 ComputeTotalAngularMomentum(const BodyStore& bodies);
+
+/**
+ * @brief Dense index of the heaviest body, bodies orbit it in two body approximations
+ */
+uint32_t FindHeaviestBody(const BodyStore& bodies);
+
+/**
+ * @brief Eccentricity of body around the heaviest one, >= 1 means it's on an escape orbit
+ */
+double ComputeEccentricity(const BodyStore& bodies, uint32_t body, uint32_t center);
@@ -0,0 +1,228 @@
+#include "directKernels.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define GRAVITY_X86_KERNELS
+    #include <immintrin.h>
+#endif
+
+static void TileKernelScalar(PackedBodies& bodies, uint32_t beginA, uint32_t endA, uint32_t beginB, uint32_t endB)
+{
+    const double* x = bodies.x.data();
+    const double* y = bodies.y.data();
+    const double* z = bodies.z.data();
+    const double* mass = bodies.mass.data();
+    double* ax = bodies.ax.data();
+    double* ay = bodies.ay.data();
+    double* az = bodies.az.data();
+    bool diagonal = beginA == beginB;
+
+    for (uint32_t i = beginA; i < endA; i++)
+    {
+        double axi = 0.0, ayi = 0.0, azi = 0.0;
+        for (uint32_t j = diagonal ? i + 1 : beginB; j < endB; j++)
+        {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double dz = z[j] - z[i];
+            double distanceSquared = dx * dx + dy * dy + dz * dz;
+            double inverseDistance = 1.0 / std::sqrt(distanceSquared);
+            double inverseCube = inverseDistance * inverseDistance * inverseDistance;
+            double strengthJ = mass[j] * inverseCube;
+            double strengthI = mass[i] * inverseCube;
+
+            axi += dx * strengthJ;
+            ayi += dy * strengthJ;
+            azi += dz * strengthJ;
+            ax[j] -= dx * strengthI;
+            ay[j] -= dy * strengthI;
+            az[j] -= dz * strengthI;
+        }
+        ax[i] += axi;
+        ay[i] += ayi;
+        az[i] += azi;
+    }
+}
+
+#ifdef GRAVITY_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+static inline double HorizontalSum(__m256d v)
+{
+    __m128d low = _mm256_castpd256_pd128(v);
+    __m128d high = _mm256_extractf128_pd(v, 1);
+    low = _mm_add_pd(low, high);
+    return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+}
+
+/**
+ * @brief Body i is broadcast to all lanes and 4 j bodies are processed at once,
+ * j accelerations are loaded, updated and stored back so no lane ever conflicts with another
+ */
+__attribute__((target("avx2,fma")))
+static void TileKernelAVX2(PackedBodies& bodies, uint32_t beginA, uint32_t endA, uint32_t beginB, uint32_t endB)
+{
+    const double* x = bodies.x.data();
+    const double* y = bodies.y.data();
+    const double* z = bodies.z.data();
+    const double* mass = bodies.mass.data();
+    double* ax = bodies.ax.data();
+    double* ay = bodies.ay.data();
+    double* az = bodies.az.data();
+    bool diagonal = beginA == beginB;
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    for (uint32_t i = beginA; i < endA; i++)
+    {
+        __m256d xi = _mm256_set1_pd(x[i]);
+        __m256d yi = _mm256_set1_pd(y[i]);
+        __m256d zi = _mm256_set1_pd(z[i]);
+        __m256d mi = _mm256_set1_pd(mass[i]);
+        __m256d axi = _mm256_setzero_pd();
+        __m256d ayi = _mm256_setzero_pd();
+        __m256d azi = _mm256_setzero_pd();
+
+        uint32_t j = diagonal ? i + 1 : beginB;
+        for (; j + 4 <= endB; j += 4)
+        {
+            __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), xi);
+            __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), yi);
+            __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + j), zi);
+            __m256d distanceSquared = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+            __m256d inverseDistance = _mm256_div_pd(one, _mm256_sqrt_pd(distanceSquared));
+            __m256d inverseCube = _mm256_mul_pd(_mm256_mul_pd(inverseDistance, inverseDistance), inverseDistance);
+            __m256d strengthJ = _mm256_mul_pd(_mm256_loadu_pd(mass + j), inverseCube);
+            __m256d strengthI = _mm256_mul_pd(mi, inverseCube);
+
+            axi = _mm256_fmadd_pd(dx, strengthJ, axi);
+            ayi = _mm256_fmadd_pd(dy, strengthJ, ayi);
+            azi = _mm256_fmadd_pd(dz, strengthJ, azi);
+            _mm256_storeu_pd(ax + j, _mm256_fnmadd_pd(dx, strengthI, _mm256_loadu_pd(ax + j)));
+            _mm256_storeu_pd(ay + j, _mm256_fnmadd_pd(dy, strengthI, _mm256_loadu_pd(ay + j)));
+            _mm256_storeu_pd(az + j, _mm256_fnmadd_pd(dz, strengthI, _mm256_loadu_pd(az + j)));
+        }
+
+        double axs = HorizontalSum(axi);
+        double ays = HorizontalSum(ayi);
+        double azs = HorizontalSum(azi);
+        for (; j < endB; j++)
+        {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double dz = z[j] - z[i];
+            double inverseDistance = 1.0 / std::sqrt(dx * dx + dy * dy + dz * dz);
+            double inverseCube = inverseDistance * inverseDistance * inverseDistance;
+            axs += dx * mass[j] * inverseCube;
+            ays += dy * mass[j] * inverseCube;
+            azs += dz * mass[j] * inverseCube;
+            ax[j] -= dx * mass[i] * inverseCube;
+            ay[j] -= dy * mass[i] * inverseCube;
+            az[j] -= dz * mass[i] * inverseCube;
+        }
+        ax[i] += axs;
+        ay[i] += ays;
+        az[i] += azs;
+    }
+}
+
+__attribute__((target("avx512f")))
+static void TileKernelAVX512(PackedBodies& bodies, uint32_t beginA, uint32_t endA, uint32_t beginB, uint32_t endB)
+{
+    const double* x = bodies.x.data();
+    const double* y = bodies.y.data();
+    const double* z = bodies.z.data();
+    const double* mass = bodies.mass.data();
+    double* ax = bodies.ax.data();
+    double* ay = bodies.ay.data();
+    double* az = bodies.az.data();
+    bool diagonal = beginA == beginB;
+    const __m512d one = _mm512_set1_pd(1.0);
+
+    for (uint32_t i = beginA; i < endA; i++)
+    {
+        __m512d xi = _mm512_set1_pd(x[i]);
+        __m512d yi = _mm512_set1_pd(y[i]);
+        __m512d zi = _mm512_set1_pd(z[i]);
+        __m512d mi = _mm512_set1_pd(mass[i]);
+        __m512d axi = _mm512_setzero_pd();
+        __m512d ayi = _mm512_setzero_pd();
+        __m512d azi = _mm512_setzero_pd();
+
+        uint32_t j = diagonal ? i + 1 : beginB;
+        for (; j + 8 <= endB; j += 8)
+        {
+            __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + j), xi);
+            __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + j), yi);
+            __m512d dz = _mm512_sub_pd(_mm512_loadu_pd(z + j), zi);
+            __m512d distanceSquared = _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx)));
+            __m512d inverseDistance = _mm512_div_pd(one, _mm512_sqrt_pd(distanceSquared));
+            __m512d inverseCube = _mm512_mul_pd(_mm512_mul_pd(inverseDistance, inverseDistance), inverseDistance);
+            __m512d strengthJ = _mm512_mul_pd(_mm512_loadu_pd(mass + j), inverseCube);
+            __m512d strengthI = _mm512_mul_pd(mi, inverseCube);
+
+            axi = _mm512_fmadd_pd(dx, strengthJ, axi);
+            ayi = _mm512_fmadd_pd(dy, strengthJ, ayi);
+            azi = _mm512_fmadd_pd(dz, strengthJ, azi);
+            _mm512_storeu_pd(ax + j, _mm512_fnmadd_pd(dx, strengthI, _mm512_loadu_pd(ax + j)));
+            _mm512_storeu_pd(ay + j, _mm512_fnmadd_pd(dy, strengthI, _mm512_loadu_pd(ay + j)));
+            _mm512_storeu_pd(az + j, _mm512_fnmadd_pd(dz, strengthI, _mm512_loadu_pd(az + j)));
+        }
+
+        double axs = _mm512_reduce_add_pd(axi);
+        double ays = _mm512_reduce_add_pd(ayi);
+        double azs = _mm512_reduce_add_pd(azi);
+        for (; j < endB; j++)
+        {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double dz = z[j] - z[i];
+            double inverseDistance = 1.0 / std::sqrt(dx * dx + dy * dy + dz * dz);
+            double inverseCube = inverseDistance * inverseDistance * inverseDistance;
+            axs += dx * mass[j] * inverseCube;
+            ays += dy * mass[j] * inverseCube;
+            azs += dz * mass[j] * inverseCube;
+            ax[j] -= dx * mass[i] * inverseCube;
+            ay[j] -= dy * mass[i] * inverseCube;
+            az[j] -= dz * mass[i] * inverseCube;
+        }
+        ax[i] += axs;
+        ay[i] += ays;
+        az[i] += azs;
+    }
+}
+
+#endif
+
+SimdLevel DetectSimdLevel()
+{
+#ifdef GRAVITY_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdAVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdAVX2;
+#endif
+    return SimdScalar;
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdAVX512: return "AVX-512";
+    case SimdAVX2: return "AVX2";
+    default: return "Scalar";
+    }
+}
+
+DirectTileKernel GetDirectTileKernel(SimdLevel level)
+{
+#ifdef GRAVITY_X86_KERNELS
+    if (level == SimdAVX512)
+        return TileKernelAVX512;
+    if (level == SimdAVX2)
+        return TileKernelAVX2;
+#endif
+    return TileKernelScalar;
+}
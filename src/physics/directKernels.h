@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+enum SimdLevel
+{
+    SimdScalar = 0,
+    SimdAVX2 = 1,
+    SimdAVX512 = 2
+};
+
+/**
+ * @brief Bodies repacked for direct summation kernels. Separate x/y/z arrays so that
+ * consecutive bodies fill SIMD lanes, gravitational constant is already folded into masses.
+ */
+struct PackedBodies
+{
+    std::vector<double> x, y, z;
+    std::vector<double> mass;
+    std::vector<double> ax, ay, az;
+};
+
+/**
+ * @brief Mutual interaction of two tiles [beginA, endA) and [beginB, endB). When both ranges
+ * start at the same body it's a diagonal tile and only pairs i < j are evaluated.
+ * Accelerations are accumulated into both tiles so every pair is computed once.
+ */
+using DirectTileKernel = void(*)(PackedBodies& bodies, uint32_t beginA, uint32_t endA, uint32_t beginB, uint32_t endB);
+
+// 2 tiles * 256 bodies * 7 doubles = 28 KB, fits into 32 KB L1 data cache
+#define DIRECT_TILE_SIZE 256
+// smallest tile the threaded schedule splits down to, below this scheduling costs more than the pairs
+#define DIRECT_MIN_TILE_SIZE 32
+
+SimdLevel DetectSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
+DirectTileKernel GetDirectTileKernel(SimdLevel level);
@@ -0,0 +1,149 @@
+#include "ensemble.h"
+#include "diagnostics.h"
+#include "random.h"
+
+#include <cmath>
+#include <chrono>
+#include <mutex>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+EnsembleRunner::EnsembleRunner(const Simulation& base, uint32_t memberCount, const EnsemblePerturbation& perturbation)
+    : m_BaseBodies(base.GetBodies()), m_BaseParticlePositions(base.GetParticles().GetPositions()),
+        m_BaseParticleVelocities(base.GetParticles().GetVelocities()), m_Settings(base.GetSettings()),
+        m_BaseTime(base.GetTime()), m_MemberCount(memberCount), m_Perturbation(perturbation)
+{
+    // members already run side by side, threads inside a member would only fight over the same cores
+    m_Settings.threadCount = 1;
+}
+
+void EnsembleRunner::Run(ThreadPool& threadPool, double endTime, double delta, const ProgressCallback& progress)
+{
+    m_Summaries.assign(m_MemberCount, EnsembleSummary{});
+    std::mutex progressMutex;
+    threadPool.ParallelFor(m_MemberCount, [&](uint32_t member)
+    {
+        m_Summaries[member] = RunMember(member, endTime, delta);
+        if (progress)
+        {
+            std::lock_guard<std::mutex> lock(progressMutex);
+            progress(m_Summaries[member]);
+        }
+    });
+}
+
+void EnsembleRunner::PerturbMember(uint32_t member, BodyStore& bodies) const
+{
+    if (bodies.GetCount() == 0)
+        return;
+
+    Random random(m_Perturbation.seed + member);
+
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    uint32_t center = FindHeaviestBody(bodies);
+    glm::dvec3 centerPosition = positions[center];
+    glm::dvec3 centerVelocity = velocities[center];
+    for (uint32_t i = 0; i < bodies.GetCount(); i++)
+    {
+        // every body draws the same amount of numbers so adding a sigma doesn't change the others
+        glm::dvec3 positionNoise{random.Normal(), random.Normal(), random.Normal()};
+        glm::dvec3 velocityNoise{random.Normal(), random.Normal(), random.Normal()};
+        double massNoise = random.Normal();
+        if (i == center && !m_Perturbation.perturbCentral)
+            continue;
+
+        // relative state of the central body is zero, perturbCentral only touches its mass
+        positions[i] += positionNoise * (glm::length(positions[i] - centerPosition) * m_Perturbation.position);
+        velocities[i] += velocityNoise * (glm::length(velocities[i] - centerVelocity) * m_Perturbation.velocity);
+        masses[i] *= std::max(1.0 + massNoise * m_Perturbation.mass, 0.0);
+    }
+}
+
+EnsembleSummary EnsembleRunner::RunMember(uint32_t member, double endTime, double delta) const
+{
+    auto start = std::chrono::steady_clock::now();
+
+    Simulation simulation;
+    simulation.GetBodies() = m_BaseBodies;
+    simulation.GetSettings() = m_Settings;
+    simulation.SetTime(m_BaseTime);
+    TestParticles& particles = simulation.GetParticles();
+    particles.Reserve((uint32_t)m_BaseParticlePositions.size());
+    for (size_t i = 0; i < m_BaseParticlePositions.size(); i++)
+        particles.Add(m_BaseParticlePositions[i], m_BaseParticleVelocities[i]);
+    PerturbMember(member, simulation.GetBodies());
+
+    EnsembleSummary summary{};
+    summary.member = member;
+    double initialEnergy = ComputeTotalEnergy(simulation.GetBodies());
+    while (simulation.GetTime() < endTime && simulation.GetBodies().GetCount() > 0)
+    {
+        simulation.Step(std::min(delta, endTime - simulation.GetTime()));
+        summary.merges += (uint32_t)simulation.GetMerges().size();
+        simulation.ClearMerges();
+    }
+
+    const BodyStore& bodies = simulation.GetBodies();
+    summary.time = simulation.GetTime();
+    summary.bodies = bodies.GetCount();
+    if (initialEnergy != 0.0)
+        summary.energyError = std::abs((ComputeTotalEnergy(bodies) - initialEnergy) / initialEnergy);
+    if (bodies.GetCount() > 0)
+    {
+        uint32_t center = FindHeaviestBody(bodies);
+        for (uint32_t i = 0; i < bodies.GetCount(); i++)
+        {
+            if (i == center)
+                continue;
+            double eccentricity = ComputeEccentricity(bodies, i, center);
+            if (eccentricity >= 1.0)
+                summary.ejected++;
+            else
+                summary.maxEccentricity = std::max(summary.maxEccentricity, eccentricity);
+        }
+    }
+
+    summary.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
+
+void EnsembleRunner::WriteSummaries(const std::string& filepath) const
+{
+    std::ofstream file(filepath);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open summary file " + filepath);
+
+    file << "# member time energyError bodies merges ejected maxEccentricity wallSeconds\n";
+    for (const EnsembleSummary& summary : m_Summaries)
+    {
+        file << summary.member << " " << summary.time << " " << summary.energyError << " " << summary.bodies << " "
+            << summary.merges << " " << summary.ejected << " " << summary.maxEccentricity << " " << summary.wallSeconds << "\n";
+    }
+
+    // member is stable when nothing collided or escaped
+    uint32_t stable = 0;
+    std::vector<double> energyErrors;
+    double maxEccentricity = 0.0;
+    for (const EnsembleSummary& summary : m_Summaries)
+    {
+        if (summary.merges == 0 && summary.ejected == 0)
+            stable++;
+        energyErrors.push_back(summary.energyError);
+        maxEccentricity = std::max(maxEccentricity, summary.maxEccentricity);
+    }
+    std::sort(energyErrors.begin(), energyErrors.end());
+
+    file << "# members " << m_Summaries.size() << "\n";
+    file << "# stable " << stable << " (" << (m_Summaries.empty() ? 0.0 : 100.0 * stable / m_Summaries.size()) << "%)\n";
+    if (!energyErrors.empty())
+    {
+        file << "# energyError median " << energyErrors[energyErrors.size() / 2] << " max " << energyErrors.back() << "\n";
+    }
+    file << "# maxEccentricity " << maxEccentricity << "\n";
+
+    if (!file.good())
+        throw std::runtime_error("Failed to write summary file " + filepath);
+}
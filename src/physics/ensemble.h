@@ -0,0 +1,77 @@
+#pragma once
+
+#include "simulation.h"
+#include "threadPool.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+/**
+ * @brief Gaussian noise applied to every member's initial state, sigmas are relative to the value perturbed.
+ * Position and velocity sigmas scale with distance and speed relative to the heaviest body. Noise comes
+ * from Random in random.h, so a seed perturbs members the same way with every standard library.
+ */
+struct EnsemblePerturbation
+{
+    double position = 0.0;
+    double velocity = 0.0;
+    double mass = 0.0;
+    bool perturbCentral = false; // heaviest body stays as it is unless set
+    uint64_t seed = 1; // member i draws from seed + i so results don't depend on scheduling
+};
+
+/**
+ * @brief What a stability study wants to know about one member once it's done
+ */
+struct EnsembleSummary
+{
+    uint32_t member = 0;
+    double time = 0.0; // seconds reached
+    double energyError = 0.0; // relative, |E - E0| / |E0|
+    uint32_t bodies = 0; // left at the end
+    uint32_t merges = 0;
+    uint32_t ejected = 0; // on escape orbits around the heaviest body at the end
+    double maxEccentricity = 0.0; // over bodies still bound
+    double wallSeconds = 0.0;
+};
+
+/**
+ * @brief Runs many perturbed copies of one initial state side by side. Every member is its own Simulation
+ * built, run and dropped inside a single job, so memory only holds the members currently running.
+ * Members are single threaded, parallelism comes from running one job per member on the shared pool.
+ */
+class EnsembleRunner
+{
+public:
+    using ProgressCallback = std::function<void(const EnsembleSummary&)>;
+
+    EnsembleRunner(const Simulation& base, uint32_t memberCount, const EnsemblePerturbation& perturbation);
+
+    /**
+     * @brief Integrates every member until endTime with steps of delta, last step is shortened to hit it.
+     * Progress is called from worker threads, one call at a time.
+     */
+    void Run(ThreadPool& threadPool, double endTime, double delta, const ProgressCallback& progress = nullptr);
+
+    inline const std::vector<EnsembleSummary>& GetSummaries() const { return m_Summaries; }
+
+    /**
+     * @brief One line per member followed by aggregate statistics
+     * @throws std::runtime_error when the file can't be written
+     */
+    void WriteSummaries(const std::string& filepath) const;
+private:
+    void PerturbMember(uint32_t member, BodyStore& bodies) const;
+    EnsembleSummary RunMember(uint32_t member, double endTime, double delta) const;
+
+    BodyStore m_BaseBodies;
+    std::vector<glm::dvec3> m_BaseParticlePositions;
+    std::vector<glm::dvec3> m_BaseParticleVelocities;
+    SimulationSettings m_Settings;
+    double m_BaseTime;
+    uint32_t m_MemberCount;
+    EnsemblePerturbation m_Perturbation;
+
+    std::vector<EnsembleSummary> m_Summaries;
+};
@@ -0,0 +1,725 @@
+#include "ephemeris.h"
+#include "compression.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <limits>
+
+#define EPHEMERIS_RECORDING_SPAN (4.0 * 86400.0) // seconds, longest segment tried for recordings
+#define EPHEMERIS_RECORDING_ORDER 12
+#define EPHEMERIS_SEGMENT_FRAMES 16 // fewest frames per recording segment, a few past the order keep the fit from swinging
+#define EPHEMERIS_FIT_TOLERANCE 1.0 // km, recording segments are halved until every frame is this close to the fit
+
+namespace
+{
+    constexpr char MAGIC[8] = { 'G', 'R', 'A', 'V', 'E', 'P', 'H', 'M' };
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr double PI = 3.14159265358979323846;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t order;
+        uint32_t segmentCount;
+        uint32_t bodyCount;
+        uint32_t padding;
+        double start;
+        double span;
+        double maxFitError;
+        uint64_t payloadSize;
+        uint64_t checksum;
+    };
+
+    struct BodyRecord
+    {
+        uint32_t index;
+        uint32_t generation;
+        uint32_t firstSegment;
+        uint32_t segmentCount;
+        double rotation[3];
+        double rotationSpeed[3];
+        double rotationTime;
+    };
+
+    /**
+     * @brief Basis at u for value and derivative, T_j(u) and T_j'(u) = j U_(j-1)(u). Every body in a segment
+     * shares them, so evaluating a body is two dot products per axis.
+     */
+    void ComputeBasis(double u, uint32_t order, double* value, double* derivative)
+    {
+        double t0 = 1.0, t1 = u; // Chebyshev polynomials of the first kind
+        double u0 = 1.0, u1 = 2.0 * u; // and of the second kind
+        value[0] = 1.0;
+        derivative[0] = 0.0;
+        for (uint32_t j = 1; j < order; j++)
+        {
+            value[j] = t1;
+            derivative[j] = (double)j * u0;
+            double t2 = 2.0 * u * t1 - t0;
+            double u2 = 2.0 * u * u1 - u0;
+            t0 = t1; t1 = t2;
+            u0 = u1; u1 = u2;
+        }
+    }
+
+    glm::dvec3 Sum(const double* coefficients, const double* basis, uint32_t order)
+    {
+        glm::dvec3 result{0.0};
+        for (uint32_t j = 0; j < order; j++)
+        {
+            result.x += coefficients[j] * basis[j];
+            result.y += coefficients[order + j] * basis[j];
+            result.z += coefficients[2 * order + j] * basis[j];
+        }
+        return result;
+    }
+
+    /**
+     * @brief Covers the header with its checksum field zeroed and then the payload, a damaged segment count
+     * or span is caught as well as damaged coefficients
+     */
+    uint64_t ComputeChecksum(FileHeader header, const std::vector<uint8_t>& payload)
+    {
+        header.checksum = 0;
+        uint64_t hash = HashBytes(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+        return HashBytes(payload.data(), payload.size(), hash);
+    }
+
+    template<typename T>
+    void Append(std::vector<uint8_t>& bytes, const T* values, size_t count)
+    {
+        const uint8_t* begin = reinterpret_cast<const uint8_t*>(values);
+        bytes.insert(bytes.end(), begin, begin + count * sizeof(T));
+    }
+
+    template<typename T>
+    void Take(const std::vector<uint8_t>& bytes, size_t& offset, T* values, size_t count)
+    {
+        if (offset + count * sizeof(T) > bytes.size())
+            throw std::runtime_error("Ephemeris payload is truncated");
+        if (count > 0)
+            std::memcpy(values, bytes.data() + offset, count * sizeof(T));
+        offset += count * sizeof(T);
+    }
+
+    /**
+     * @brief Samples of one body from an imported table
+     */
+    struct Table
+    {
+        BodyHandle handle;
+        double mass;
+        double radius;
+        std::vector<double> times;
+        std::vector<glm::dvec3> positions;
+        std::vector<glm::dvec3> velocities;
+    };
+
+    /**
+     * @brief Cubic Hermite curve through the samples around time, matches positions and velocities at both
+     */
+    glm::dvec3 InterpolateTable(const Table& table, double time)
+    {
+        size_t next = (size_t)(std::upper_bound(table.times.begin(), table.times.end(), time) - table.times.begin());
+        next = std::clamp<size_t>(next, 1, table.times.size() - 1);
+        size_t previous = next - 1;
+
+        double h = table.times[next] - table.times[previous];
+        double s = (time - table.times[previous]) / h;
+        double s2 = s * s, s3 = s2 * s;
+        return (2.0 * s3 - 3.0 * s2 + 1.0) * table.positions[previous] + (s3 - 2.0 * s2 + s) * h * table.velocities[previous]
+            + (-2.0 * s3 + 3.0 * s2) * table.positions[next] + (s3 - s2) * h * table.velocities[next];
+    }
+}
+
+void Ephemeris::Build(TrajectoryReader& reader, double span, uint32_t order)
+{
+    if (!reader.IsOpen() || reader.GetEndTime() <= reader.GetStartTime())
+        throw std::runtime_error("Ephemeris needs a recording with more than one frame");
+    if (!(span > 0.0))
+        throw std::runtime_error("Ephemeris needs a positive segment span");
+
+    FitFrames(reader, reader.GetFrameTimes(), span, order);
+}
+
+void Ephemeris::Build(TrajectoryReader& reader)
+{
+    if (!reader.IsOpen() || reader.GetEndTime() <= reader.GetStartTime())
+        throw std::runtime_error("Ephemeris needs a recording with more than one frame");
+
+    // frames are apart by the step size when steps are longer than the cadence, so go by the frames
+    std::vector<double> frames = reader.GetFrameTimes();
+    double spacing = (frames.back() - frames.front()) / (double)(frames.size() - 1);
+    double shortest = spacing * EPHEMERIS_SEGMENT_FRAMES;
+    double span = std::max(EPHEMERIS_RECORDING_SPAN, shortest);
+    FitFrames(reader, frames, span, EPHEMERIS_RECORDING_ORDER);
+    while (m_MaxFitError > EPHEMERIS_FIT_TOLERANCE && span * 0.5 >= shortest)
+    {
+        span *= 0.5;
+        FitFrames(reader, frames, span, EPHEMERIS_RECORDING_ORDER);
+    }
+}
+
+/**
+ * @brief Least squares fit of every segment to the frames inside it and the ones right around it, so
+ * neighbouring segments share the frames at their boundary. The normal equations only depend on frame
+ * times, they are factored once per segment and solved for every body.
+ */
+void Ephemeris::FitFrames(TrajectoryReader& reader, const std::vector<double>& frames, double span, uint32_t order)
+{
+    double start = frames.front();
+    double end = frames.back();
+    m_Order = std::clamp(order, 2u, MAX_ORDER);
+    m_SegmentCount = (uint32_t)std::max(std::ceil((end - start) / span), 1.0);
+    m_Span = (end - start) / (double)m_SegmentCount;
+    m_Start = start;
+    m_MaxFitError = 0.0;
+    m_Bodies.clear();
+
+    std::unordered_map<uint64_t, uint32_t> lookup; // handle -> body
+    BodyStore bodies;
+    std::vector<glm::dvec3> samples; // per body, frames of the current segment
+    std::vector<uint32_t> seen; // per body, frames present in the current segment
+    std::vector<double> masses, radii;
+    std::vector<double> basis; // per frame, the first n Chebyshev polynomials at its time
+    std::vector<double> normal; // n x n, lower triangle Cholesky factored in place
+    std::vector<double> coefficients(3 * m_Order);
+    std::vector<glm::dvec3> solution;
+    double unused[MAX_ORDER];
+
+    for (uint32_t segment = 0; segment < m_SegmentCount; segment++)
+    {
+        double half = 0.5 * m_Span;
+        double middle = m_Start + ((double)segment + 0.5) * m_Span;
+        double segmentEnd = segment + 1 == m_SegmentCount ? end : middle + half;
+        // from the last frame at or before the segment to the first one at or after it
+        size_t first = (size_t)(std::upper_bound(frames.begin(), frames.end(), middle - half) - frames.begin()) - 1;
+        size_t last = (size_t)(std::lower_bound(frames.begin(), frames.end(), segmentEnd) - frames.begin());
+        last = std::min(last, frames.size() - 1);
+        uint32_t frameCount = (uint32_t)(last - first + 1);
+        uint32_t n = std::min(m_Order, frameCount);
+
+        basis.resize((size_t)frameCount * n);
+        normal.assign((size_t)n * n, 0.0);
+        for (uint32_t k = 0; k < frameCount; k++)
+        {
+            double* row = basis.data() + (size_t)k * n;
+            ComputeBasis((frames[first + k] - middle) / half, n, row, unused);
+            for (uint32_t a = 0; a < n; a++)
+            {
+                for (uint32_t b = 0; b <= a; b++)
+                    normal[a * n + b] += row[a] * row[b];
+            }
+        }
+        for (uint32_t a = 0; a < n; a++)
+        {
+            for (uint32_t b = 0; b <= a; b++)
+            {
+                double sum = normal[a * n + b];
+                for (uint32_t c = 0; c < b; c++)
+                    sum -= normal[a * n + c] * normal[b * n + c];
+                normal[a * n + b] = a == b ? std::sqrt(std::max(sum, 0.0)) : sum / normal[b * n + b];
+            }
+        }
+
+        std::fill(seen.begin(), seen.end(), 0);
+        for (uint32_t k = 0; k < frameCount; k++)
+        {
+            double time = frames[first + k];
+            reader.Sample(time, bodies);
+
+            for (uint32_t i = 0; i < bodies.GetCount(); i++)
+            {
+                BodyHandle handle = bodies.GetHandle(i);
+                uint64_t key = ((uint64_t)handle.generation << 32) | handle.index;
+                auto iter = lookup.find(key);
+                if (iter == lookup.end())
+                {
+                    iter = lookup.emplace(key, (uint32_t)m_Bodies.size()).first;
+                    Body body;
+                    body.handle = handle;
+                    body.firstSegment = segment;
+                    body.rotation = bodies.GetRotations()[i];
+                    body.rotationSpeed = bodies.GetRotationSpeeds()[i];
+                    body.rotationTime = time;
+                    m_Bodies.push_back(std::move(body));
+                    seen.resize(m_Bodies.size(), 0);
+                    masses.resize(m_Bodies.size());
+                    radii.resize(m_Bodies.size());
+                }
+
+                uint32_t body = iter->second;
+                if (samples.size() < (size_t)m_Bodies.size() * frameCount)
+                    samples.resize((size_t)m_Bodies.size() * frameCount);
+                samples[(size_t)body * frameCount + k] = bodies.GetPositions()[i];
+                seen[body]++;
+                if (k == 0)
+                {
+                    masses[body] = bodies.GetMasses()[i];
+                    radii[body] = bodies.GetRadii()[i];
+                }
+            }
+        }
+
+        for (uint32_t b = 0; b < (uint32_t)m_Bodies.size(); b++)
+        {
+            Body& body = m_Bodies[b];
+            if (seen[b] != frameCount)
+                continue;
+            // handles are never reused, a body missing for a segment is gone for good
+            if (body.segmentCount == 0)
+                body.firstSegment = segment;
+            else if (body.firstSegment + body.segmentCount != segment)
+                continue;
+
+            // right hand side, then forward and back substitution with the factor
+            const glm::dvec3* values = samples.data() + (size_t)b * frameCount;
+            solution.assign(n, glm::dvec3(0.0));
+            for (uint32_t k = 0; k < frameCount; k++)
+            {
+                for (uint32_t j = 0; j < n; j++)
+                    solution[j] += values[k] * basis[(size_t)k * n + j];
+            }
+            for (uint32_t a = 0; a < n; a++)
+            {
+                for (uint32_t c = 0; c < a; c++)
+                    solution[a] -= solution[c] * normal[a * n + c];
+                solution[a] /= normal[a * n + a];
+            }
+            for (uint32_t a = n; a-- > 0;)
+            {
+                for (uint32_t c = a + 1; c < n; c++)
+                    solution[a] -= solution[c] * normal[c * n + a];
+                solution[a] /= normal[a * n + a];
+            }
+
+            // fewer frames than order leave the higher coefficients at zero
+            std::fill(coefficients.begin(), coefficients.end(), 0.0);
+            for (uint32_t j = 0; j < n; j++)
+            {
+                coefficients[j] = solution[j].x;
+                coefficients[m_Order + j] = solution[j].y;
+                coefficients[2 * m_Order + j] = solution[j].z;
+            }
+            for (uint32_t k = 0; k < frameCount; k++)
+            {
+                glm::dvec3 fitted{0.0};
+                for (uint32_t j = 0; j < n; j++)
+                    fitted += solution[j] * basis[(size_t)k * n + j];
+                m_MaxFitError = std::max(m_MaxFitError, glm::length(fitted - values[k]));
+            }
+
+            body.coefficients.insert(body.coefficients.end(), coefficients.begin(), coefficients.end());
+            body.masses.push_back(masses[b]);
+            body.radii.push_back(radii[b]);
+            body.segmentCount++;
+        }
+    }
+
+    // bodies that never lasted a whole segment
+    m_Bodies.erase(std::remove_if(m_Bodies.begin(), m_Bodies.end(), [](const Body& body) { return body.segmentCount == 0; }), m_Bodies.end());
+}
+
+void Ephemeris::Build(const Sampler& sampler, double start, double end, double span, uint32_t order)
+{
+    if (!(end > start) || !(span > 0.0))
+        throw std::runtime_error("Ephemeris needs a time range and a positive segment span");
+
+    m_Order = std::clamp(order, 2u, MAX_ORDER);
+    m_SegmentCount = (uint32_t)std::max(std::ceil((end - start) / span), 1.0);
+    m_Span = (end - start) / (double)m_SegmentCount;
+    m_Start = start;
+    m_MaxFitError = 0.0;
+    m_Bodies.clear();
+
+    // Chebyshev nodes of the first kind, sampling there turns the fit into a cosine sum
+    uint32_t n = m_Order;
+    std::vector<double> nodes(n);
+    std::vector<double> cosines(n * n);
+    for (uint32_t k = 0; k < n; k++)
+    {
+        nodes[k] = std::cos(PI * ((double)k + 0.5) / (double)n);
+        for (uint32_t j = 0; j < n; j++)
+            cosines[j * n + k] = std::cos(PI * (double)j * ((double)k + 0.5) / (double)n);
+    }
+    std::vector<double> startBasis(n), endBasis(n), unused(n);
+    ComputeBasis(-1.0, n, startBasis.data(), unused.data());
+    ComputeBasis(1.0, n, endBasis.data(), unused.data());
+
+    std::unordered_map<uint64_t, uint32_t> lookup; // handle -> body
+    BodyStore bodies;
+    std::vector<glm::dvec3> samples; // per body the nodes followed by segment start and end
+    std::vector<uint32_t> seen; // per body, samples present in the current segment
+    std::vector<double> masses, radii;
+    std::vector<double> coefficients(3 * n);
+    uint32_t sampleCount = n + 2;
+
+    for (uint32_t segment = 0; segment < m_SegmentCount; segment++)
+    {
+        double half = 0.5 * m_Span;
+        double middle = m_Start + ((double)segment + 0.5) * m_Span;
+        std::fill(seen.begin(), seen.end(), 0);
+        for (uint32_t k = 0; k < sampleCount; k++)
+        {
+            double time = k < n ? middle + half * nodes[k] : (k == n ? middle - half : middle + half);
+            sampler(time, bodies);
+
+            for (uint32_t i = 0; i < bodies.GetCount(); i++)
+            {
+                BodyHandle handle = bodies.GetHandle(i);
+                uint64_t key = ((uint64_t)handle.generation << 32) | handle.index;
+                auto iter = lookup.find(key);
+                if (iter == lookup.end())
+                {
+                    iter = lookup.emplace(key, (uint32_t)m_Bodies.size()).first;
+                    Body body;
+                    body.handle = handle;
+                    body.firstSegment = segment;
+                    body.rotation = bodies.GetRotations()[i];
+                    body.rotationSpeed = bodies.GetRotationSpeeds()[i];
+                    body.rotationTime = time;
+                    m_Bodies.push_back(std::move(body));
+                    samples.resize(m_Bodies.size() * sampleCount);
+                    seen.resize(m_Bodies.size(), 0);
+                    masses.resize(m_Bodies.size());
+                    radii.resize(m_Bodies.size());
+                }
+
+                uint32_t body = iter->second;
+                samples[body * sampleCount + k] = bodies.GetPositions()[i];
+                seen[body]++;
+                if (k == n)
+                {
+                    masses[body] = bodies.GetMasses()[i];
+                    radii[body] = bodies.GetRadii()[i];
+                }
+            }
+        }
+
+        for (uint32_t b = 0; b < (uint32_t)m_Bodies.size(); b++)
+        {
+            Body& body = m_Bodies[b];
+            if (seen[b] != sampleCount)
+                continue;
+            // handles are never reused, a body missing for a segment is gone for good
+            if (body.segmentCount == 0)
+                body.firstSegment = segment;
+            else if (body.firstSegment + body.segmentCount != segment)
+                continue;
+
+            const glm::dvec3* values = samples.data() + b * sampleCount;
+            for (uint32_t j = 0; j < n; j++)
+            {
+                glm::dvec3 sum{0.0};
+                for (uint32_t k = 0; k < n; k++)
+                    sum += values[k] * cosines[j * n + k];
+                sum *= (j == 0 ? 1.0 : 2.0) / (double)n;
+                coefficients[j] = sum.x;
+                coefficients[n + j] = sum.y;
+                coefficients[2 * n + j] = sum.z;
+            }
+
+            double error = std::max(glm::length(Sum(coefficients.data(), startBasis.data(), n) - values[n]),
+                glm::length(Sum(coefficients.data(), endBasis.data(), n) - values[n + 1]));
+            m_MaxFitError = std::max(m_MaxFitError, error);
+
+            body.coefficients.insert(body.coefficients.end(), coefficients.begin(), coefficients.end());
+            body.masses.push_back(masses[b]);
+            body.radii.push_back(radii[b]);
+            body.segmentCount++;
+        }
+    }
+
+    // bodies that never lasted a whole segment
+    m_Bodies.erase(std::remove_if(m_Bodies.begin(), m_Bodies.end(), [](const Body& body) { return body.segmentCount == 0; }), m_Bodies.end());
+}
+
+void Ephemeris::ImportText(const std::string& filepath, double span, uint32_t order)
+{
+    std::ifstream file(filepath);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open ephemeris file " + filepath);
+
+    std::vector<Table> tables;
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream stream(line);
+        std::string record;
+        if (!(stream >> record))
+            continue;
+
+        if (record == "body")
+        {
+            Table table{};
+            if (!(stream >> table.handle.index >> table.mass >> table.radius))
+                throw std::runtime_error(filepath + ":" + std::to_string(lineNumber) + " expected body slot mass radius");
+            table.handle.generation = 0;
+            for (const Table& other : tables)
+            {
+                if (other.handle.index == table.handle.index)
+                {
+                    throw std::runtime_error(filepath + ":" + std::to_string(lineNumber) + " slot "
+                        + std::to_string(table.handle.index) + " is taken by an earlier body");
+                }
+            }
+            tables.push_back(std::move(table));
+            continue;
+        }
+
+        double time;
+        glm::dvec3 position, velocity;
+        stream.clear();
+        stream.str(line);
+        if (!(stream >> time >> position.x >> position.y >> position.z >> velocity.x >> velocity.y >> velocity.z))
+            throw std::runtime_error(filepath + ":" + std::to_string(lineNumber) + " expected t x y z vx vy vz");
+        if (tables.empty())
+            throw std::runtime_error(filepath + ":" + std::to_string(lineNumber) + " sample before the first body line");
+        Table& table = tables.back();
+        if (!table.times.empty() && time <= table.times.back())
+            throw std::runtime_error(filepath + ":" + std::to_string(lineNumber) + " samples have to be in increasing time");
+        table.times.push_back(time);
+        table.positions.push_back(position);
+        table.velocities.push_back(velocity);
+    }
+
+    double start = std::numeric_limits<double>::infinity();
+    double end = -std::numeric_limits<double>::infinity();
+    for (const Table& table : tables)
+    {
+        if (table.times.size() < 2)
+            throw std::runtime_error(filepath + " body " + std::to_string(table.handle.index) + " needs at least two samples");
+        start = std::min(start, table.times.front());
+        end = std::max(end, table.times.back());
+    }
+    if (tables.empty())
+        throw std::runtime_error(filepath + " has no bodies");
+
+    // bodies only exist while their table covers time
+    Build([&tables](double time, BodyStore& bodies)
+    {
+        std::vector<BodyHandle> handles;
+        bodies.GetPositions().clear();
+        bodies.GetVelocities().clear();
+        bodies.GetMasses().clear();
+        bodies.GetRadii().clear();
+        for (const Table& table : tables)
+        {
+            if (time < table.times.front() || time > table.times.back())
+                continue;
+            handles.push_back(table.handle);
+            bodies.GetPositions().push_back(InterpolateTable(table, time));
+            bodies.GetVelocities().push_back(glm::dvec3(0.0));
+            bodies.GetMasses().push_back(table.mass);
+            bodies.GetRadii().push_back(table.radius);
+        }
+        bodies.GetRotations().assign(handles.size(), glm::dvec3(0.0));
+        bodies.GetRotationSpeeds().assign(handles.size(), glm::dvec3(0.0));
+        bodies.RestoreSlots(handles);
+    }, start, end, span, order);
+}
+
+void Ephemeris::Save(const std::string& filepath) const
+{
+    std::vector<uint8_t> payload;
+    for (const Body& body : m_Bodies)
+    {
+        BodyRecord record{};
+        record.index = body.handle.index;
+        record.generation = body.handle.generation;
+        record.firstSegment = body.firstSegment;
+        record.segmentCount = body.segmentCount;
+        std::memcpy(record.rotation, &body.rotation, sizeof(record.rotation));
+        std::memcpy(record.rotationSpeed, &body.rotationSpeed, sizeof(record.rotationSpeed));
+        record.rotationTime = body.rotationTime;
+        Append(payload, &record, 1);
+        Append(payload, body.masses.data(), body.masses.size());
+        Append(payload, body.radii.data(), body.radii.size());
+        Append(payload, body.coefficients.data(), body.coefficients.size());
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = EPHEMERIS_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.order = m_Order;
+    header.segmentCount = m_SegmentCount;
+    header.bodyCount = (uint32_t)m_Bodies.size();
+    header.start = m_Start;
+    header.span = m_Span;
+    header.maxFitError = m_MaxFitError;
+    header.payloadSize = payload.size();
+    header.checksum = ComputeChecksum(header, payload);
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to create ephemeris file " + filepath);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(payload.data()), (std::streamsize)payload.size());
+    if (!file.good())
+        throw std::runtime_error("Failed to write ephemeris file " + filepath);
+}
+
+void Ephemeris::Load(const std::string& filepath)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open ephemeris file " + filepath);
+
+    FileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error(filepath + " is not an ephemeris file");
+    if (header.byteOrder != BYTE_ORDER_MARK)
+        throw std::runtime_error(filepath + " was written on a machine with different byte order");
+    if (header.version != EPHEMERIS_VERSION)
+        throw std::runtime_error(filepath + " is ephemeris version " + std::to_string(header.version) + ", expected " + std::to_string(EPHEMERIS_VERSION));
+    if (header.order < 2 || header.order > MAX_ORDER)
+        throw std::runtime_error(filepath + " has an invalid order");
+
+    // a damaged size would otherwise be allocated before the checksum can catch it
+    std::streampos payloadStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    if (!file || (uint64_t)(file.tellg() - payloadStart) != header.payloadSize)
+        throw std::runtime_error(filepath + " is damaged");
+    file.seekg(payloadStart);
+
+    std::vector<uint8_t> payload(header.payloadSize);
+    file.read(reinterpret_cast<char*>(payload.data()), (std::streamsize)payload.size());
+    if (!file || ComputeChecksum(header, payload) != header.checksum)
+        throw std::runtime_error(filepath + " is damaged");
+
+    // parsed into locals first, a bad file leaves the current ephemeris alone
+    std::vector<Body> bodies(header.bodyCount);
+    size_t offset = 0;
+    for (Body& body : bodies)
+    {
+        BodyRecord record{};
+        Take(payload, offset, &record, 1);
+        if ((uint64_t)record.firstSegment + record.segmentCount > header.segmentCount)
+            throw std::runtime_error(filepath + " is damaged");
+        body.handle = {record.index, record.generation};
+        body.firstSegment = record.firstSegment;
+        body.segmentCount = record.segmentCount;
+        std::memcpy(&body.rotation, record.rotation, sizeof(record.rotation));
+        std::memcpy(&body.rotationSpeed, record.rotationSpeed, sizeof(record.rotationSpeed));
+        body.rotationTime = record.rotationTime;
+        body.masses.resize(body.segmentCount);
+        body.radii.resize(body.segmentCount);
+        body.coefficients.resize((size_t)body.segmentCount * 3 * header.order);
+        Take(payload, offset, body.masses.data(), body.masses.size());
+        Take(payload, offset, body.radii.data(), body.radii.size());
+        Take(payload, offset, body.coefficients.data(), body.coefficients.size());
+    }
+
+    m_Start = header.start;
+    m_Span = header.span;
+    m_SegmentCount = header.segmentCount;
+    m_Order = header.order;
+    m_MaxFitError = header.maxFitError;
+    m_Bodies = std::move(bodies);
+}
+
+void Ephemeris::Clear()
+{
+    m_Start = 0.0;
+    m_Span = 0.0;
+    m_SegmentCount = 0;
+    m_Order = 0;
+    m_MaxFitError = 0.0;
+    m_Bodies.clear();
+}
+
+uint32_t Ephemeris::FindSegment(double time, double& u) const
+{
+    double offset = std::clamp(time - m_Start, 0.0, m_Span * (double)m_SegmentCount);
+    uint32_t segment = std::min((uint32_t)(offset / m_Span), m_SegmentCount - 1);
+    u = std::clamp((offset - ((double)segment + 0.5) * m_Span) / (0.5 * m_Span), -1.0, 1.0);
+    return segment;
+}
+
+const Ephemeris::Body* Ephemeris::FindBody(BodyHandle handle) const
+{
+    for (const Body& body : m_Bodies)
+    {
+        if (body.handle == handle)
+            return &body;
+    }
+    return nullptr;
+}
+
+void Ephemeris::Evaluate(double time, BodyStore& bodies) const
+{
+    std::vector<BodyHandle> handles;
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    auto& radii = bodies.GetRadii();
+    auto& rotations = bodies.GetRotations();
+    auto& rotationSpeeds = bodies.GetRotationSpeeds();
+    positions.clear();
+    velocities.clear();
+    masses.clear();
+    radii.clear();
+    rotations.clear();
+    rotationSpeeds.clear();
+    if (IsEmpty())
+    {
+        bodies.RestoreSlots(handles);
+        return;
+    }
+
+    double u;
+    uint32_t segment = FindSegment(time, u);
+    time = std::clamp(time, GetStartTime(), GetEndTime());
+    double value[MAX_ORDER], derivative[MAX_ORDER];
+    ComputeBasis(u, m_Order, value, derivative);
+    double scale = 2.0 / m_Span; // du/dt
+
+    for (const Body& body : m_Bodies)
+    {
+        if (segment < body.firstSegment || segment >= body.firstSegment + body.segmentCount)
+            continue;
+
+        uint32_t local = segment - body.firstSegment;
+        const double* coefficients = body.coefficients.data() + (size_t)local * 3 * m_Order;
+        handles.push_back(body.handle);
+        positions.push_back(Sum(coefficients, value, m_Order));
+        velocities.push_back(Sum(coefficients, derivative, m_Order) * scale);
+        masses.push_back(body.masses[local]);
+        radii.push_back(body.radii[local]);
+        rotations.push_back(body.rotation + body.rotationSpeed * (time - body.rotationTime));
+        rotationSpeeds.push_back(body.rotationSpeed);
+    }
+    bodies.RestoreSlots(handles);
+}
+
+bool Ephemeris::EvaluatePosition(BodyHandle handle, double time, glm::dvec3& position) const
+{
+    const Body* body = FindBody(handle);
+    if (IsEmpty() || !body)
+        return false;
+
+    double u;
+    uint32_t segment = FindSegment(time, u);
+    if (segment < body->firstSegment || segment >= body->firstSegment + body->segmentCount)
+        return false;
+
+    double value[MAX_ORDER], derivative[MAX_ORDER];
+    ComputeBasis(u, m_Order, value, derivative);
+    position = Sum(body->coefficients.data() + (size_t)(segment - body->firstSegment) * 3 * m_Order, value, m_Order);
+    return true;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "bodyStore.h"
+#include "trajectory.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#define EPHEMERIS_VERSION 1
+
+/**
+ * @brief Positions as piecewise Chebyshev polynomials of time, the way JPL ephemerides store them. Time
+ * is cut into segments of equal length and every body gets order coefficients per axis and segment.
+ * Looking a time up is a division for the segment and a polynomial sum per axis, no matter how long the
+ * ephemeris is or where the last lookup was, so scrubbing through centuries costs the same as playing.
+ *
+ * Sampled sources are fitted at Chebyshev nodes, which makes the fit a plain cosine sum and keeps its
+ * error spread evenly over the segment, recordings by least squares to their frames. Velocities are the
+ * derivative of the polynomial.
+ *
+ * @note A body is only covered by segments it exists for the whole of, one that merges vanishes at the
+ * start of the segment the merge falls into.
+ */
+class Ephemeris
+{
+public:
+    static constexpr uint32_t MAX_ORDER = 32;
+    /**
+     * @brief Fills bodies with the state at time, the store is overwritten
+     */
+    using Sampler = std::function<void(double time, BodyStore& bodies)>;
+
+    /**
+     * @brief Least squares fit to the frames of a recording, span is seconds per segment and is shortened
+     * so segments tile the recording exactly. Frames are the simulated states, the fit follows them rather
+     * than the cubic playback draws between them, so it differs from playback by about as much as playback
+     * is off. A segment with fewer frames than order gets as many coefficients as it has frames.
+     * @throws std::runtime_error when span isn't positive or the recording is empty
+     */
+    void Build(TrajectoryReader& reader, double span, uint32_t order = 12);
+    /**
+     * @brief Fits to a recording with order 12 segments of 4 days or 16 frames, whichever is longer, halved
+     * while a frame is more than 1 km off the fit but never to fewer than 16 frames. A segment stores fewer
+     * numbers than its frames, the file ends up about the size of the recording or smaller. Recordings
+     * too coarse for their fastest body don't reach 1 km, a year of the solar system recorded daily fits
+     * its frames within 7.5 km and follows the Moon within 40 km between them, playback is 116 km off.
+     * @throws std::runtime_error when the recording is empty
+     */
+    void Build(TrajectoryReader& reader);
+    /**
+     * @brief Fits to any state source over start to end
+     * @throws std::runtime_error when span isn't positive or the range is empty
+     */
+    void Build(const Sampler& sampler, double start, double end, double span, uint32_t order = 12);
+    /**
+     * @brief Fits to tables of positions and velocities, the format of JPL Horizons vector tables.
+     * Between samples the state follows a cubic Hermite curve, so samples can be coarser than segments.
+     *
+     *     # comment
+     *     body <slot> <mass> <radius>
+     *     <t> <x> <y> <z> <vx> <vy> <vz>
+     *     ...
+     *
+     * Slot is the handle index the body gets, for a scenario that's its position among the body lines.
+     * Units are km, km/s, kg, s, samples of a body in increasing time.
+     * @throws std::runtime_error when the file can't be opened or parsed
+     */
+    void ImportText(const std::string& filepath, double span, uint32_t order = 12);
+
+    /**
+     * @throws std::runtime_error when the file can't be written
+     */
+    void Save(const std::string& filepath) const;
+    /**
+     * @throws std::runtime_error when the file can't be read, is from another version or is damaged
+     */
+    void Load(const std::string& filepath);
+
+    /**
+     * @brief Bodies that exist at time with their state, time is clamped to the ephemeris
+     */
+    void Evaluate(double time, BodyStore& bodies) const;
+    /**
+     * @return false when the body isn't covered at time
+     */
+    bool EvaluatePosition(BodyHandle handle, double time, glm::dvec3& position) const;
+
+    void Clear();
+
+    inline bool IsEmpty() const { return m_SegmentCount == 0; }
+    inline double GetStartTime() const { return m_Start; }
+    inline double GetEndTime() const { return m_Start + m_Span * (double)m_SegmentCount; }
+    inline double GetSpan() const { return m_Span; }
+    inline uint32_t GetOrder() const { return m_Order; }
+    inline uint32_t GetSegmentCount() const { return m_SegmentCount; }
+    inline uint32_t GetBodyCount() const { return (uint32_t)m_Bodies.size(); }
+    /**
+     * @brief Largest distance between fit and source, at recorded frames or at segment ends where fits
+     * to sampled sources are worst. km
+     */
+    inline double GetMaxFitError() const { return m_MaxFitError; }
+private:
+    struct Body
+    {
+        BodyHandle handle;
+        uint32_t firstSegment = 0;
+        uint32_t segmentCount = 0;
+        glm::dvec3 rotation{0.0}; // at rotationTime
+        glm::dvec3 rotationSpeed{0.0};
+        double rotationTime = 0.0;
+        std::vector<double> masses; // per segment
+        std::vector<double> radii;
+        std::vector<double> coefficients; // per segment x, y and z with order coefficients each
+    };
+
+    void FitFrames(TrajectoryReader& reader, const std::vector<double>& frames, double span, uint32_t order);
+    // segment holding time and time mapped to -1 - 1 inside it
+    uint32_t FindSegment(double time, double& u) const;
+    const Body* FindBody(BodyHandle handle) const;
+
+    double m_Start = 0.0;
+    double m_Span = 0.0;
+    uint32_t m_SegmentCount = 0;
+    uint32_t m_Order = 0;
+    double m_MaxFitError = 0.0;
+    std::vector<Body> m_Bodies;
+};
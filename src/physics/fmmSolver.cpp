@@ -0,0 +1,386 @@
+#include "fmmSolver.h"
+
+#include <cmath>
+#include <algorithm>
+
+static double Binomial(int n, int k)
+{
+    double result = 1.0;
+    for (int i = 1; i <= k; i++)
+        result = result * (n - k + i) / i;
+    return result;
+}
+
+FmmSolver::FmmSolver(int order, float openingAngle)
+    : m_Order(std::clamp(order, 1, MAX_ORDER)), m_OpeningAngle(openingAngle)
+{
+    BuildTables();
+}
+
+void FmmSolver::SetOrder(int order)
+{
+    order = std::clamp(order, 1, MAX_ORDER);
+    if (order == m_Order)
+        return;
+
+    m_Order = order;
+    BuildTables();
+}
+
+int FmmSolver::GetTermIndex(int x, int y, int z) const
+{
+    if (x < 0 || y < 0 || z < 0 || x + y + z > m_Order)
+        return -1;
+    return m_TermIndices[(x * (m_Order + 1) + y) * (m_Order + 1) + z];
+}
+
+/**
+ * @brief Enumerates multi-indices up to m_Order and precomputes every translation coefficient
+ */
+void FmmSolver::BuildTables()
+{
+    int size = m_Order + 1;
+    m_Terms.clear();
+    m_TermIndices.assign(size * size * size, -1);
+
+    for (int degree = 0; degree <= m_Order; degree++)
+    {
+        for (int x = degree; x >= 0; x--)
+        {
+            for (int y = degree - x; y >= 0; y--)
+            {
+                int z = degree - x - y;
+                m_TermIndices[(x * size + y) * size + z] = (int)m_Terms.size();
+                m_Terms.push_back({x, y, z, degree, {}, {}}); // neighbours are filled in once every term exists
+            }
+        }
+    }
+    m_TermCount = (uint32_t)m_Terms.size();
+
+    for (Term& term : m_Terms)
+    {
+        int powers[3] = {term.x, term.y, term.z};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            int one[3] = {powers[0], powers[1], powers[2]};
+            int two[3] = {powers[0], powers[1], powers[2]};
+            one[axis] -= 1;
+            two[axis] -= 2;
+            term.minusOne[axis] = GetTermIndex(one[0], one[1], one[2]);
+            term.minusTwo[axis] = GetTermIndex(two[0], two[1], two[2]);
+        }
+    }
+
+    // (s + e)^k = sum over l <= k of C(k, l) e^l s^(k - l)
+    m_ShiftTranslations.clear();
+    for (uint32_t k = 0; k < m_TermCount; k++)
+    {
+        const Term& outer = m_Terms[k];
+        for (uint32_t l = 0; l < m_TermCount; l++)
+        {
+            const Term& inner = m_Terms[l];
+            if (inner.x > outer.x || inner.y > outer.y || inner.z > outer.z)
+                continue;
+
+            double coefficient = Binomial(outer.x, inner.x) * Binomial(outer.y, inner.y) * Binomial(outer.z, inner.z);
+            uint32_t shift = GetTermIndex(outer.x - inner.x, outer.y - inner.y, outer.z - inner.z);
+            m_ShiftTranslations.push_back({k, l, shift, coefficient});
+        }
+    }
+
+    // L_n = sum over k of C(n + k, n) M_k D_(n + k), truncated at |n| + |k| <= order
+    m_LocalTranslations.clear();
+    for (uint32_t n = 0; n < m_TermCount; n++)
+    {
+        const Term& local = m_Terms[n];
+        for (uint32_t k = 0; k < m_TermCount; k++)
+        {
+            const Term& multipole = m_Terms[k];
+            if (local.degree + multipole.degree > m_Order)
+                continue;
+
+            double coefficient = Binomial(local.x + multipole.x, local.x) * Binomial(local.y + multipole.y, local.y) * 
+                Binomial(local.z + multipole.z, local.z);
+            uint32_t derivative = GetTermIndex(local.x + multipole.x, local.y + multipole.y, local.z + multipole.z);
+            m_LocalTranslations.push_back({n, k, derivative, coefficient});
+        }
+    }
+}
+
+void FmmSolver::ComputeMonomials(const glm::dvec3& v, double* monomials) const
+{
+    double powers[3][MAX_ORDER + 1];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        powers[axis][0] = 1.0;
+        for (int i = 1; i <= m_Order; i++)
+            powers[axis][i] = powers[axis][i - 1] * v[axis];
+    }
+
+    for (uint32_t t = 0; t < m_TermCount; t++)
+    {
+        const Term& term = m_Terms[t];
+        monomials[t] = powers[0][term.x] * powers[1][term.y] * powers[2][term.z];
+    }
+}
+
+/**
+ * @brief Taylor coefficients of 1/|r|, derivatives[k] = (1/k!) d^k/dr^k (1/|r|)
+ * @note Uses recurrence |k| r^2 D_k = -(2|k| - 1) sum r_i D_(k - e_i) - (|k| - 1) sum D_(k - 2e_i)
+ */
+void FmmSolver::ComputeDerivatives(const glm::dvec3& r, double* derivatives) const
+{
+    double distanceSquared = glm::dot(r, r);
+    double inverseDistanceSquared = 1.0 / distanceSquared;
+    derivatives[0] = std::sqrt(inverseDistanceSquared);
+
+    for (uint32_t t = 1; t < m_TermCount; t++)
+    {
+        const Term& term = m_Terms[t];
+        double n = (double)term.degree;
+        double sumOne = 0.0;
+        double sumTwo = 0.0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (term.minusOne[axis] >= 0)
+                sumOne += r[axis] * derivatives[term.minusOne[axis]];
+            if (term.minusTwo[axis] >= 0)
+                sumTwo += derivatives[term.minusTwo[axis]];
+        }
+        derivatives[t] = -((2.0 * n - 1.0) * sumOne + (n - 1.0) * sumTwo) * inverseDistanceSquared / n;
+    }
+}
+
+void FmmSolver::ComputeAccelerations(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+    std::vector<glm::dvec3>& accelerations)
+{
+    uint32_t count = (uint32_t)positions.size();
+    accelerations.assign(count, glm::dvec3(0.0));
+    if (count < 2)
+        return;
+
+    m_Tree.Build(positions, masses, LEAF_CAPACITY);
+    uint32_t nodeCount = (uint32_t)m_Tree.GetNodes().size();
+    m_Multipoles.assign(nodeCount * m_TermCount, 0.0);
+    m_Locals.assign(nodeCount * m_TermCount, 0.0);
+
+    Upward(positions, masses);
+    InteractSelf(0, positions, masses, accelerations);
+    Downward(positions, accelerations);
+}
+
+/**
+ * @brief P2M in leaves and M2M towards the root, multipoles are taken about the center of mass
+ * with M_k = sum m (center - position)^k
+ */
+void FmmSolver::Upward(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses)
+{
+    auto& nodes = m_Tree.GetNodes();
+    auto& order = m_Tree.GetOrder();
+    std::vector<double> monomials(m_TermCount);
+
+    // children are always stored after their parent
+    for (int32_t nodeIndex = (int32_t)nodes.size() - 1; nodeIndex >= 0; nodeIndex--)
+    {
+        const Octree::Node& node = nodes[nodeIndex];
+        double* multipole = &m_Multipoles[nodeIndex * m_TermCount];
+
+        if (node.leaf)
+        {
+            for (uint32_t i = node.firstBody; i < node.firstBody + node.bodyCount; i++)
+            {
+                uint32_t body = order[i];
+                ComputeMonomials(node.centerOfMass - positions[body], monomials.data());
+                for (uint32_t t = 0; t < m_TermCount; t++)
+                    multipole[t] += masses[body] * monomials[t];
+            }
+            continue;
+        }
+
+        for (uint32_t octant = 0; octant < 8; octant++)
+        {
+            int32_t childIndex = node.children[octant];
+            if (childIndex < 0)
+                continue;
+
+            const double* childMultipole = &m_Multipoles[childIndex * m_TermCount];
+            ComputeMonomials(node.centerOfMass - nodes[childIndex].centerOfMass, monomials.data());
+            for (const Translation& translation : m_ShiftTranslations)
+                multipole[translation.target] += translation.coefficient * childMultipole[translation.source] * monomials[translation.shift];
+        }
+    }
+}
+
+void FmmSolver::InteractSelf(uint32_t nodeIndex, const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+    std::vector<glm::dvec3>& accelerations)
+{
+    const Octree::Node& node = m_Tree.GetNodes()[nodeIndex];
+    auto& order = m_Tree.GetOrder();
+
+    if (node.leaf)
+    {
+        for (uint32_t i = node.firstBody; i < node.firstBody + node.bodyCount; i++)
+        {
+            for (uint32_t j = i + 1; j < node.firstBody + node.bodyCount; j++)
+            {
+                uint32_t a = order[i];
+                uint32_t b = order[j];
+                glm::dvec3 offset = positions[b] - positions[a];
+                double distanceSquared = glm::dot(offset, offset);
+                if (distanceSquared <= 0.0)
+                    continue;
+                double inverseDistance = 1.0 / std::sqrt(distanceSquared);
+                double strength = GRAVITATIONAL_CONSTANT * inverseDistance * inverseDistance * inverseDistance;
+                accelerations[a] += offset * (strength * masses[b]);
+                accelerations[b] -= offset * (strength * masses[a]);
+            }
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        if (node.children[i] < 0)
+            continue;
+
+        InteractSelf(node.children[i], positions, masses, accelerations);
+        for (uint32_t j = i + 1; j < 8; j++)
+        {
+            if (node.children[j] >= 0)
+                Interact(node.children[i], node.children[j], positions, masses, accelerations);
+        }
+    }
+}
+
+/**
+ * @brief Mutual interaction of two distinct nodes, far field goes through expansions, near field is split further
+ */
+void FmmSolver::Interact(uint32_t a, uint32_t b, const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+    std::vector<glm::dvec3>& accelerations)
+{
+    auto& nodes = m_Tree.GetNodes();
+    const Octree::Node& nodeA = nodes[a];
+    const Octree::Node& nodeB = nodes[b];
+    if (nodeA.mass <= 0.0 && nodeB.mass <= 0.0)
+        return;
+
+    // for small nodes summing pairs directly is cheaper than two expansion translations
+    bool fewPairs = (double)nodeA.bodyCount * (double)nodeB.bodyCount <= (double)m_LocalTranslations.size();
+
+    double distance = glm::length(nodeA.centerOfMass - nodeB.centerOfMass);
+    if (!fewPairs && nodeA.radius + nodeB.radius < m_OpeningAngle * distance)
+    {
+        MultipoleToLocal(a, b);
+        MultipoleToLocal(b, a);
+        return;
+    }
+
+    // node body ranges are contiguous so this works for any two nodes, not only leaves
+    if (fewPairs || (nodeA.leaf && nodeB.leaf))
+    {
+        auto& order = m_Tree.GetOrder();
+        for (uint32_t i = nodeA.firstBody; i < nodeA.firstBody + nodeA.bodyCount; i++)
+        {
+            uint32_t bodyA = order[i];
+            glm::dvec3 accelerationA{0.0};
+            for (uint32_t j = nodeB.firstBody; j < nodeB.firstBody + nodeB.bodyCount; j++)
+            {
+                uint32_t bodyB = order[j];
+                glm::dvec3 offset = positions[bodyB] - positions[bodyA];
+                double distanceSquared = glm::dot(offset, offset);
+                if (distanceSquared <= 0.0)
+                    continue;
+                double inverseDistance = 1.0 / std::sqrt(distanceSquared);
+                double strength = GRAVITATIONAL_CONSTANT * inverseDistance * inverseDistance * inverseDistance;
+                accelerationA += offset * (strength * masses[bodyB]);
+                accelerations[bodyB] -= offset * (strength * masses[bodyA]);
+            }
+            accelerations[bodyA] += accelerationA;
+        }
+        return;
+    }
+
+    // split the bigger node
+    bool splitA = nodeB.leaf || (!nodeA.leaf && nodeA.radius >= nodeB.radius);
+    const Octree::Node& split = splitA ? nodeA : nodeB;
+    for (uint32_t octant = 0; octant < 8; octant++)
+    {
+        if (split.children[octant] < 0)
+            continue;
+
+        if (splitA)
+            Interact(split.children[octant], b, positions, masses, accelerations);
+        else
+            Interact(a, split.children[octant], positions, masses, accelerations);
+    }
+}
+
+/**
+ * @brief Adds far field of source node to local expansion of target node
+ */
+void FmmSolver::MultipoleToLocal(uint32_t source, uint32_t target)
+{
+    auto& nodes = m_Tree.GetNodes();
+    if (nodes[source].mass <= 0.0)
+        return;
+
+    double derivatives[(MAX_ORDER + 1) * (MAX_ORDER + 2) * (MAX_ORDER + 3) / 6];
+    ComputeDerivatives(nodes[target].centerOfMass - nodes[source].centerOfMass, derivatives);
+
+    const double* multipole = &m_Multipoles[source * m_TermCount];
+    double* local = &m_Locals[target * m_TermCount];
+    for (const Translation& translation : m_LocalTranslations)
+        local[translation.target] += translation.coefficient * multipole[translation.source] * derivatives[translation.shift];
+}
+
+/**
+ * @brief L2L towards the leaves and L2P, acceleration is G times gradient of the local expansion
+ */
+void FmmSolver::Downward(const std::vector<glm::dvec3>& positions, std::vector<glm::dvec3>& accelerations)
+{
+    auto& nodes = m_Tree.GetNodes();
+    auto& order = m_Tree.GetOrder();
+    std::vector<double> monomials(m_TermCount);
+
+    for (uint32_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++)
+    {
+        const Octree::Node& node = nodes[nodeIndex];
+        const double* local = &m_Locals[nodeIndex * m_TermCount];
+
+        if (node.leaf)
+        {
+            for (uint32_t i = node.firstBody; i < node.firstBody + node.bodyCount; i++)
+            {
+                uint32_t body = order[i];
+                ComputeMonomials(positions[body] - node.centerOfMass, monomials.data());
+
+                glm::dvec3 gradient{0.0};
+                for (uint32_t t = 1; t < m_TermCount; t++)
+                {
+                    const Term& term = m_Terms[t];
+                    if (term.minusOne[0] >= 0)
+                        gradient.x += local[t] * term.x * monomials[term.minusOne[0]];
+                    if (term.minusOne[1] >= 0)
+                        gradient.y += local[t] * term.y * monomials[term.minusOne[1]];
+                    if (term.minusOne[2] >= 0)
+                        gradient.z += local[t] * term.z * monomials[term.minusOne[2]];
+                }
+                accelerations[body] += gradient * GRAVITATIONAL_CONSTANT;
+            }
+            continue;
+        }
+
+        for (uint32_t octant = 0; octant < 8; octant++)
+        {
+            int32_t childIndex = node.children[octant];
+            if (childIndex < 0)
+                continue;
+
+            double* childLocal = &m_Locals[childIndex * m_TermCount];
+            ComputeMonomials(nodes[childIndex].centerOfMass - node.centerOfMass, monomials.data());
+            // here translation.target is the higher index, L'_l += C(k, l) L_k u^(k - l)
+            for (const Translation& translation : m_ShiftTranslations)
+                childLocal[translation.source] += translation.coefficient * local[translation.target] * monomials[translation.shift];
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "gravitySolver.h"
+#include "octree.h"
+
+/**
+ * @brief Fast Multipole Method with cartesian Taylor expansions and dual tree traversal.
+ * Every node carries a multipole expansion of its bodies and a local expansion of the field
+ * from far away nodes, pairs of nodes are split into near field (direct summation between leaves)
+ * and far field (multipole to local translation), which gives O(N) force evaluation.
+ * @note Order is the highest expansion degree, error drops roughly like theta^(order+1).
+ * Pair of nodes is far field when (radiusA + radiusB) / distance < opening angle.
+ */
+class FmmSolver : public GravitySolver
+{
+public:
+    static constexpr int MAX_ORDER = 8;
+
+    FmmSolver(int order = 4, float openingAngle = 0.5f);
+
+    void ComputeAccelerations(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+        std::vector<glm::dvec3>& accelerations
+    ) override;
+
+    void SetOrder(int order);
+    inline int GetOrder() const { return m_Order; }
+    inline void SetOpeningAngle(float openingAngle) { m_OpeningAngle = openingAngle; }
+    inline float GetOpeningAngle() const { return m_OpeningAngle; }
+private:
+    static constexpr uint32_t LEAF_CAPACITY = 16;
+
+    struct Term
+    {
+        int x, y, z;
+        int degree;
+        int minusOne[3];  // index of this term with one power removed in given axis, -1 if not possible
+        int minusTwo[3];
+    };
+
+    // dst[target] += coefficient * src[source] * monomial[shift]
+    struct Translation
+    {
+        uint32_t target;
+        uint32_t source;
+        uint32_t shift;
+        double coefficient;
+    };
+
+    void BuildTables();
+    int GetTermIndex(int x, int y, int z) const;
+    void ComputeMonomials(const glm::dvec3& v, double* monomials) const;
+    void ComputeDerivatives(const glm::dvec3& r, double* derivatives) const;
+
+    void Upward(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses);
+    void Interact(uint32_t a, uint32_t b, const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, std::vector<glm::dvec3>& accelerations);
+    void InteractSelf(uint32_t node, const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, std::vector<glm::dvec3>& accelerations);
+    void MultipoleToLocal(uint32_t source, uint32_t target);
+    void Downward(const std::vector<glm::dvec3>& positions, std::vector<glm::dvec3>& accelerations);
+
+    int m_Order;
+    float m_OpeningAngle;
+
+    uint32_t m_TermCount = 0;
+    std::vector<Term> m_Terms;
+    std::vector<int> m_TermIndices; // (x, y, z) -> term
+    std::vector<Translation> m_ShiftTranslations; // used by both M2M and L2L
+    std::vector<Translation> m_LocalTranslations; // M2L, shift points into derivatives of 1/r
+
+    Octree m_Tree;
+    std::vector<double> m_Multipoles; // m_TermCount per node
+    std::vector<double> m_Locals;
+};
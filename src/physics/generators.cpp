@@ -0,0 +1,356 @@
+#include "generators.h"
+#include "kepler.h"
+#include "diagnostics.h"
+#include "random.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+#define STAR_DENSITY 1.41e12 // kg/km^3, the Sun's
+#define PLANET_DENSITY 5.5e12 // kg/km^3, the Earth's
+#define ROCK_DENSITY 2.0e12 // kg/km^3, asteroids and moons
+#define EARTH_MASS 5.9722e24 // kg
+#define JUPITER_MASS 1.89813e27 // kg
+#define SPHERE_CUTOFF 50.0 // scale radii, the few bodies further out would only stretch the tree
+#define DISK_CUTOFF 10.0 // scale lengths
+#define HERNQUIST_GRID 32 // samples to find the peak of the speed distribution at a radius
+
+namespace
+{
+    double RadiusFromDensity(double mass, double density)
+    {
+        return std::cbrt(3.0 * mass / (4.0 * M_PI * density));
+    }
+
+    /**
+     * @brief Moves bodies first to first + count so their center of mass rests at the origin
+     */
+    void CenterBodies(BodyStore& bodies, uint32_t first, uint32_t count)
+    {
+        auto& positions = bodies.GetPositions();
+        auto& velocities = bodies.GetVelocities();
+        auto& masses = bodies.GetMasses();
+
+        double totalMass = 0.0;
+        glm::dvec3 center{0.0}, centerVelocity{0.0};
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            totalMass += masses[i];
+            center += masses[i] * positions[i];
+            centerVelocity += masses[i] * velocities[i];
+        }
+        if (totalMass <= 0.0)
+            return;
+
+        center /= totalMass;
+        centerVelocity /= totalMass;
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            positions[i] -= center;
+            velocities[i] -= centerVelocity;
+        }
+    }
+
+    /**
+     * @brief Hernquist's isotropic distribution function without its constant factor, q^2 is binding
+     * energy in units of GM/a and runs from 0 at escape to 1 at rest in the center
+     */
+    double HernquistDistribution(double q)
+    {
+        double q2 = q * q;
+        double rest = 1.0 - q2;
+        if (rest <= 0.0)
+            return 0.0;
+        return (3.0 * std::asin(q) + q * std::sqrt(rest) * (1.0 - 2.0 * q2) * (8.0 * q2 * q2 - 8.0 * q2 - 3.0)) / std::pow(rest, 2.5);
+    }
+
+    /**
+     * @brief Radii from the inverted cumulative mass, speeds by rejection from the distribution function
+     * g(q) = q^2 (1 - q^2)^3.5 as in Aarseth, Henon and Wielen (1974)
+     */
+    void AddPlummerSphere(BodyStore& bodies, uint32_t count, double mass, double scale, Random& random)
+    {
+        uint32_t first = bodies.Append(count);
+        auto& positions = bodies.GetPositions();
+        auto& velocities = bodies.GetVelocities();
+        double bodyMass = mass / (double)count;
+        double bodyRadius = RadiusFromDensity(bodyMass, STAR_DENSITY);
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            double r;
+            do
+                r = scale / std::sqrt(std::pow(random.UniformOpen(), -2.0 / 3.0) - 1.0);
+            while (!(r < SPHERE_CUTOFF * scale));
+
+            double q, g;
+            do
+            {
+                q = random.Uniform();
+                g = 0.1 * random.Uniform();
+            } while (g > q * q * std::pow(1.0 - q * q, 3.5));
+
+            double escape = std::sqrt(2.0 * GRAVITATIONAL_CONSTANT * mass / std::sqrt(r * r + scale * scale));
+            positions[i] = r * random.Direction();
+            velocities[i] = q * escape * random.Direction();
+            bodies.GetMasses()[i] = bodyMass;
+            bodies.GetRadii()[i] = bodyRadius;
+        }
+        CenterBodies(bodies, first, count);
+    }
+
+    /**
+     * @brief Radii from the inverted cumulative mass, speeds by rejection against the peak of
+     * v^2 f(E) at that radius, which is found on a grid and padded
+     */
+    void AddHernquistSphere(BodyStore& bodies, uint32_t count, double mass, double scale, Random& random)
+    {
+        uint32_t first = bodies.Append(count);
+        auto& positions = bodies.GetPositions();
+        auto& velocities = bodies.GetVelocities();
+        double bodyMass = mass / (double)count;
+        double bodyRadius = RadiusFromDensity(bodyMass, STAR_DENSITY);
+        double gm = GRAVITATIONAL_CONSTANT * mass;
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            double r;
+            do
+            {
+                double s = std::sqrt(random.Uniform());
+                r = scale * s / (1.0 - s);
+            } while (!(r < SPHERE_CUTOFF * scale));
+
+            // speed as a fraction x of escape speed, binding energy left is psi (1 - x^2)
+            double psi = scale / (r + scale);
+            auto density = [psi](double x) { return x * x * HernquistDistribution(std::sqrt(psi * (1.0 - x * x))); };
+            double peak = 0.0;
+            for (int j = 1; j < HERNQUIST_GRID; j++)
+                peak = std::max(peak, density((double)j / HERNQUIST_GRID));
+            peak *= 1.5;
+
+            double x;
+            do
+                x = random.Uniform();
+            while (random.Uniform() * peak > density(x));
+
+            double escape = std::sqrt(2.0 * gm / (r + scale));
+            positions[i] = r * random.Direction();
+            velocities[i] = x * escape * random.Direction();
+            bodies.GetMasses()[i] = bodyMass;
+            bodies.GetRadii()[i] = bodyRadius;
+        }
+        CenterBodies(bodies, first, count);
+    }
+
+    /**
+     * @brief Surface density falling off as exp(-R / scale), vertical sech^2 profile. Speeds are circular
+     * for the mass inside each radius taken as a sphere, plus gaussian noise.
+     */
+    void AddExponentialDisk(BodyStore& bodies, const GeneratorSettings& settings, double mass, double scale, Random& random)
+    {
+        uint32_t central = settings.centralMass > 0.0 ? 1 : 0;
+        uint32_t first = bodies.Append(settings.count + central);
+        auto& positions = bodies.GetPositions();
+        auto& velocities = bodies.GetVelocities();
+        if (central)
+        {
+            bodies.GetMasses()[first] = settings.centralMass;
+            bodies.GetRadii()[first] = RadiusFromDensity(settings.centralMass, STAR_DENSITY);
+        }
+
+        double bodyMass = mass / (double)settings.count;
+        double bodyRadius = RadiusFromDensity(bodyMass, STAR_DENSITY);
+        double height = settings.thickness * scale;
+        for (uint32_t i = first + central; i < first + central + settings.count; i++)
+        {
+            // sum of two exponentials is the gamma distribution R e^(-R) of an exponential disk
+            double radius;
+            do
+                radius = -scale * std::log(random.UniformOpen() * random.UniformOpen());
+            while (!(radius < DISK_CUTOFF * scale));
+
+            double y = height * std::atanh(std::clamp(random.Uniform(-1.0, 1.0), -0.999999, 0.999999));
+            double angle = random.Angle();
+            double x = radius / scale;
+            double enclosed = settings.centralMass + mass * (1.0 - (1.0 + x) * std::exp(-x));
+            double distance = std::sqrt(radius * radius + y * y);
+            double speed = distance > 0.0 ? std::sqrt(GRAVITATIONAL_CONSTANT * enclosed / distance) : 0.0;
+
+            // tangent (-sin, 0, cos) gives angular momentum along -Y
+            positions[i] = {radius * std::cos(angle), y, radius * std::sin(angle)};
+            velocities[i] = speed * glm::dvec3(-std::sin(angle), 0.0, std::cos(angle))
+                + settings.dispersion * speed * glm::dvec3(random.Normal(), random.Normal(), random.Normal());
+            bodies.GetMasses()[i] = bodyMass;
+            bodies.GetRadii()[i] = bodyRadius;
+        }
+        CenterBodies(bodies, first, settings.count + central);
+    }
+
+    /**
+     * @brief Random elements around the heaviest body, converted in one pass
+     */
+    void AddAsteroidBelt(Simulation& simulation, const GeneratorSettings& settings, Random& random)
+    {
+        BodyStore& bodies = simulation.GetBodies();
+        if (bodies.GetCount() == 0)
+            throw std::runtime_error("Asteroid belt needs a body to orbit");
+
+        uint32_t center = FindHeaviestBody(bodies);
+        glm::dvec3 centerPosition = bodies.GetPositions()[center];
+        glm::dvec3 centerVelocity = bodies.GetVelocities()[center];
+        double mu = (bodies.GetMasses()[center] + settings.bodyMass) * GRAVITATIONAL_CONSTANT;
+
+        OrbitalElementArrays elements;
+        elements.Resize(settings.count);
+        for (uint32_t i = 0; i < settings.count; i++)
+        {
+            elements.semiMajorAxis[i] = random.Uniform(settings.innerRadius, settings.outerRadius);
+            elements.eccentricity[i] = random.Uniform(0.0, settings.maxEccentricity);
+            elements.inclination[i] = std::abs(random.Normal()) * glm::radians(settings.inclination);
+            elements.node[i] = random.Angle();
+            elements.periapsis[i] = random.Angle();
+            elements.meanAnomaly[i] = random.Angle();
+            elements.mu[i] = mu;
+        }
+
+        std::vector<glm::dvec3> positions(settings.count), velocities(settings.count);
+        ElementsToState(elements, 0, settings.count, positions.data(), velocities.data());
+        if (settings.bodyMass > 0.0)
+        {
+            uint32_t first = bodies.Append(settings.count);
+            double radius = RadiusFromDensity(settings.bodyMass, ROCK_DENSITY);
+            for (uint32_t i = 0; i < settings.count; i++)
+            {
+                bodies.GetPositions()[first + i] = centerPosition + positions[i];
+                bodies.GetVelocities()[first + i] = centerVelocity + velocities[i];
+                bodies.GetMasses()[first + i] = settings.bodyMass;
+                bodies.GetRadii()[first + i] = radius;
+            }
+        }
+        else
+        {
+            TestParticles& particles = simulation.GetParticles();
+            particles.Reserve(particles.GetCount() + settings.count);
+            for (uint32_t i = 0; i < settings.count; i++)
+                particles.Add(centerPosition + positions[i], centerVelocity + velocities[i]);
+        }
+    }
+
+    /**
+     * @brief A star with planets spread log-uniformly over two decades of distance, each with moons
+     * inside its Hill sphere. Orbits span seconds of moon period to centuries, the case that makes
+     * global time steps and flat trees struggle.
+     */
+    void AddHierarchicalSystem(BodyStore& bodies, uint32_t count, uint32_t moonsPerPlanet, double mass, double scale, Random& random)
+    {
+        uint32_t first = bodies.Append(count);
+        auto& positions = bodies.GetPositions();
+        auto& velocities = bodies.GetVelocities();
+        auto& masses = bodies.GetMasses();
+        auto& radii = bodies.GetRadii();
+        masses[first] = mass;
+        radii[first] = RadiusFromDensity(mass, STAR_DENSITY);
+
+        uint32_t planetCount = (count - 1 + moonsPerPlanet) / (moonsPerPlanet + 1);
+        uint32_t moonCount = count - 1 - planetCount;
+        uint32_t firstPlanet = first + 1;
+        uint32_t firstMoon = firstPlanet + planetCount;
+
+        OrbitalElementArrays planets;
+        planets.Resize(planetCount);
+        for (uint32_t i = 0; i < planetCount; i++)
+        {
+            double planetMass = random.LogUniform(EARTH_MASS, JUPITER_MASS);
+            masses[firstPlanet + i] = planetMass;
+            radii[firstPlanet + i] = RadiusFromDensity(planetMass, PLANET_DENSITY);
+            planets.semiMajorAxis[i] = random.LogUniform(scale, 100.0 * scale);
+            planets.eccentricity[i] = random.Uniform(0.0, 0.1);
+            planets.inclination[i] = std::abs(random.Normal()) * glm::radians(2.0);
+            planets.node[i] = random.Angle();
+            planets.periapsis[i] = random.Angle();
+            planets.meanAnomaly[i] = random.Angle();
+            planets.mu[i] = (mass + planetMass) * GRAVITATIONAL_CONSTANT;
+        }
+        ElementsToState(planets, 0, planetCount, positions.data() + firstPlanet, velocities.data() + firstPlanet);
+
+        OrbitalElementArrays moons;
+        moons.Resize(moonCount);
+        for (uint32_t i = 0; i < moonCount; i++)
+        {
+            uint32_t planet = i % planetCount;
+            double planetMass = masses[firstPlanet + planet];
+            double moonMass = planetMass * random.LogUniform(1e-5, 1e-3);
+            masses[firstMoon + i] = moonMass;
+            radii[firstMoon + i] = RadiusFromDensity(moonMass, ROCK_DENSITY);
+
+            double hill = planets.semiMajorAxis[planet] * (1.0 - planets.eccentricity[planet]) * std::cbrt(planetMass / (3.0 * mass));
+            double closest = 3.0 * radii[firstPlanet + planet];
+            moons.semiMajorAxis[i] = random.LogUniform(closest, std::max(0.3 * hill, 2.0 * closest));
+            moons.eccentricity[i] = random.Uniform(0.0, 0.05);
+            moons.inclination[i] = std::abs(random.Normal()) * glm::radians(2.0);
+            moons.node[i] = random.Angle();
+            moons.periapsis[i] = random.Angle();
+            moons.meanAnomaly[i] = random.Angle();
+            moons.mu[i] = (planetMass + moonMass) * GRAVITATIONAL_CONSTANT;
+        }
+        ElementsToState(moons, 0, moonCount, positions.data() + firstMoon, velocities.data() + firstMoon);
+        for (uint32_t i = 0; i < moonCount; i++)
+        {
+            positions[firstMoon + i] += positions[firstPlanet + i % planetCount];
+            velocities[firstMoon + i] += velocities[firstPlanet + i % planetCount];
+        }
+        CenterBodies(bodies, first, count);
+    }
+}
+
+void Generate(const GeneratorSettings& settings, Simulation& simulation)
+{
+    if (settings.count == 0)
+        return;
+    if (settings.mass < 0.0 || settings.scale < 0.0)
+        throw std::runtime_error("Generator mass and scale can't be negative");
+
+    Random random(settings.seed);
+    BodyStore& bodies = simulation.GetBodies();
+    switch (settings.type)
+    {
+    case GeneratorType::PlummerSphere:
+    case GeneratorType::HernquistSphere:
+    {
+        double mass = settings.mass > 0.0 ? settings.mass : 1000.0 * SOLAR_MASS;
+        double scale = settings.scale > 0.0 ? settings.scale : 1000.0 * ASTRONOMICAL_UNIT;
+        if (settings.type == GeneratorType::PlummerSphere)
+            AddPlummerSphere(bodies, settings.count, mass, scale, random);
+        else
+            AddHernquistSphere(bodies, settings.count, mass, scale, random);
+        break;
+    }
+    case GeneratorType::ExponentialDisk:
+    {
+        if (settings.thickness < 0.0 || settings.dispersion < 0.0 || settings.centralMass < 0.0)
+            throw std::runtime_error("Disk thickness, dispersion and central mass can't be negative");
+        double mass = settings.mass > 0.0 ? settings.mass : 1000.0 * SOLAR_MASS;
+        double scale = settings.scale > 0.0 ? settings.scale : 1000.0 * ASTRONOMICAL_UNIT;
+        AddExponentialDisk(bodies, settings, mass, scale, random);
+        break;
+    }
+    case GeneratorType::AsteroidBelt:
+        if (!(settings.innerRadius > 0.0 && settings.innerRadius < settings.outerRadius))
+            throw std::runtime_error("Asteroid belt needs 0 < inner radius < outer radius");
+        if (!(settings.maxEccentricity >= 0.0 && settings.maxEccentricity < 1.0))
+            throw std::runtime_error("Asteroid belt eccentricity has to be below 1");
+        AddAsteroidBelt(simulation, settings, random);
+        break;
+    case GeneratorType::HierarchicalSystem:
+    {
+        double mass = settings.mass > 0.0 ? settings.mass : SOLAR_MASS;
+        double scale = settings.scale > 0.0 ? settings.scale : 0.4 * ASTRONOMICAL_UNIT;
+        if (settings.count < 2)
+            throw std::runtime_error("Hierarchical system needs a star and at least one planet");
+        AddHierarchicalSystem(bodies, settings.count, settings.moons, mass, scale, random);
+        break;
+    }
+    default:
+        throw std::runtime_error("Unknown generator type " + std::to_string(settings.type));
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "simulation.h"
+
+#include <cstdint>
+
+#define SOLAR_MASS 1.989e30 // kg
+#define ASTRONOMICAL_UNIT 1.496e8 // km
+
+enum GeneratorType
+{
+    PlummerSphere = 0,
+    HernquistSphere = 1,
+    ExponentialDisk = 2,
+    AsteroidBelt = 3,
+    HierarchicalSystem = 4
+};
+
+/**
+ * @brief What to generate. Mass and scale mean something different per type, 0 picks the default:
+ *
+ *     Plummer, Hernquist  total mass (1000 suns) and scale radius (1000 AU)
+ *     disk                disk mass (1000 suns) and scale length (1000 AU), plus centralMass in the middle
+ *     belt                orbits the heaviest body already there between innerRadius and outerRadius
+ *     hierarchical        star mass (1 sun) and the innermost planet orbit (0.4 AU), planets get moons
+ *
+ * @note Draws come from a generator of our own rather than std distributions, so a seed gives the
+ * same scenario with every compiler and standard library.
+ */
+struct GeneratorSettings
+{
+    int type = GeneratorType::PlummerSphere;
+    uint32_t count = 1000; // bodies including the star of a hierarchical system, or particles of a massless belt. The disk central mass comes on top
+    uint64_t seed = 1;
+    double mass = 0.0; // kg
+    double scale = 0.0; // km
+    double centralMass = 1000.0 * SOLAR_MASS; // disk, kg, 0 for none
+    double thickness = 0.05; // disk, sech^2 scale height over scale length
+    double dispersion = 0.05; // disk, random velocity over circular velocity
+    double innerRadius = 2.1 * ASTRONOMICAL_UNIT; // belt, km
+    double outerRadius = 3.3 * ASTRONOMICAL_UNIT; // belt, km
+    double maxEccentricity = 0.15; // belt
+    double inclination = 6.0; // belt, degrees, standard deviation
+    double bodyMass = 0.0; // belt, kg per asteroid, 0 adds test particles instead
+    uint32_t moons = 4; // hierarchical, per planet
+};
+
+/**
+ * @brief Appends a seeded distribution to the simulation. Spheres and disks are shifted so their center
+ * of mass rests at the origin, every orbit is prograde around -Y like the solar system scenario.
+ * @throws std::runtime_error when the settings make no sense for the type
+ */
+void Generate(const GeneratorSettings& settings, Simulation& simulation);
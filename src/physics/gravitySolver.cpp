@@ -0,0 +1,149 @@
+#include "gravitySolver.h"
+
+#include <cmath>
+#include <algorithm>
+
+DirectSolver::DirectSolver(bool vectorize)
+    : m_SimdLevel(DetectSimdLevel())
+{
+    SetVectorize(vectorize);
+}
+
+void DirectSolver::SetVectorize(bool vectorize)
+{
+    m_Kernel = GetDirectTileKernel(vectorize ? m_SimdLevel : SimdScalar);
+}
+
+void DirectSolver::ComputeAccelerations(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+    std::vector<glm::dvec3>& accelerations)
+{
+    uint32_t count = (uint32_t)positions.size();
+
+    // repack once per evaluation, constant factors are folded in here instead of per pair
+    m_Packed.x.resize(count);
+    m_Packed.y.resize(count);
+    m_Packed.z.resize(count);
+    m_Packed.mass.resize(count);
+    m_Packed.ax.assign(count, 0.0);
+    m_Packed.ay.assign(count, 0.0);
+    m_Packed.az.assign(count, 0.0);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_Packed.x[i] = positions[i].x;
+        m_Packed.y[i] = positions[i].y;
+        m_Packed.z[i] = positions[i].z;
+        m_Packed.mass[i] = masses[i] * GRAVITATIONAL_CONSTANT;
+    }
+
+    uint32_t threadCount = m_ThreadPool ? m_ThreadPool->GetThreadCount() : 1;
+    if (threadCount == 1)
+    {
+        for (uint32_t tileA = 0; tileA < count; tileA += DIRECT_TILE_SIZE)
+        {
+            uint32_t endA = std::min(tileA + DIRECT_TILE_SIZE, count);
+            for (uint32_t tileB = tileA; tileB < count; tileB += DIRECT_TILE_SIZE)
+            {
+                uint32_t endB = std::min(tileB + DIRECT_TILE_SIZE, count);
+                m_Kernel(m_Packed, tileA, endA, tileB, endB);
+            }
+        }
+    }
+    else
+    {
+        // shrink tiles until every thread gets at least one pair per round
+        uint32_t tileSize = DIRECT_TILE_SIZE;
+        while (tileSize > DIRECT_MIN_TILE_SIZE && count < tileSize * threadCount * 2)
+            tileSize /= 2;
+
+        uint32_t tileCount = (count + tileSize - 1) / tileSize;
+        BuildSchedule(tileCount);
+
+        for (uint32_t round = 0; round + 1 < m_RoundStarts.size(); round++)
+        {
+            uint32_t first = m_RoundStarts[round];
+            m_ThreadPool->ParallelFor(m_RoundStarts[round + 1] - first, [&](uint32_t i)
+            {
+                const TilePair& pair = m_Schedule[first + i];
+                uint32_t beginA = pair.a * tileSize;
+                uint32_t beginB = pair.b * tileSize;
+                m_Kernel(m_Packed, beginA, std::min(beginA + tileSize, count), beginB, std::min(beginB + tileSize, count));
+            });
+        }
+    }
+
+    accelerations.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+        accelerations[i] = glm::dvec3(m_Packed.ax[i], m_Packed.ay[i], m_Packed.az[i]);
+}
+
+/**
+ * @brief Circle method round-robin tournament over tiles. Every round is a set of disjoint
+ * tile pairs, diagonal tiles all go into one extra round since they only touch themselves.
+ */
+void DirectSolver::BuildSchedule(uint32_t tileCount)
+{
+    if (tileCount == m_ScheduleTiles)
+        return;
+    m_ScheduleTiles = tileCount;
+    m_Schedule.clear();
+    m_RoundStarts.clear();
+
+    m_RoundStarts.push_back(0);
+    for (uint32_t tile = 0; tile < tileCount; tile++)
+        m_Schedule.push_back({tile, tile});
+    m_RoundStarts.push_back((uint32_t)m_Schedule.size());
+
+    // odd tile count gets a dummy tile, whoever is paired with it sits the round out
+    uint32_t players = tileCount + (tileCount & 1);
+    for (uint32_t round = 0; round + 1 < players; round++)
+    {
+        for (uint32_t i = 0; i < players / 2; i++)
+        {
+            uint32_t a = i == 0 ? players - 1 : (round + i) % (players - 1);
+            uint32_t b = (round + players - 1 - i) % (players - 1);
+            if (a >= tileCount || b >= tileCount)
+                continue;
+            m_Schedule.push_back({std::min(a, b), std::max(a, b)});
+        }
+        m_RoundStarts.push_back((uint32_t)m_Schedule.size());
+    }
+}
+
+SolverError MeasureSolverError(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+    const std::vector<glm::dvec3>& accelerations, uint32_t sampleCount)
+{
+    SolverError error{};
+    uint32_t count = (uint32_t)positions.size();
+    if (count < 2 || sampleCount == 0)
+        return error;
+
+    uint32_t stride = std::max(count / sampleCount, 1u);
+    double squaredSum = 0.0;
+    for (uint32_t i = 0; i < count; i += stride)
+    {
+        glm::dvec3 reference{0.0};
+        for (uint32_t j = 0; j < count; j++)
+        {
+            glm::dvec3 offset = positions[j] - positions[i];
+            double distanceSquared = glm::dot(offset, offset);
+            if (j == i || distanceSquared <= 0.0)
+                continue;
+            double inverseDistance = 1.0 / std::sqrt(distanceSquared);
+            reference += offset * (masses[j] * inverseDistance * inverseDistance * inverseDistance);
+        }
+        reference *= GRAVITATIONAL_CONSTANT;
+
+        double referenceLength = glm::length(reference);
+        if (referenceLength <= 0.0)
+            continue;
+
+        double relative = glm::length(accelerations[i] - reference) / referenceLength;
+        error.maxRelative = std::max(error.maxRelative, relative);
+        squaredSum += relative * relative;
+        error.samples++;
+    }
+    if (error.samples > 0)
+        error.rmsRelative = std::sqrt(squaredSum / error.samples);
+
+    return error;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "directKernels.h"
+#include "threadPool.h"
+
+#include <vector>
+#include <cstdint>
+
+// Gravitational constant converted to km^3 / (kg * s^2) because positions are stored in km
+#define GRAVITATIONAL_CONSTANT 6.67e-20
+
+enum SolverType
+{
+    DirectSum = 0,
+    BarnesHut = 1,
+    FastMultipole = 2
+};
+
+/**
+ * @brief Relative acceleration error of a solver compared to direct summation
+ */
+struct SolverError
+{
+    double maxRelative = 0.0;
+    double rmsRelative = 0.0;
+    uint32_t samples = 0;
+};
+
+/**
+ * @brief Force evaluation boundary. Every solver takes body positions (km) and masses (kg)
+ * and writes resulting accelerations (km/s^2), integrators don't care how they are computed.
+ */
+class GravitySolver
+{
+public:
+    virtual ~GravitySolver() = default;
+
+    virtual void ComputeAccelerations(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+        std::vector<glm::dvec3>& accelerations
+    ) = 0;
+
+    // solvers run single threaded until they are given a pool
+    inline void SetThreadPool(ThreadPool* threadPool) { m_ThreadPool = threadPool; }
+protected:
+    ThreadPool* m_ThreadPool = nullptr;
+};
+
+/**
+ * @brief O(N^2) pairwise summation, every pair is computed once and applied to both bodies.
+ * Bodies are processed in cache sized tiles with the widest SIMD kernel the CPU supports.
+ * With a thread pool, tile pairs are scheduled in round-robin rounds where no two pairs
+ * share a tile, so threads never write the same accelerations and no atomics are needed.
+ * @note This is the reference path other solvers are measured against.
+ */
+class DirectSolver : public GravitySolver
+{
+public:
+    DirectSolver(bool vectorize = true);
+
+    void ComputeAccelerations(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+        std::vector<glm::dvec3>& accelerations
+    ) override;
+
+    void SetVectorize(bool vectorize);
+    inline SimdLevel GetSimdLevel() const { return m_SimdLevel; }
+private:
+    void BuildSchedule(uint32_t tileCount);
+
+    struct TilePair
+    {
+        uint32_t a, b;
+    };
+
+    SimdLevel m_SimdLevel;
+    DirectTileKernel m_Kernel;
+    PackedBodies m_Packed;
+
+    // tile pairs of all rounds back to back, round i is [m_RoundStarts[i], m_RoundStarts[i + 1])
+    std::vector<TilePair> m_Schedule;
+    std::vector<uint32_t> m_RoundStarts;
+    uint32_t m_ScheduleTiles = 0;
+};
+
+/**
+ * @brief Compares accelerations against direct summation on up to sampleCount evenly spread bodies, 
+ * costs O(sampleCount * N) so it can be used on inputs where full direct summation isn't possible
+ */
+SolverError MeasureSolverError(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, 
+    const std::vector<glm::dvec3>& accelerations, uint32_t sampleCount
+);
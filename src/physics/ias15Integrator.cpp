@@ -0,0 +1,402 @@
+#include "ias15Integrator.h"
+
+#include <cmath>
+#include <algorithm>
+
+// lower limit on step shrinking before the step is thrown away and retried
+#define IAS15_SAFETY_FACTOR 0.25
+// predictor-corrector stops when the last coefficient changes less than this relative to acceleration
+#define IAS15_CONVERGENCE 1e-16
+// error estimate this far above the round-off level it was found at is truncation again
+#define IAS15_ROUND_OFF_MARGIN 10.0
+
+namespace
+{
+    /**
+     * @brief Gauss-Radau spacings and conversion between Newton (g) and power (b) basis,
+     * b[j] = sum over k >= j of toPower[j][k] * g[k], fromPower is its inverse
+     */
+    struct RadauTables
+    {
+        double spacings[8] = {
+            0.0, 0.0562625605369221464656521910318, 0.180240691736892364987579942780, 0.352624717113169637373907769648,
+            0.547153626330555383001448554766, 0.734210177215410531523210605558, 0.885320946839095768090359771030, 0.977520613561287501891174488626
+        };
+        double toPower[7][7] = {};
+        double fromPower[7][7] = {};
+
+        RadauTables()
+        {
+            // g[k] multiplies t * (t - h1) * ... * (t - hk), expand the products into powers of t
+            double product[8] = {1.0};
+            for (int k = 0; k < 7; k++)
+            {
+                if (k > 0)
+                {
+                    for (int j = k; j > 0; j--)
+                        product[j] = product[j - 1] - spacings[k] * product[j];
+                    product[0] = -spacings[k] * product[0];
+                }
+                for (int j = 0; j <= k; j++)
+                    toPower[j][k] = product[j];
+            }
+
+            // unit upper triangular, inverse by back substitution column by column
+            for (int k = 0; k < 7; k++)
+            {
+                fromPower[k][k] = 1.0;
+                for (int j = k - 1; j >= 0; j--)
+                {
+                    double sum = 0.0;
+                    for (int m = j + 1; m <= k; m++)
+                        sum += toPower[j][m] * fromPower[m][k];
+                    fromPower[j][k] = -sum;
+                }
+            }
+        }
+    };
+
+    const RadauTables& GetTables()
+    {
+        static const RadauTables tables;
+        return tables;
+    }
+
+    void CompensatedAdd(glm::dvec3& value, glm::dvec3& compensation, const glm::dvec3& increment)
+    {
+        glm::dvec3 corrected = increment - compensation;
+        glm::dvec3 sum = value + corrected;
+        compensation = (sum - value) - corrected;
+        value = sum;
+    }
+
+    double MaxComponent(const glm::dvec3& value)
+    {
+        return std::max(std::fabs(value.x), std::max(std::fabs(value.y), std::fabs(value.z)));
+    }
+}
+
+Ias15Integrator::Ias15Integrator(double tolerance)
+    : m_Tolerance(tolerance)
+{
+
+}
+
+void Ias15Integrator::Reset()
+{
+    m_HasHistory = false;
+    m_PredictedStep = 0.0;
+    for (uint32_t k = 0; k < STAGES; k++)
+    {
+        m_B[k].clear();
+        m_G[k].clear();
+        m_E[k].clear();
+    }
+    m_PositionCompensation.clear();
+    m_VelocityCompensation.clear();
+    m_LastTrialStep = 0.0;
+    m_LastError = 0.0;
+    m_FloorStep = 0.0;
+    m_FloorError = 0.0;
+}
+
+void Ias15Integrator::Step(BodyStore& bodies, GravitySolver& solver, double delta)
+{
+    uint32_t count = bodies.GetCount();
+    if (count == 0 || delta <= 0.0)
+        return;
+
+    if (m_B[0].size() != count)
+    {
+        Reset();
+        for (uint32_t k = 0; k < STAGES; k++)
+        {
+            m_B[k].assign(count, glm::dvec3(0.0));
+            m_G[k].assign(count, glm::dvec3(0.0));
+            m_E[k].assign(count, glm::dvec3(0.0));
+        }
+        m_PositionCompensation.assign(count, glm::dvec3(0.0));
+        m_VelocityCompensation.assign(count, glm::dvec3(0.0));
+    }
+    if (m_Timestep <= 0.0)
+        m_Timestep = delta;
+
+    double remaining = delta;
+    while (remaining > delta * 1e-12)
+    {
+        // last step is cut short to land on delta, unless error asks for less the natural step size is kept
+        bool clamped = m_Timestep >= remaining;
+        double timestep = clamped ? remaining : m_Timestep;
+        double nextTimestep = timestep;
+        double taken = TryStep(bodies, solver, timestep, nextTimestep);
+        remaining -= taken;
+        if (taken > 0.0 && clamped && nextTimestep >= timestep)
+            m_Timestep = std::max(m_Timestep, nextTimestep);
+        else
+            m_Timestep = nextTimestep;
+    }
+}
+
+/**
+ * @brief Step size and round-off floor, then the predicted polynomial and compensation terms once there are any,
+ * without them a restored run would start from a blank prediction and diverge from the original in the last bits
+ */
+void Ias15Integrator::SaveState(std::vector<double>& state) const
+{
+    state.insert(state.end(), { m_Timestep, m_PredictedStep, m_HasHistory ? 1.0 : 0.0, m_LastTrialStep, m_LastError, m_FloorStep, m_FloorError });
+    auto append = [&](const std::vector<glm::dvec3>& values)
+    {
+        for (const glm::dvec3& value : values)
+            state.insert(state.end(), { value.x, value.y, value.z });
+    };
+    if (m_B[0].empty())
+        return;
+    for (uint32_t k = 0; k < STAGES; k++)
+    {
+        append(m_B[k]);
+        append(m_E[k]);
+    }
+    append(m_PositionCompensation);
+    append(m_VelocityCompensation);
+}
+
+bool Ias15Integrator::LoadState(const std::vector<double>& state, uint32_t bodyCount)
+{
+    Reset();
+    size_t perArray = 3 * (size_t)bodyCount;
+    if (state.size() != STATE_SCALARS && state.size() != STATE_SCALARS + (2 * STAGES + 2) * perArray)
+        return state.empty();
+
+    m_Timestep = state[0];
+    m_LastTrialStep = state[3];
+    m_LastError = state[4];
+    m_FloorStep = state[5];
+    m_FloorError = state[6];
+    if (state.size() == STATE_SCALARS)
+        return true;
+
+    const double* value = state.data() + STATE_SCALARS;
+    auto read = [&](std::vector<glm::dvec3>& values)
+    {
+        values.resize(bodyCount);
+        for (uint32_t i = 0; i < bodyCount; i++, value += 3)
+            values[i] = {value[0], value[1], value[2]};
+    };
+    for (uint32_t k = 0; k < STAGES; k++)
+    {
+        read(m_B[k]);
+        read(m_E[k]);
+        m_G[k].assign(bodyCount, glm::dvec3(0.0));
+    }
+    read(m_PositionCompensation);
+    read(m_VelocityCompensation);
+    m_PredictedStep = state[1];
+    m_HasHistory = state[2] != 0.0;
+    return true;
+}
+
+double Ias15Integrator::TryStep(BodyStore& bodies, GravitySolver& solver, double timestep, double& nextTimestep)
+{
+    const RadauTables& tables = GetTables();
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    uint32_t count = bodies.GetCount();
+
+    // b was predicted for m_PredictedStep, same polynomial reparametrised to the step actually taken
+    if (m_PredictedStep > 0.0 && timestep > m_PredictedStep * 20.0)
+    {
+        // a prediction from a much shorter step, like the leftover end of the previous call, is useless this far out
+        ClearPrediction();
+    }
+    else if (m_PredictedStep > 0.0 && m_PredictedStep != timestep)
+    {
+        double ratio = timestep / m_PredictedStep;
+        double scale = ratio;
+        for (uint32_t k = 0; k < STAGES; k++, scale *= ratio)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                m_B[k][i] *= scale;
+                m_E[k][i] *= scale;
+            }
+        }
+    }
+    m_PredictedStep = timestep;
+
+    m_StartPositions.assign(positions.begin(), positions.end());
+    m_StartVelocities.assign(velocities.begin(), velocities.end());
+    solver.ComputeAccelerations(m_StartPositions, masses, m_StartAccelerations);
+    m_ForceEvaluations++;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (uint32_t k = 0; k < STAGES; k++)
+        {
+            glm::dvec3 g{0.0};
+            for (uint32_t j = k; j < STAGES; j++)
+                g += m_B[j][i] * tables.fromPower[k][j];
+            m_G[k][i] = g;
+        }
+    }
+
+    m_Predicted.resize(count);
+    double lastCorrection = 2.0;
+    for (uint32_t iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+    {
+        double maxCorrection = 0.0;
+        double maxAcceleration = 0.0;
+        for (uint32_t stage = 1; stage <= STAGES; stage++)
+        {
+            double s = tables.spacings[stage];
+            for (uint32_t i = 0; i < count; i++)
+            {
+                const auto& b = m_B;
+                glm::dvec3 series = m_StartAccelerations[i] * 0.5 + s * (b[0][i] / 6.0 + s * (b[1][i] / 12.0 + s * (b[2][i] / 20.0 
+                    + s * (b[3][i] / 30.0 + s * (b[4][i] / 42.0 + s * (b[5][i] / 56.0 + s * b[6][i] / 72.0))))));
+                m_Predicted[i] = m_StartPositions[i] + (s * timestep) * (m_StartVelocities[i] + (s * timestep) * series);
+            }
+
+            solver.ComputeAccelerations(m_Predicted, masses, m_Accelerations);
+            m_ForceEvaluations++;
+
+            // divided differences give the new Newton coefficient, change is pushed into b
+            uint32_t newest = stage - 1;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                glm::dvec3 g = (m_Accelerations[i] - m_StartAccelerations[i]) / s;
+                for (uint32_t k = 0; k < newest; k++)
+                    g = (g - m_G[k][i]) / (s - tables.spacings[k + 1]);
+
+                glm::dvec3 change = g - m_G[newest][i];
+                m_G[newest][i] = g;
+                for (uint32_t j = 0; j <= newest; j++)
+                    m_B[j][i] += change * tables.toPower[j][newest];
+
+                if (stage == STAGES)
+                {
+                    maxCorrection = std::max(maxCorrection, MaxComponent(change));
+                    maxAcceleration = std::max(maxAcceleration, MaxComponent(m_Accelerations[i]));
+                }
+            }
+        }
+
+        double correction = maxAcceleration > 0.0 ? maxCorrection / maxAcceleration : 0.0;
+        // converged, or round-off started to dominate and further iterations only oscillate
+        if (correction < IAS15_CONVERGENCE || (iteration > 2 && correction >= lastCorrection))
+            break;
+        lastCorrection = correction;
+    }
+
+    // size of the highest order term relative to acceleration is the truncation error estimate
+    double maxB6 = 0.0;
+    double maxAcceleration = 0.0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        maxB6 = std::max(maxB6, MaxComponent(m_B[6][i]));
+        maxAcceleration = std::max(maxAcceleration, MaxComponent(m_Accelerations[i]));
+    }
+    double error = maxAcceleration > 0.0 ? maxB6 / maxAcceleration : 0.0;
+    double proposed = std::isnormal(error) ? timestep * std::pow(m_Tolerance / error, 1.0 / 7.0) : timestep / IAS15_SAFETY_FACTOR;
+
+    // truncation error falls as step^7, round-off in the estimate doesn't, it even grows as position increments
+    // get small against positions far from the origin. An estimate above tolerance that didn't fall as step^3 on
+    // a shorter step is that round-off, no step gets under it and chasing it shrinks the step forever. Steps stop
+    // at the one before until the estimate rises well above the round-off it was found at
+    double lastTrialStep = m_LastTrialStep;
+    if (lastTrialStep > 0.0 && timestep < 0.9 * lastTrialStep && error > m_Tolerance
+        && error > m_LastError * std::pow(timestep / lastTrialStep, 3.0))
+    {
+        m_FloorStep = std::max(m_FloorStep, lastTrialStep);
+        m_FloorError = std::max(m_FloorError, std::max(error, m_LastError));
+    }
+    else if (m_FloorStep > 0.0 && error > IAS15_ROUND_OFF_MARGIN * m_FloorError)
+    {
+        m_FloorStep = 0.0;
+        m_FloorError = 0.0;
+    }
+    m_LastTrialStep = timestep;
+    m_LastError = error;
+
+    if (proposed < IAS15_SAFETY_FACTOR * timestep && m_FloorStep == 0.0)
+    {
+        m_RejectedSteps++;
+        nextTimestep = proposed;
+        return 0.0;
+    }
+    nextTimestep = std::max(std::min(proposed, timestep / IAS15_SAFETY_FACTOR), m_FloorStep);
+    if (error > m_Tolerance && m_FloorStep > 0.0)
+        m_RoundOffSteps++;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const auto& b = m_B;
+        glm::dvec3 a0 = m_StartAccelerations[i];
+        glm::dvec3 positionIncrement = timestep * m_StartVelocities[i] + timestep * timestep * (a0 * 0.5 + b[0][i] / 6.0 + b[1][i] / 12.0 
+            + b[2][i] / 20.0 + b[3][i] / 30.0 + b[4][i] / 42.0 + b[5][i] / 56.0 + b[6][i] / 72.0);
+        glm::dvec3 velocityIncrement = timestep * (a0 + b[0][i] / 2.0 + b[1][i] / 3.0 + b[2][i] / 4.0 + b[3][i] / 5.0 
+            + b[4][i] / 6.0 + b[5][i] / 7.0 + b[6][i] / 8.0);
+        CompensatedAdd(positions[i], m_PositionCompensation[i], positionIncrement);
+        CompensatedAdd(velocities[i], m_VelocityCompensation[i], velocityIncrement);
+    }
+
+    PredictNextStep(nextTimestep / timestep);
+    m_PredictedStep = nextTimestep;
+    return timestep;
+}
+
+void Ias15Integrator::ClearPrediction()
+{
+    for (uint32_t k = 0; k < STAGES; k++)
+    {
+        std::fill(m_B[k].begin(), m_B[k].end(), glm::dvec3(0.0));
+        std::fill(m_E[k].begin(), m_E[k].end(), glm::dvec3(0.0));
+    }
+    m_HasHistory = false;
+}
+
+/**
+ * @brief Shifts the converged polynomial to the start of the next step as a starting guess,
+ * corrected by how far off the previous guess was
+ */
+void Ias15Integrator::PredictNextStep(double ratio)
+{
+    uint32_t count = (uint32_t)m_B[0].size();
+    if (ratio > 20.0)
+    {
+        // too far away to extrapolate, start from nothing
+        ClearPrediction();
+        return;
+    }
+
+    double q1 = ratio;
+    double q2 = q1 * q1;
+    double q3 = q2 * q1;
+    double q4 = q2 * q2;
+    double q5 = q4 * q1;
+    double q6 = q3 * q3;
+    double q7 = q6 * q1;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        glm::dvec3 b[STAGES];
+        glm::dvec3 e[STAGES];
+        for (uint32_t k = 0; k < STAGES; k++)
+            b[k] = m_B[k][i];
+
+        e[0] = q1 * (b[6] * 7.0 + b[5] * 6.0 + b[4] * 5.0 + b[3] * 4.0 + b[2] * 3.0 + b[1] * 2.0 + b[0]);
+        e[1] = q2 * (b[6] * 21.0 + b[5] * 15.0 + b[4] * 10.0 + b[3] * 6.0 + b[2] * 3.0 + b[1]);
+        e[2] = q3 * (b[6] * 35.0 + b[5] * 20.0 + b[4] * 10.0 + b[3] * 4.0 + b[2]);
+        e[3] = q4 * (b[6] * 35.0 + b[5] * 15.0 + b[4] * 5.0 + b[3]);
+        e[4] = q5 * (b[6] * 21.0 + b[5] * 6.0 + b[4]);
+        e[5] = q6 * (b[6] * 7.0 + b[5]);
+        e[6] = q7 * b[6];
+
+        for (uint32_t k = 0; k < STAGES; k++)
+        {
+            glm::dvec3 missed = m_HasHistory ? b[k] - m_E[k][i] : glm::dvec3(0.0);
+            m_B[k][i] = e[k] + missed;
+            m_E[k][i] = e[k];
+        }
+    }
+    m_HasHistory = true;
+}
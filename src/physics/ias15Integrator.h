@@ -0,0 +1,65 @@
+#pragma once
+
+#include "integrator.h"
+
+#include <array>
+
+/**
+ * @brief IAS15 (Rein & Spiegel 2015), 15th order implicit Gauss-Radau integrator with adaptive
+ * step size. Acceleration over a step is a 7th degree polynomial fitted at Radau spacings
+ * by predictor-corrector iterations until it stops changing, step size is chosen so that
+ * the last polynomial term stays below tolerance relative to the acceleration.
+ * @note Step(delta) takes as many internal steps as needed to land exactly on delta,
+ * so delta only controls how often the caller sees the state, not accuracy.
+ */
+class Ias15Integrator : public Integrator
+{
+public:
+    Ias15Integrator(double tolerance = 1e-9);
+
+    void Step(BodyStore& bodies, GravitySolver& solver, double delta) override;
+    void Reset() override;
+    void SaveState(std::vector<double>& state) const override;
+    bool LoadState(const std::vector<double>& state, uint32_t bodyCount) override;
+
+    inline void SetTolerance(double tolerance) { m_Tolerance = tolerance; }
+    inline double GetTimestep() const { return m_Timestep; }
+    inline uint64_t GetForceEvaluations() const { return m_ForceEvaluations; }
+    inline uint64_t GetRejectedSteps() const { return m_RejectedSteps; }
+    // steps taken above tolerance because the error estimate was round-off, tolerance was out of reach on those
+    inline uint64_t GetRoundOffSteps() const { return m_RoundOffSteps; }
+private:
+    static constexpr uint32_t STAGES = 7;
+    static constexpr uint32_t MAX_ITERATIONS = 12;
+    static constexpr size_t STATE_SCALARS = 7;
+
+    using Coefficients = std::array<std::vector<glm::dvec3>, STAGES>;
+
+    // takes a single step of at most timestep seconds, returns duration actually taken
+    double TryStep(BodyStore& bodies, GravitySolver& solver, double timestep, double& nextTimestep);
+    void PredictNextStep(double ratio);
+    void ClearPrediction();
+
+    double m_Tolerance;
+    double m_Timestep = 0.0;
+    double m_PredictedStep = 0.0; // step size m_B is currently parametrised for
+    bool m_HasHistory = false;
+    uint64_t m_ForceEvaluations = 0;
+    uint64_t m_RejectedSteps = 0;
+    uint64_t m_RoundOffSteps = 0;
+    double m_LastTrialStep = 0.0;
+    double m_LastError = 0.0;
+    double m_FloorStep = 0.0; // steps don't shrink below this while the error estimate is round-off, 0 when it isn't
+    double m_FloorError = 0.0; // round-off level the floor was found at
+
+    // b are power basis coefficients of acceleration over the step, g the same polynomial in Newton
+    // form, e is the prediction b was started from
+    Coefficients m_B, m_G, m_E;
+    std::vector<glm::dvec3> m_StartPositions;
+    std::vector<glm::dvec3> m_StartVelocities;
+    std::vector<glm::dvec3> m_StartAccelerations;
+    std::vector<glm::dvec3> m_PositionCompensation;
+    std::vector<glm::dvec3> m_VelocityCompensation;
+    std::vector<glm::dvec3> m_Predicted;
+    std::vector<glm::dvec3> m_Accelerations;
+};
@@ -0,0 +1,288 @@
+#include "integrator.h"
+
+#include <cmath>
+#include <algorithm>
+
+void EulerIntegrator::Step(BodyStore& bodies, GravitySolver& solver, double delta)
+{
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    uint32_t count = bodies.GetCount();
+
+    solver.ComputeAccelerations(positions, bodies.GetMasses(), m_Accelerations);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        velocities[i] += m_Accelerations[i] * delta;
+        positions[i] += velocities[i] * delta;
+    }
+}
+
+CompositionIntegrator::CompositionIntegrator(const std::vector<double>& weights)
+    : m_Weights(weights)
+{
+
+}
+
+void CompositionIntegrator::Step(BodyStore& bodies, GravitySolver& solver, double delta)
+{
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    uint32_t count = bodies.GetCount();
+
+    if (!m_AccelerationsValid || m_Accelerations.size() != count)
+    {
+        solver.ComputeAccelerations(positions, masses, m_Accelerations);
+        m_AccelerationsValid = true;
+    }
+
+    for (double weight : m_Weights)
+    {
+        double stageDelta = weight * delta;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            velocities[i] += m_Accelerations[i] * (0.5 * stageDelta);
+            positions[i] += velocities[i] * stageDelta;
+        }
+
+        solver.ComputeAccelerations(positions, masses, m_Accelerations);
+
+        for (uint32_t i = 0; i < count; i++)
+            velocities[i] += m_Accelerations[i] * (0.5 * stageDelta);
+    }
+}
+
+CompositionIntegrator CompositionIntegrator::CreateLeapfrog()
+{
+    return CompositionIntegrator({1.0});
+}
+
+/**
+ * @brief Yoshida (1990) triple jump, w1 w0 w1 with 2 * w1 + w0 = 1
+ */
+CompositionIntegrator CompositionIntegrator::CreateYoshida4()
+{
+    double cubeRootTwo = std::cbrt(2.0);
+    double w1 = 1.0 / (2.0 - cubeRootTwo);
+    double w0 = -cubeRootTwo / (2.0 - cubeRootTwo);
+    return CompositionIntegrator({w1, w0, w1});
+}
+
+/**
+ * @brief Yoshida (1990) 6th order solution A, seven stages w3 w2 w1 w0 w1 w2 w3
+ */
+CompositionIntegrator CompositionIntegrator::CreateYoshida6()
+{
+    double w1 = -1.17767998417887;
+    double w2 = 0.235573213359357;
+    double w3 = 0.784513610477560;
+    double w0 = 1.0 - 2.0 * (w1 + w2 + w3);
+    return CompositionIntegrator({w3, w2, w1, w0, w1, w2, w3});
+}
+
+HermiteIntegrator::HermiteIntegrator(double accuracy)
+    : m_Accuracy(accuracy)
+{
+
+}
+
+void HermiteIntegrator::Step(BodyStore& bodies, GravitySolver&, double delta)
+{
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    uint32_t count = bodies.GetCount();
+    if (count == 0)
+        return;
+
+    m_PredictedPositions.resize(count);
+    m_PredictedVelocities.resize(count);
+    m_NewAccelerations.resize(count);
+    m_NewJerks.resize(count);
+
+    const uint64_t endTime = 1ull << MAX_LEVEL;
+    const double tick = delta / (double)endTime;
+
+    if (!m_StateValid || m_Accelerations.size() != count || m_LastDelta != delta)
+    {
+        m_Accelerations.resize(count);
+        m_Jerks.resize(count);
+        m_Times.assign(count, 0);
+        m_Levels.resize(count);
+
+        m_Active.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            m_Active[i] = i;
+            m_PredictedPositions[i] = positions[i];
+            m_PredictedVelocities[i] = velocities[i];
+        }
+        ComputeForces(m_Active, masses);
+
+        // starting step from acceleration / jerk only, higher derivatives aren't known yet
+        for (uint32_t i = 0; i < count; i++)
+        {
+            m_Accelerations[i] = m_NewAccelerations[i];
+            m_Jerks[i] = m_NewJerks[i];
+            double jerk = glm::length(m_Jerks[i]);
+            double timestep = jerk > 0.0 ? 0.01 * glm::length(m_Accelerations[i]) / jerk : delta;
+            m_Levels[i] = SelectLevel(timestep, delta);
+        }
+        m_LastDelta = delta;
+        m_StateValid = true;
+    }
+    std::fill(m_Times.begin(), m_Times.end(), 0);
+
+    uint64_t time = 0;
+    while (time < endTime)
+    {
+        uint64_t nextTime = endTime;
+        for (uint32_t i = 0; i < count; i++)
+            nextTime = std::min(nextTime, m_Times[i] + (endTime >> m_Levels[i]));
+
+        m_Active.clear();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint64_t bodyEnd = m_Times[i] + (endTime >> m_Levels[i]);
+            if (bodyEnd == nextTime)
+                m_Active.push_back(i);
+
+            double dt = (double)(nextTime - m_Times[i]) * tick;
+            const glm::dvec3& a = m_Accelerations[i];
+            const glm::dvec3& j = m_Jerks[i];
+            m_PredictedPositions[i] = positions[i] + dt * (velocities[i] + dt * (a * 0.5 + dt * j * (1.0 / 6.0)));
+            m_PredictedVelocities[i] = velocities[i] + dt * (a + dt * j * 0.5);
+        }
+
+        ComputeForces(m_Active, masses);
+
+        for (uint32_t i : m_Active)
+        {
+            double dt = (double)(nextTime - m_Times[i]) * tick;
+            const glm::dvec3& a0 = m_Accelerations[i];
+            const glm::dvec3& j0 = m_Jerks[i];
+            const glm::dvec3& a1 = m_NewAccelerations[i];
+            const glm::dvec3& j1 = m_NewJerks[i];
+
+            glm::dvec3 newVelocity = velocities[i] + (a0 + a1) * (dt * 0.5) + (j0 - j1) * (dt * dt / 12.0);
+            positions[i] += (velocities[i] + newVelocity) * (dt * 0.5) + (a0 - a1) * (dt * dt / 12.0);
+            velocities[i] = newVelocity;
+
+            // Aarseth criterion with 2nd and 3rd derivatives from the interpolating polynomial
+            glm::dvec3 a3 = (12.0 * (a0 - a1) + 6.0 * dt * (j0 + j1)) / (dt * dt * dt);
+            glm::dvec3 a2 = (-6.0 * (a0 - a1) - dt * (4.0 * j0 + 2.0 * j1)) / (dt * dt) + a3 * dt;
+            double aLength = glm::length(a1);
+            double jLength = glm::length(j1);
+            double a2Length = glm::length(a2);
+            double a3Length = glm::length(a3);
+            double denominator = jLength * a3Length + a2Length * a2Length;
+            double timestep = denominator > 0.0 ? std::sqrt(m_Accuracy * (aLength * a2Length + jLength * jLength) / denominator) : delta;
+
+            // blocks stay aligned, a body may only move up a level when its time is a multiple of the bigger step
+            uint32_t level = SelectLevel(timestep, delta);
+            uint32_t current = m_Levels[i];
+            if (level > current)
+                m_Levels[i] = level;
+            else if (level < current && current > 0 && nextTime % (endTime >> (current - 1)) == 0)
+                m_Levels[i] = current - 1;
+
+            m_Accelerations[i] = a1;
+            m_Jerks[i] = j1;
+            m_Times[i] = nextTime;
+        }
+
+        time = nextTime;
+    }
+}
+
+/**
+ * @brief Last delta, then acceleration, jerk and block level of every body, empty before the first step
+ */
+void HermiteIntegrator::SaveState(std::vector<double>& state) const
+{
+    if (!m_StateValid)
+        return;
+
+    state.push_back(m_LastDelta);
+    for (size_t i = 0; i < m_Accelerations.size(); i++)
+    {
+        state.insert(state.end(), { m_Accelerations[i].x, m_Accelerations[i].y, m_Accelerations[i].z });
+        state.insert(state.end(), { m_Jerks[i].x, m_Jerks[i].y, m_Jerks[i].z });
+        state.push_back((double)m_Levels[i]);
+    }
+}
+
+bool HermiteIntegrator::LoadState(const std::vector<double>& state, uint32_t bodyCount)
+{
+    Reset();
+    if (state.size() != 1 + 7 * (size_t)bodyCount)
+        return state.empty();
+
+    m_LastDelta = state[0];
+    m_Accelerations.resize(bodyCount);
+    m_Jerks.resize(bodyCount);
+    m_Levels.resize(bodyCount);
+    m_Times.assign(bodyCount, 0);
+    const double* value = state.data() + 1;
+    for (uint32_t i = 0; i < bodyCount; i++, value += 7)
+    {
+        m_Accelerations[i] = {value[0], value[1], value[2]};
+        m_Jerks[i] = {value[3], value[4], value[5]};
+        m_Levels[i] = (uint32_t)value[6];
+    }
+    m_StateValid = true;
+    return true;
+}
+
+uint32_t HermiteIntegrator::SelectLevel(double timestep, double delta) const
+{
+    uint32_t level = 0;
+    double blockStep = delta;
+    while (blockStep > timestep && level < MAX_LEVEL)
+    {
+        blockStep *= 0.5;
+        level++;
+    }
+    return level;
+}
+
+/**
+ * @brief Acceleration and jerk of active bodies from predicted positions and velocities of everyone
+ */
+void HermiteIntegrator::ComputeForces(const std::vector<uint32_t>& active, const std::vector<double>& masses)
+{
+    uint32_t count = (uint32_t)masses.size();
+    m_ForceEvaluations += active.size();
+
+    auto evaluate = [&](uint32_t body)
+    {
+        const glm::dvec3& position = m_PredictedPositions[body];
+        const glm::dvec3& velocity = m_PredictedVelocities[body];
+        glm::dvec3 acceleration{0.0};
+        glm::dvec3 jerk{0.0};
+        for (uint32_t other = 0; other < count; other++)
+        {
+            glm::dvec3 offset = m_PredictedPositions[other] - position;
+            double distanceSquared = glm::dot(offset, offset);
+            if (other == body || distanceSquared <= 0.0)
+                continue;
+
+            glm::dvec3 relativeVelocity = m_PredictedVelocities[other] - velocity;
+            double inverseDistanceSquared = 1.0 / distanceSquared;
+            double massOverCube = masses[other] * inverseDistanceSquared * std::sqrt(inverseDistanceSquared);
+            double rv = 3.0 * glm::dot(offset, relativeVelocity) * inverseDistanceSquared;
+            acceleration += offset * massOverCube;
+            jerk += (relativeVelocity - offset * rv) * massOverCube;
+        }
+        m_NewAccelerations[body] = acceleration * GRAVITATIONAL_CONSTANT;
+        m_NewJerks[body] = jerk * GRAVITATIONAL_CONSTANT;
+    };
+
+    if (m_ThreadPool && active.size() > 64)
+    {
+        m_ThreadPool->ParallelFor((uint32_t)active.size(), [&](uint32_t i) { evaluate(active[i]); });
+        return;
+    }
+    for (uint32_t body : active)
+        evaluate(body);
+}
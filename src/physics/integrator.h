@@ -0,0 +1,132 @@
+#pragma once
+
+#include "bodyStore.h"
+#include "gravitySolver.h"
+
+#include <vector>
+
+enum IntegratorType
+{
+    SemiImplicitEuler = 0,
+    Leapfrog = 1,
+    Yoshida4 = 2,
+    Yoshida6 = 3,
+    Hermite = 4,
+    WisdomHolman = 5,
+    Ias15 = 6,
+    PatchedConics = 7
+};
+
+/**
+ * @brief Advances positions and velocities of a BodyStore by one step, forces come from
+ * whatever solver is passed in. Rotations are not touched, they don't depend on forces.
+ */
+class Integrator
+{
+public:
+    virtual ~Integrator() = default;
+
+    virtual void Step(BodyStore& bodies, GravitySolver& solver, double delta) = 0;
+
+    /**
+     * @brief Drops anything cached from previous steps, called when bodies are added, removed
+     * or moved outside of the integrator
+     */
+    virtual void Reset() {}
+
+    /**
+     * @brief Appends whatever is carried from one Step to the next and changes its results, so a restored
+     * run continues exactly. Caches recomputed from positions are left out, most integrators have nothing.
+     */
+    virtual void SaveState(std::vector<double>&) const {}
+    /**
+     * @return false when state doesn't fit the bodies, integrator is reset instead
+     */
+    virtual bool LoadState(const std::vector<double>& state, uint32_t) { return state.empty(); }
+
+    inline void SetThreadPool(ThreadPool* threadPool) { m_ThreadPool = threadPool; }
+protected:
+    ThreadPool* m_ThreadPool = nullptr;
+};
+
+/**
+ * @brief First order kick then drift, kept for comparison with the old behaviour
+ */
+class EulerIntegrator : public Integrator
+{
+public:
+    void Step(BodyStore& bodies, GravitySolver& solver, double delta) override;
+private:
+    std::vector<glm::dvec3> m_Accelerations;
+};
+
+/**
+ * @brief Symmetric composition of kick-drift-kick leapfrog steps. Plain leapfrog is a single
+ * stage of weight 1, Yoshida schemes chain 3 or 7 stages with weights chosen so that the
+ * error terms cancel up to 4th or 6th order. All of them are symplectic and time reversible,
+ * so energy error stays bounded instead of drifting.
+ * @note Accelerations at the end of a stage are reused by the next one (first same as last),
+ * so a step costs one force evaluation per stage.
+ */
+class CompositionIntegrator : public Integrator
+{
+public:
+    CompositionIntegrator(const std::vector<double>& weights);
+
+    void Step(BodyStore& bodies, GravitySolver& solver, double delta) override;
+    inline void Reset() override { m_AccelerationsValid = false; }
+
+    static CompositionIntegrator CreateLeapfrog();
+    static CompositionIntegrator CreateYoshida4();
+    static CompositionIntegrator CreateYoshida6();
+private:
+    std::vector<double> m_Weights;
+    std::vector<glm::dvec3> m_Accelerations;
+    bool m_AccelerationsValid = false;
+};
+
+/**
+ * @brief 4th order Hermite predictor-corrector with individual power of two block timesteps.
+ * Every body picks its own step from the Aarseth criterion, bodies sharing the earliest
+ * end time form the active block and only they get new forces, everyone else is just
+ * predicted. All bodies are synchronised again at the end of each Step call.
+ * @note Needs jerk as well as acceleration, so forces are always summed directly and the
+ * solver passed to Step is ignored.
+ */
+class HermiteIntegrator : public Integrator
+{
+public:
+    HermiteIntegrator(double accuracy = 0.02);
+
+    void Step(BodyStore& bodies, GravitySolver& solver, double delta) override;
+    inline void Reset() override { m_StateValid = false; }
+    void SaveState(std::vector<double>& state) const override;
+    bool LoadState(const std::vector<double>& state, uint32_t bodyCount) override;
+
+    inline void SetAccuracy(double accuracy) { m_Accuracy = accuracy; }
+    inline uint64_t GetForceEvaluations() const { return m_ForceEvaluations; }
+private:
+    // smallest block step is delta / 2^MAX_LEVEL, time inside a Step is counted in those ticks
+    static constexpr uint32_t MAX_LEVEL = 24;
+
+    void ComputeForces(const std::vector<uint32_t>& active, const std::vector<double>& masses);
+    uint32_t SelectLevel(double timestep, double delta) const;
+
+    double m_Accuracy;
+    double m_LastDelta = 0.0;
+    bool m_StateValid = false;
+    uint64_t m_ForceEvaluations = 0;
+
+    // per body state at its own last corrected time
+    std::vector<glm::dvec3> m_Accelerations;
+    std::vector<glm::dvec3> m_Jerks;
+    std::vector<uint64_t> m_Times;
+    std::vector<uint32_t> m_Levels;
+
+    // predicted state of every body at the current block time
+    std::vector<glm::dvec3> m_PredictedPositions;
+    std::vector<glm::dvec3> m_PredictedVelocities;
+    std::vector<glm::dvec3> m_NewAccelerations;
+    std::vector<glm::dvec3> m_NewJerks;
+    std::vector<uint32_t> m_Active;
+};
@@ -0,0 +1,159 @@
+#include "kepler.h"
+
+#include <cmath>
+
+#define KEPLER_MAX_ITERATIONS 64
+#define KEPLER_TOLERANCE 1e-13
+#define ELEMENTS_NEWTON_STEPS 12 // quadratic convergence from Danby's start, e = 0.99 needs about 8
+
+/**
+ * @brief Stumpff functions c2(z) and c3(z), series near zero where closed forms cancel out
+ */
+static void Stumpff(double z, double& c2, double& c3)
+{
+    if (std::fabs(z) < 1e-3)
+    {
+        c2 = 1.0 / 2.0 - z / 24.0 + z * z / 720.0 - z * z * z / 40320.0;
+        c3 = 1.0 / 6.0 - z / 120.0 + z * z / 5040.0 - z * z * z / 362880.0;
+    }
+    else if (z > 0.0)
+    {
+        double root = std::sqrt(z);
+        c2 = (1.0 - std::cos(root)) / z;
+        c3 = (root - std::sin(root)) / (z * root);
+    }
+    else
+    {
+        double root = std::sqrt(-z);
+        c2 = (std::cosh(root) - 1.0) / -z;
+        c3 = (std::sinh(root) - root) / (-z * root);
+    }
+}
+
+double KeplerPeriod(const glm::dvec3& position, const glm::dvec3& velocity, double mu)
+{
+    double alpha = 2.0 / glm::length(position) - glm::dot(velocity, velocity) / mu;
+    if (alpha <= 0.0)
+        return 0.0;
+    return 2.0 * M_PI / std::sqrt(mu * alpha * alpha * alpha);
+}
+
+bool KeplerDrift(glm::dvec3& position, glm::dvec3& velocity, double mu, double delta)
+{
+    double r0 = glm::length(position);
+    if (r0 <= 0.0 || mu <= 0.0)
+        return false;
+
+    double sqrtMu = std::sqrt(mu);
+    double rv = glm::dot(position, velocity) / sqrtMu;
+    double alpha = 2.0 / r0 - glm::dot(velocity, velocity) / mu;
+
+    // whole revolutions don't change anything, keeps chi small for long drifts
+    if (alpha > 0.0)
+    {
+        double period = 2.0 * M_PI / std::sqrt(mu * alpha * alpha * alpha);
+        delta = std::fmod(delta, period);
+    }
+
+    double chi = alpha > 0.0 ? sqrtMu * delta * alpha : sqrtMu * delta / r0;
+    double c2 = 0.0, c3 = 0.0;
+    double r = r0;
+    bool converged = false;
+    for (int i = 0; i < KEPLER_MAX_ITERATIONS; i++)
+    {
+        double chiSquared = chi * chi;
+        Stumpff(alpha * chiSquared, c2, c3);
+
+        double f = rv * chiSquared * c2 + (1.0 - alpha * r0) * chiSquared * chi * c3 + r0 * chi - sqrtMu * delta;
+        r = rv * chi * (1.0 - alpha * chiSquared * c3) + (1.0 - alpha * r0) * chiSquared * c2 + r0;
+        double secondDerivative = rv * (1.0 - alpha * chiSquared * c2) + (1.0 - alpha * r0) * chi * (1.0 - alpha * chiSquared * c3);
+
+        // Laguerre-Conway step, converges from much worse starting guesses than plain Newton
+        const double n = 5.0;
+        double discriminant = std::fabs((n - 1.0) * (n - 1.0) * r * r - n * (n - 1.0) * f * secondDerivative);
+        double denominator = r + (r >= 0.0 ? 1.0 : -1.0) * std::sqrt(discriminant);
+        if (denominator == 0.0)
+            break;
+        double step = n * f / denominator;
+        chi -= step;
+
+        if (std::fabs(step) <= KEPLER_TOLERANCE * std::max(std::fabs(chi), 1.0))
+        {
+            converged = true;
+            break;
+        }
+    }
+    if (!converged)
+        return false;
+
+    double chiSquared = chi * chi;
+    Stumpff(alpha * chiSquared, c2, c3);
+    double f = 1.0 - chiSquared / r0 * c2;
+    double g = delta - chiSquared * chi / sqrtMu * c3;
+    glm::dvec3 newPosition = f * position + g * velocity;
+    r = glm::length(newPosition);
+    double fDot = sqrtMu / (r * r0) * chi * (alpha * chiSquared * c3 - 1.0);
+    double gDot = 1.0 - chiSquared / r * c2;
+
+    velocity = fDot * position + gDot * velocity;
+    position = newPosition;
+    return true;
+}
+
+void OrbitalElementArrays::Resize(size_t count)
+{
+    semiMajorAxis.resize(count);
+    eccentricity.resize(count);
+    inclination.resize(count);
+    node.resize(count);
+    periapsis.resize(count);
+    meanAnomaly.resize(count);
+    mu.resize(count);
+}
+
+void ElementsToState(const OrbitalElementArrays& elements, size_t first, size_t count, glm::dvec3* positions, glm::dvec3* velocities)
+{
+    const double* semiMajorAxis = elements.semiMajorAxis.data() + first;
+    const double* eccentricity = elements.eccentricity.data() + first;
+    const double* inclination = elements.inclination.data() + first;
+    const double* node = elements.node.data() + first;
+    const double* periapsis = elements.periapsis.data() + first;
+    const double* meanAnomaly = elements.meanAnomaly.data() + first;
+    const double* mu = elements.mu.data() + first;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        double a = semiMajorAxis[i];
+        double e = eccentricity[i];
+        double M = std::remainder(meanAnomaly[i], 2.0 * M_PI); // -pi to pi
+
+        // Danby's starting guess, plain Newton from there
+        double E = M + std::copysign(0.85 * e, std::sin(M));
+        for (int step = 0; step < ELEMENTS_NEWTON_STEPS; step++)
+            E -= (E - e * std::sin(E) - M) / (1.0 - e * std::cos(E));
+
+        double cosE = std::cos(E);
+        double sinE = std::sin(E);
+        double b = std::sqrt(1.0 - e * e);
+        double n = std::sqrt(mu[i] / (a * a * a));
+        double rate = a * n / (1.0 - e * cosE);
+
+        // perifocal frame, periapsis along p
+        double px = a * (cosE - e);
+        double py = a * b * sinE;
+        double vx = -rate * sinE;
+        double vy = rate * b * cosE;
+
+        double cosNode = std::cos(node[i]), sinNode = std::sin(node[i]);
+        double cosInc = std::cos(inclination[i]), sinInc = std::sin(inclination[i]);
+        double cosPeri = std::cos(periapsis[i]), sinPeri = std::sin(periapsis[i]);
+        glm::dvec3 p{cosNode * cosPeri - sinNode * sinPeri * cosInc, sinNode * cosPeri + cosNode * sinPeri * cosInc, sinPeri * sinInc};
+        glm::dvec3 q{-cosNode * sinPeri - sinNode * cosPeri * cosInc, -sinNode * sinPeri + cosNode * cosPeri * cosInc, cosPeri * sinInc};
+
+        // usual z up elements, y is up here
+        glm::dvec3 position = px * p + py * q;
+        glm::dvec3 velocity = vx * p + vy * q;
+        positions[i] = {position.x, position.z, position.y};
+        velocities[i] = {velocity.x, velocity.z, velocity.y};
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * @brief Advances a two body orbit analytically using universal variables, works for elliptic,
+ * parabolic and hyperbolic orbits. Position and velocity are relative to the central body,
+ * mu is G * (central mass [+ body mass]) in km^3/s^2.
+ * @return false when the solver didn't converge, position and velocity are left untouched
+ */
+bool KeplerDrift(glm::dvec3& position, glm::dvec3& velocity, double mu, double delta);
+
+/**
+ * @brief Orbital period in seconds, 0 for unbound orbits
+ */
+double KeplerPeriod(const glm::dvec3& position, const glm::dvec3& velocity, double mu);
+
+/**
+ * @brief Elliptic orbits with one array per element, so conversion runs straight down them. Lengths in
+ * km, angles in radians, mu is G * (central mass + body mass) in km^3/s^2.
+ */
+struct OrbitalElementArrays
+{
+    std::vector<double> semiMajorAxis;
+    std::vector<double> eccentricity;
+    std::vector<double> inclination;
+    std::vector<double> node; // longitude of the ascending node
+    std::vector<double> periapsis; // argument of periapsis
+    std::vector<double> meanAnomaly;
+    std::vector<double> mu;
+
+    void Resize(size_t count);
+    inline size_t GetCount() const { return semiMajorAxis.size(); }
+};
+
+/**
+ * @brief Position and velocity relative to the central body for elements first up to first + count,
+ * written to positions[0] up to positions[count - 1]. Kepler's equation gets a fixed number of Newton
+ * steps from a start that converges for any eccentricity below 1, with no branches the loop vectorizes.
+ * @note Zero inclination is the XZ plane and orbits turn the same way as the bundled solar system.
+ */
+void ElementsToState(const OrbitalElementArrays& elements, size_t first, size_t count, glm::dvec3* positions, glm::dvec3* velocities);
@@ -0,0 +1,148 @@
+#include "octree.h"
+
+#include <cmath>
+#include <algorithm>
+
+void Octree::Build(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, uint32_t leafCapacity)
+{
+    uint32_t count = (uint32_t)positions.size();
+    m_LeafCapacity = std::max(leafCapacity, 1u);
+    m_Nodes.clear();
+    if (count == 0)
+        return;
+
+    glm::dvec3 minBound = positions[0];
+    glm::dvec3 maxBound = positions[0];
+    for (uint32_t i = 1; i < count; i++)
+    {
+        minBound = glm::min(minBound, positions[i]);
+        maxBound = glm::max(maxBound, positions[i]);
+    }
+    glm::dvec3 extent = maxBound - minBound;
+
+    m_Order.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+        m_Order[i] = i;
+    m_Scratch.resize(count);
+
+    m_Nodes.reserve(count / m_LeafCapacity * 2 + 1);
+
+    Node root{};
+    root.center = (minBound + maxBound) * 0.5;
+    root.halfSize = std::max(std::max(extent.x, extent.y), extent.z) * 0.5 * 1.0001 + 1e-9; // slightly bigger so nothing lands on the boundary
+    root.firstBody = 0;
+    root.bodyCount = count;
+    m_Nodes.push_back(root);
+
+    BuildNode(0, 0, positions, masses);
+}
+
+/**
+ * @brief Splits bodies of the node into 8 octants and recurses, mass properties are computed on the way back
+ */
+void Octree::BuildNode(uint32_t nodeIndex, uint32_t depth, const std::vector<glm::dvec3>& positions, const std::vector<double>& masses)
+{
+    uint32_t first = m_Nodes[nodeIndex].firstBody;
+    uint32_t count = m_Nodes[nodeIndex].bodyCount;
+    glm::dvec3 center = m_Nodes[nodeIndex].center;
+    double halfSize = m_Nodes[nodeIndex].halfSize;
+
+    if (count <= m_LeafCapacity || depth >= MAX_DEPTH)
+    {
+        double mass = 0.0;
+        glm::dvec3 weighted{0.0};
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            mass += masses[m_Order[i]];
+            weighted += positions[m_Order[i]] * masses[m_Order[i]];
+        }
+        glm::dvec3 centerOfMass = mass > 0.0 ? weighted / mass : center;
+
+        double radius = 0.0;
+        for (uint32_t i = first; i < first + count; i++)
+            radius = std::max(radius, glm::length(positions[m_Order[i]] - centerOfMass));
+
+        Node& node = m_Nodes[nodeIndex];
+        node.mass = mass;
+        node.centerOfMass = centerOfMass;
+        node.radius = radius;
+        node.leaf = true;
+        return;
+    }
+
+    // counting sort of bodies into octants
+    uint32_t octantCounts[8] = {};
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        const glm::dvec3& p = positions[m_Order[i]];
+        uint32_t octant = (p.x > center.x ? 1 : 0) | (p.y > center.y ? 2 : 0) | (p.z > center.z ? 4 : 0);
+        octantCounts[octant]++;
+    }
+    uint32_t octantStarts[8];
+    uint32_t offset = first;
+    for (uint32_t octant = 0; octant < 8; octant++)
+    {
+        octantStarts[octant] = offset;
+        offset += octantCounts[octant];
+    }
+    uint32_t cursor[8];
+    std::copy(octantStarts, octantStarts + 8, cursor);
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        const glm::dvec3& p = positions[m_Order[i]];
+        uint32_t octant = (p.x > center.x ? 1 : 0) | (p.y > center.y ? 2 : 0) | (p.z > center.z ? 4 : 0);
+        m_Scratch[cursor[octant]++] = m_Order[i];
+    }
+    std::copy(m_Scratch.begin() + first, m_Scratch.begin() + first + count, m_Order.begin() + first);
+
+    m_Nodes[nodeIndex].leaf = false;
+    double childHalfSize = halfSize * 0.5;
+    for (uint32_t octant = 0; octant < 8; octant++)
+    {
+        if (octantCounts[octant] == 0)
+            continue;
+
+        Node child{};
+        child.halfSize = childHalfSize;
+        child.center = center + glm::dvec3(
+            (octant & 1) ? childHalfSize : -childHalfSize,
+            (octant & 2) ? childHalfSize : -childHalfSize,
+            (octant & 4) ? childHalfSize : -childHalfSize
+        );
+        child.firstBody = octantStarts[octant];
+        child.bodyCount = octantCounts[octant];
+
+        // push_back can reallocate so never hold node references across it
+        int32_t childIndex = (int32_t)m_Nodes.size();
+        m_Nodes.push_back(child);
+        m_Nodes[nodeIndex].children[octant] = childIndex;
+        BuildNode(childIndex, depth + 1, positions, masses);
+    }
+
+    double mass = 0.0;
+    glm::dvec3 weighted{0.0};
+    for (uint32_t octant = 0; octant < 8; octant++)
+    {
+        int32_t childIndex = m_Nodes[nodeIndex].children[octant];
+        if (childIndex < 0)
+            continue;
+        mass += m_Nodes[childIndex].mass;
+        weighted += m_Nodes[childIndex].centerOfMass * m_Nodes[childIndex].mass;
+    }
+    glm::dvec3 centerOfMass = mass > 0.0 ? weighted / mass : center;
+
+    double radius = 0.0;
+    for (uint32_t octant = 0; octant < 8; octant++)
+    {
+        int32_t childIndex = m_Nodes[nodeIndex].children[octant];
+        if (childIndex < 0)
+            continue;
+        const Node& child = m_Nodes[childIndex];
+        radius = std::max(radius, glm::length(child.centerOfMass - centerOfMass) + child.radius);
+    }
+
+    Node& node = m_Nodes[nodeIndex];
+    node.mass = mass;
+    node.centerOfMass = centerOfMass;
+    node.radius = radius;
+}
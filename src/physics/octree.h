@@ -0,0 +1,43 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Octree over a set of point masses, shared by tree based solvers.
+ * @note Nodes are stored in pre-order so every parent comes before its children,
+ * walking m_Nodes backwards visits children first.
+ */
+class Octree
+{
+public:
+    struct Node
+    {
+        glm::dvec3 center{0.0}; // geometric center of the cube
+        double halfSize = 0.0;
+        glm::dvec3 centerOfMass{0.0};
+        double mass = 0.0;
+        double radius = 0.0; // distance from center of mass to the furthest body inside
+        int32_t children[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+        uint32_t firstBody = 0; // range in GetOrder()
+        uint32_t bodyCount = 0;
+        bool leaf = true;
+    };
+
+    static constexpr uint32_t MAX_DEPTH = 48;
+
+    void Build(const std::vector<glm::dvec3>& positions, const std::vector<double>& masses, uint32_t leafCapacity);
+
+    inline const std::vector<Node>& GetNodes() const { return m_Nodes; }
+    inline const std::vector<uint32_t>& GetOrder() const { return m_Order; }
+private:
+    void BuildNode(uint32_t nodeIndex, uint32_t depth, const std::vector<glm::dvec3>& positions, const std::vector<double>& masses);
+
+    uint32_t m_LeafCapacity = 8;
+    std::vector<Node> m_Nodes;
+    std::vector<uint32_t> m_Order;
+    std::vector<uint32_t> m_Scratch;
+};
@@ -0,0 +1,212 @@
+#include "patchedConicIntegrator.h"
+#include "kepler.h"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+PatchedConicIntegrator::PatchedConicIntegrator(double perturbationThreshold)
+    : m_PerturbationThreshold(perturbationThreshold)
+{
+
+}
+
+void PatchedConicIntegrator::Step(BodyStore& bodies, GravitySolver&, double delta)
+{
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    uint32_t count = bodies.GetCount();
+    if (count == 0)
+        return;
+
+    Classify(bodies);
+
+    // root has nothing to orbit, it moves with the center of mass, position and velocity alike
+    uint32_t root = m_Order[0];
+    double totalMass = 0.0;
+    glm::dvec3 momentum{0.0};
+    for (uint32_t i = 0; i < count; i++)
+    {
+        totalMass += masses[i];
+        momentum += velocities[i] * masses[i];
+    }
+    m_RootPosition = positions[root];
+    m_RootDrift = totalMass > 0.0 ? momentum / totalMass : velocities[root];
+    m_RelativePositions.resize(count);
+    m_RelativeVelocities.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (m_Primaries[i] < 0)
+            continue;
+        m_RelativePositions[i] = positions[i] - positions[m_Primaries[i]];
+        m_RelativeVelocities[i] = velocities[i] - velocities[m_Primaries[i]];
+    }
+    m_Positions.assign(positions.begin(), positions.end());
+    m_Velocities.assign(velocities.begin(), velocities.end());
+
+    if (!m_Numeric.empty())
+    {
+        // substeps sized for the tightest perturbed orbit, everyone else is placed analytically at substep times
+        double shortestPeriod = std::numeric_limits<double>::max();
+        for (uint32_t body : m_Numeric)
+        {
+            int32_t primary = m_Primaries[body];
+            double period = KeplerPeriod(m_RelativePositions[body], m_RelativeVelocities[body], 
+                GRAVITATIONAL_CONSTANT * (masses[primary] + masses[body]));
+            if (period <= 0.0)
+            {
+                // unbound, use time to cross its current distance instead
+                double speed = glm::length(m_RelativeVelocities[body]);
+                period = speed > 0.0 ? glm::length(m_RelativePositions[body]) / speed : delta;
+            }
+            shortestPeriod = std::min(shortestPeriod, period);
+        }
+        double substepsNeeded = std::ceil(delta * SUBSTEPS_PER_ORBIT / shortestPeriod);
+        uint32_t substeps = (uint32_t)std::clamp(substepsNeeded, 1.0, (double)MAX_SUBSTEPS);
+        double substep = delta / substeps;
+
+        ComputeNumericAccelerations(masses);
+        for (uint32_t step = 0; step < substeps; step++)
+        {
+            for (uint32_t body : m_Numeric)
+            {
+                m_Velocities[body] += m_Accelerations[body] * (0.5 * substep);
+                m_Positions[body] += m_Velocities[body] * substep;
+            }
+            PlaceAnalytic(masses, substep * (step + 1));
+            ComputeNumericAccelerations(masses);
+            for (uint32_t body : m_Numeric)
+                m_Velocities[body] += m_Accelerations[body] * (0.5 * substep);
+        }
+    }
+    // again after the last kick, satellites of perturbed bodies need their final velocity
+    PlaceAnalytic(masses, delta);
+
+    positions.assign(m_Positions.begin(), m_Positions.end());
+    velocities.assign(m_Velocities.begin(), m_Velocities.end());
+}
+
+/**
+ * @brief Builds sphere of influence hierarchy and decides which bodies are close enough to
+ * a two body problem to be moved analytically
+ */
+void PatchedConicIntegrator::Classify(const BodyStore& bodies)
+{
+    auto& positions = bodies.GetPositions();
+    auto& masses = bodies.GetMasses();
+    uint32_t count = bodies.GetCount();
+
+    m_Order.resize(count);
+    std::iota(m_Order.begin(), m_Order.end(), 0);
+    std::stable_sort(m_Order.begin(), m_Order.end(), [&](uint32_t a, uint32_t b) { return masses[a] > masses[b]; });
+
+    m_Primaries.assign(count, -1);
+    m_SpheresOfInfluence.assign(count, 0.0);
+    uint32_t root = m_Order[0];
+    m_SpheresOfInfluence[root] = std::numeric_limits<double>::max();
+
+    // heavier bodies come first so their spheres of influence are known by the time they are needed
+    for (uint32_t i = 1; i < count; i++)
+    {
+        uint32_t body = m_Order[i];
+        int32_t primary = (int32_t)root;
+        for (uint32_t j = 1; j < i; j++)
+        {
+            uint32_t candidate = m_Order[j];
+            double sphere = m_SpheresOfInfluence[candidate];
+            if (sphere < m_SpheresOfInfluence[primary] && glm::length(positions[body] - positions[candidate]) < sphere)
+                primary = (int32_t)candidate;
+        }
+        m_Primaries[body] = primary;
+        if (masses[primary] > 0.0)
+        {
+            double distance = glm::length(positions[body] - positions[primary]);
+            m_SpheresOfInfluence[body] = distance * std::pow(masses[body] / masses[primary], 0.4);
+        }
+    }
+
+    // tidal pull of everything else compared to the pull of the primary
+    m_Analytic.assign(count, true);
+    m_Numeric.clear();
+    for (uint32_t body = 0; body < count; body++)
+    {
+        int32_t primary = m_Primaries[body];
+        if (primary < 0)
+            continue;
+
+        glm::dvec3 offset = positions[primary] - positions[body];
+        double distanceSquared = glm::dot(offset, offset);
+        double central = masses[primary] / distanceSquared;
+
+        glm::dvec3 tidal{0.0};
+        for (uint32_t other = 0; other < count; other++)
+        {
+            if (other == body || other == (uint32_t)primary || masses[other] == 0.0)
+                continue;
+
+            glm::dvec3 toBody = positions[other] - positions[body];
+            glm::dvec3 toPrimary = positions[other] - positions[primary];
+            double bodyDistance = glm::length(toBody);
+            double primaryDistance = glm::length(toPrimary);
+            tidal += masses[other] * (toBody / (bodyDistance * bodyDistance * bodyDistance) 
+                - toPrimary / (primaryDistance * primaryDistance * primaryDistance));
+        }
+
+        if (!(central > 0.0) || glm::length(tidal) > m_PerturbationThreshold * central)
+        {
+            m_Analytic[body] = false;
+            m_Numeric.push_back(body);
+        }
+    }
+    m_AnalyticCount = count - (uint32_t)m_Numeric.size();
+}
+
+/**
+ * @brief Moves analytic bodies to time seconds after the start of the step, relative to
+ * wherever their primary is at that moment
+ */
+void PatchedConicIntegrator::PlaceAnalytic(const std::vector<double>& masses, double time)
+{
+    for (uint32_t body : m_Order)
+    {
+        if (!m_Analytic[body])
+            continue;
+
+        int32_t primary = m_Primaries[body];
+        if (primary < 0)
+        {
+            m_Positions[body] = m_RootPosition + m_RootDrift * time;
+            m_Velocities[body] = m_RootDrift;
+            continue;
+        }
+
+        glm::dvec3 position = m_RelativePositions[body];
+        glm::dvec3 velocity = m_RelativeVelocities[body];
+        if (!KeplerDrift(position, velocity, GRAVITATIONAL_CONSTANT * (masses[primary] + masses[body]), time))
+            position += velocity * time;
+
+        m_Positions[body] = m_Positions[primary] + position;
+        m_Velocities[body] = m_Velocities[primary] + velocity;
+    }
+}
+
+void PatchedConicIntegrator::ComputeNumericAccelerations(const std::vector<double>& masses)
+{
+    m_Accelerations.resize(m_Positions.size());
+    for (uint32_t body : m_Numeric)
+    {
+        glm::dvec3 acceleration{0.0};
+        for (uint32_t other = 0; other < (uint32_t)m_Positions.size(); other++)
+        {
+            glm::dvec3 offset = m_Positions[other] - m_Positions[body];
+            double distanceSquared = glm::dot(offset, offset);
+            if (other == body || distanceSquared <= 0.0)
+                continue;
+            double inverseDistance = 1.0 / std::sqrt(distanceSquared);
+            acceleration += offset * (masses[other] * inverseDistance * inverseDistance * inverseDistance);
+        }
+        m_Accelerations[body] = acceleration * GRAVITATIONAL_CONSTANT;
+    }
+}
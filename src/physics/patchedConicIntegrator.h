@@ -0,0 +1,54 @@
+#pragma once
+
+#include "integrator.h"
+
+/**
+ * @brief Fast forward through long stretches of time with patched conics. Every body orbits
+ * the smallest sphere of influence it's inside of, and while the tidal pull of everything
+ * else stays below the threshold relative to its primary it is moved along that orbit
+ * analytically, whatever the step size. Only perturbed bodies are integrated numerically,
+ * with leapfrog substeps sized to their own orbits.
+ * @note The most massive body drifts with the center of mass and analytic bodies don't feel
+ * perturbed ones. Classification is O(N^2), meant for planetary systems, not clusters.
+ * Forces are summed directly, the solver passed to Step is ignored.
+ */
+class PatchedConicIntegrator : public Integrator
+{
+public:
+    PatchedConicIntegrator(double perturbationThreshold = 0.01);
+
+    void Step(BodyStore& bodies, GravitySolver& solver, double delta) override;
+
+    inline void SetPerturbationThreshold(double threshold) { m_PerturbationThreshold = threshold; }
+    inline uint32_t GetAnalyticCount() const { return m_AnalyticCount; }
+    inline uint32_t GetNumericCount() const { return (uint32_t)m_Numeric.size(); }
+private:
+    // substeps per orbit around the primary for perturbed bodies
+    static constexpr double SUBSTEPS_PER_ORBIT = 200.0;
+    static constexpr uint32_t MAX_SUBSTEPS = 100000;
+
+    void Classify(const BodyStore& bodies);
+    void PlaceAnalytic(const std::vector<double>& masses, double time);
+    void ComputeNumericAccelerations(const std::vector<double>& masses);
+
+    double m_PerturbationThreshold;
+    uint32_t m_AnalyticCount = 0;
+
+    // most massive first, so every primary is placed before its satellites
+    std::vector<uint32_t> m_Order;
+    std::vector<int32_t> m_Primaries;
+    std::vector<double> m_SpheresOfInfluence;
+    std::vector<bool> m_Analytic;
+    std::vector<uint32_t> m_Numeric;
+
+    // state at the start of the step, relative to primary for analytic bodies
+    std::vector<glm::dvec3> m_RelativePositions;
+    std::vector<glm::dvec3> m_RelativeVelocities;
+    glm::dvec3 m_RootPosition{0.0};
+    glm::dvec3 m_RootDrift{0.0};
+
+    // working state at the current substep time
+    std::vector<glm::dvec3> m_Positions;
+    std::vector<glm::dvec3> m_Velocities;
+    std::vector<glm::dvec3> m_Accelerations;
+};
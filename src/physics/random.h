@@ -0,0 +1,42 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include <random>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief mt19937_64 output is fixed by the standard, the conversions below are ours so the same seed
+ * draws the same numbers with every compiler and standard library, std distributions don't
+ */
+class Random
+{
+public:
+    explicit Random(uint64_t seed) : m_Engine(seed) {}
+
+    // [0, 1)
+    double Uniform() { return (double)(m_Engine() >> 11) * 0x1.0p-53; }
+    // (0, 1], safe to take the log of
+    double UniformOpen() { return 1.0 - Uniform(); }
+    double Uniform(double min, double max) { return min + (max - min) * Uniform(); }
+    double LogUniform(double min, double max) { return min * std::pow(max / min, Uniform()); }
+    double Angle() { return Uniform(0.0, 2.0 * M_PI); }
+
+    // standard normal, Box-Muller
+    double Normal()
+    {
+        return std::sqrt(-2.0 * std::log(UniformOpen())) * std::cos(Angle());
+    }
+
+    glm::dvec3 Direction()
+    {
+        double y = Uniform(-1.0, 1.0);
+        double angle = Angle();
+        double r = std::sqrt(1.0 - y * y);
+        return {r * std::cos(angle), y, r * std::sin(angle)};
+    }
+private:
+    std::mt19937_64 m_Engine;
+};
@@ -0,0 +1,257 @@
+#include "simulation.h"
+#include "barnesHutSolver.h"
+#include "fmmSolver.h"
+#include "wisdomHolmanIntegrator.h"
+#include "ias15Integrator.h"
+#include "patchedConicIntegrator.h"
+#include "diagnostics.h"
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+Simulation::Simulation()
+{
+    m_Settings.threadCount = (int)std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+/**
+ * @brief Advances every body by delta seconds with the integrator selected in settings,
+ * test particles follow with kick drift kick around the massive step
+ */
+void Simulation::Step(double delta)
+{
+    if (m_Settings.collisions)
+        ResolveCollisions();
+
+    auto& rotations = m_Bodies.GetRotations();
+    auto& rotationSpeeds = m_Bodies.GetRotationSpeeds();
+    uint32_t count = m_Bodies.GetCount();
+
+    GravitySolver& solver = GetSolver();
+    Integrator& integrator = GetIntegrator();
+    if (count != m_LastCount)
+    {
+        m_LastCount = count;
+        integrator.Reset();
+    }
+
+    // patched conics jumps whole orbits at once, kicking particles that far would throw them away
+    bool particles = m_Particles.GetCount() > 0 && count > 0;
+    bool analyticParticles = particles && m_CurrentIntegrator == IntegratorType::PatchedConics;
+    uint32_t dominant = 0;
+    glm::dvec3 centerBefore{0.0}, centerVelocityBefore{0.0};
+    if (particles)
+    {
+        m_Particles.SetThreadPool(&m_ThreadPool);
+        if (analyticParticles)
+        {
+            dominant = FindHeaviestBody(m_Bodies); // test particles orbit it in analytic mode
+            centerBefore = m_Bodies.GetPositions()[dominant];
+            centerVelocityBefore = m_Bodies.GetVelocities()[dominant];
+        }
+        else
+        {
+            m_Particles.BeginStep(m_Bodies, delta);
+        }
+    }
+
+    integrator.Step(m_Bodies, solver, delta);
+
+    if (particles)
+    {
+        if (analyticParticles)
+        {
+            m_Particles.KeplerStep(centerBefore, centerVelocityBefore, m_Bodies.GetPositions()[dominant], 
+                m_Bodies.GetVelocities()[dominant], m_Bodies.GetMasses()[dominant] * GRAVITATIONAL_CONSTANT, delta
+            );
+        }
+        else
+        {
+            m_Particles.EndStep(m_Bodies, delta);
+            if (m_Settings.collisions)
+                m_Particles.RemoveAbsorbed();
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+        rotations[i] += rotationSpeeds[i] * delta;
+
+    m_Time += delta;
+}
+
+std::vector<double> Simulation::SaveIntegratorState() const
+{
+    std::vector<double> state;
+    if (m_Integrator && m_CurrentIntegrator == m_Settings.integrator)
+        m_Integrator->SaveState(state);
+    return state;
+}
+
+bool Simulation::LoadIntegratorState(const std::vector<double>& state)
+{
+    // same order as Step, a new solver would reset the integrator again
+    GetSolver();
+    Integrator& integrator = GetIntegrator();
+    m_LastCount = m_Bodies.GetCount();
+    m_Particles.Invalidate();
+    return integrator.LoadState(state, m_LastCount);
+}
+
+/**
+ * @brief Returns integrator selected in settings, recreating it only when the selection changes
+ */
+Integrator& Simulation::GetIntegrator()
+{
+    if (m_CurrentIntegrator != m_Settings.integrator)
+    {
+        m_CurrentIntegrator = m_Settings.integrator;
+        switch (m_CurrentIntegrator)
+        {
+        case IntegratorType::SemiImplicitEuler:
+            m_Integrator = std::make_unique<EulerIntegrator>();
+            break;
+        case IntegratorType::Yoshida4:
+            m_Integrator = std::make_unique<CompositionIntegrator>(CompositionIntegrator::CreateYoshida4());
+            break;
+        case IntegratorType::Yoshida6:
+            m_Integrator = std::make_unique<CompositionIntegrator>(CompositionIntegrator::CreateYoshida6());
+            break;
+        case IntegratorType::Hermite:
+            m_Integrator = std::make_unique<HermiteIntegrator>();
+            break;
+        case IntegratorType::WisdomHolman:
+            m_Integrator = std::make_unique<WisdomHolmanIntegrator>();
+            break;
+        case IntegratorType::Ias15:
+            m_Integrator = std::make_unique<Ias15Integrator>(m_Settings.tolerance);
+            break;
+        case IntegratorType::PatchedConics:
+            m_Integrator = std::make_unique<PatchedConicIntegrator>(m_Settings.perturbationThreshold);
+            break;
+        case IntegratorType::Leapfrog:
+        default:
+            m_Integrator = std::make_unique<CompositionIntegrator>(CompositionIntegrator::CreateLeapfrog());
+            break;
+        }
+        m_Integrator->SetThreadPool(&m_ThreadPool);
+    }
+
+    if (m_CurrentIntegrator == IntegratorType::Ias15)
+        static_cast<Ias15Integrator*>(m_Integrator.get())->SetTolerance(m_Settings.tolerance);
+    else if (m_CurrentIntegrator == IntegratorType::PatchedConics)
+        static_cast<PatchedConicIntegrator*>(m_Integrator.get())->SetPerturbationThreshold(m_Settings.perturbationThreshold);
+
+    return *m_Integrator;
+}
+
+/**
+ * @brief Returns solver selected in settings, recreating it only when the selection changes
+ */
+GravitySolver& Simulation::GetSolver()
+{
+    if (m_CurrentSolver != m_Settings.solver)
+    {
+        m_CurrentSolver = m_Settings.solver;
+        if (m_Integrator)
+            m_Integrator->Reset();
+        switch (m_CurrentSolver)
+        {
+        case SolverType::BarnesHut:
+            m_Solver = std::make_unique<BarnesHutSolver>(m_Settings.openingAngle);
+            break;
+        case SolverType::FastMultipole:
+            m_Solver = std::make_unique<FmmSolver>(m_Settings.expansionOrder, m_Settings.openingAngle);
+            break;
+        case SolverType::DirectSum:
+        default:
+            m_Solver = std::make_unique<DirectSolver>(m_Settings.vectorize);
+            break;
+        }
+    }
+
+    m_ThreadPool.Resize((uint32_t)std::max(m_Settings.threadCount, 1));
+    m_Solver->SetThreadPool(&m_ThreadPool);
+
+    if (m_CurrentSolver == SolverType::DirectSum)
+    {
+        static_cast<DirectSolver*>(m_Solver.get())->SetVectorize(m_Settings.vectorize);
+    }
+    else if (m_CurrentSolver == SolverType::BarnesHut)
+    {
+        static_cast<BarnesHutSolver*>(m_Solver.get())->SetOpeningAngle(m_Settings.openingAngle);
+    }
+    else if (m_CurrentSolver == SolverType::FastMultipole)
+    {
+        FmmSolver* fmm = static_cast<FmmSolver*>(m_Solver.get());
+        fmm->SetOpeningAngle(m_Settings.openingAngle);
+        fmm->SetOrder(m_Settings.expansionOrder);
+    }
+
+    return *m_Solver;
+}
+
+/**
+ * @brief Evaluates current solver once and compares it against direct summation, 
+ * used to pick expansion order and opening angle for given accuracy budget
+ */
+SolverError Simulation::MeasureSolverError(uint32_t sampleCount)
+{
+    std::vector<glm::dvec3> accelerations;
+    GetSolver().ComputeAccelerations(m_Bodies.GetPositions(), m_Bodies.GetMasses(), accelerations);
+    return ::MeasureSolverError(m_Bodies.GetPositions(), m_Bodies.GetMasses(), accelerations, sampleCount);
+}
+
+/**
+ * @brief Broad phase finds touching pairs, each of them is merged into one body
+ */
+void Simulation::ResolveCollisions()
+{
+    m_CollisionDetector.FindPairs(m_Bodies, m_CollisionPairs);
+    if (m_CollisionPairs.empty())
+        return;
+
+    // dense indices shift with every removal, handles stay put
+    m_CollisionHandles.clear();
+    for (auto& [a, b] : m_CollisionPairs)
+        m_CollisionHandles.emplace_back(m_Bodies.GetHandle(a), m_Bodies.GetHandle(b));
+
+    for (auto& [a, b] : m_CollisionHandles)
+    {
+        // one of them was already absorbed by someone else, the new body gets checked next step
+        if (!m_Bodies.IsValid(a) || !m_Bodies.IsValid(b))
+            continue;
+        MergeBodies(a, b);
+    }
+}
+
+/**
+ * @brief Perfectly inelastic merge, heavier body survives with combined mass and volume
+ * at the center of mass, momentum is conserved
+ */
+void Simulation::MergeBodies(BodyHandle a, BodyHandle b)
+{
+    auto& positions = m_Bodies.GetPositions();
+    auto& velocities = m_Bodies.GetVelocities();
+    auto& masses = m_Bodies.GetMasses();
+    auto& radii = m_Bodies.GetRadii();
+
+    uint32_t indexA = m_Bodies.GetIndex(a);
+    uint32_t indexB = m_Bodies.GetIndex(b);
+    if (masses[indexB] > masses[indexA])
+    {
+        std::swap(a, b);
+        std::swap(indexA, indexB);
+    }
+
+    double mass = masses[indexA] + masses[indexB];
+    double weightA = mass > 0.0 ? masses[indexA] / mass : 0.5;
+    double weightB = 1.0 - weightA;
+    positions[indexA] = positions[indexA] * weightA + positions[indexB] * weightB;
+    velocities[indexA] = velocities[indexA] * weightA + velocities[indexB] * weightB;
+    radii[indexA] = std::cbrt(radii[indexA] * radii[indexA] * radii[indexA] + radii[indexB] * radii[indexB] * radii[indexB]);
+    masses[indexA] = mass;
+
+    m_Bodies.Remove(b);
+    m_Merges.push_back({a, b});
+}
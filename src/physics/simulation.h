@@ -0,0 +1,88 @@
+#pragma once
+
+#include "bodyStore.h"
+#include "gravitySolver.h"
+#include "integrator.h"
+#include "collisions.h"
+#include "testParticles.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Everything that decides how the system is integrated, filled in per scenario
+ * and changed at runtime from ImGui.
+ */
+struct SimulationSettings
+{
+    int integrator = IntegratorType::Leapfrog;
+    float tolerance = 1e-9f; // IAS15 relative error per step
+    float perturbationThreshold = 0.01f; // patched conics, tidal / central pull above which a body is integrated numerically
+    int solver = SolverType::DirectSum;
+    float openingAngle = 0.5f; // Barnes-Hut and FMM theta
+    int expansionOrder = 4; // FMM
+    bool vectorize = true; // use SIMD direct summation kernels when the CPU supports them
+    int threadCount = 1; // force evaluation threads, including the one calling Step
+    bool collisions = true; // merge touching bodies
+
+    bool operator==(const SimulationSettings& other) const = default;
+};
+
+/**
+ * @brief Owns body state and advances it in time. Doesn't know anything about rendering.
+ */
+class Simulation
+{
+public:
+    Simulation();
+
+    void Step(double delta);
+    SolverError MeasureSolverError(uint32_t sampleCount = 1000);
+
+    inline BodyStore& GetBodies() { return m_Bodies; }
+    inline const BodyStore& GetBodies() const { return m_Bodies; }
+    inline TestParticles& GetParticles() { return m_Particles; }
+    inline const TestParticles& GetParticles() const { return m_Particles; }
+    inline SimulationSettings& GetSettings() { return m_Settings; }
+    inline const SimulationSettings& GetSettings() const { return m_Settings; }
+    inline Integrator* GetCurrentIntegrator() { return m_Integrator.get(); } // null until the first step
+    inline double GetTime() const { return m_Time; } // seconds
+    // bodies absorbed in collisions since the last ClearMerges, so that owners can drop whatever they keep per body
+    inline const std::vector<BodyMerge>& GetMerges() const { return m_Merges; }
+    inline void ClearMerges() { m_Merges.clear(); }
+    inline void SetTime(double time) { m_Time = time; }
+
+    /**
+     * @brief State of the current integrator that following steps depend on, empty before the first step
+     */
+    std::vector<double> SaveIntegratorState() const;
+    /**
+     * @brief Creates integrator selected in settings for the bodies already in the store and hands it state,
+     * so the next Step continues where the saved run stopped instead of starting over
+     * @return false when state didn't fit and the integrator starts from scratch
+     */
+    bool LoadIntegratorState(const std::vector<double>& state);
+private:
+    GravitySolver& GetSolver();
+    Integrator& GetIntegrator();
+    void ResolveCollisions();
+    void MergeBodies(BodyHandle a, BodyHandle b);
+
+    BodyStore m_Bodies;
+    TestParticles m_Particles;
+    SimulationSettings m_Settings;
+
+    ThreadPool m_ThreadPool;
+    std::unique_ptr<GravitySolver> m_Solver;
+    int m_CurrentSolver = -1;
+    std::unique_ptr<Integrator> m_Integrator;
+    int m_CurrentIntegrator = -1;
+    uint32_t m_LastCount = 0;
+
+    CollisionDetector m_CollisionDetector;
+    std::vector<std::pair<uint32_t, uint32_t>> m_CollisionPairs;
+    std::vector<std::pair<BodyHandle, BodyHandle>> m_CollisionHandles;
+    std::vector<BodyMerge> m_Merges;
+
+    double m_Time = 0.0;
+};
@@ -0,0 +1,35 @@
+#include "simulationScheduler.h"
+
+#include <cmath>
+#include <algorithm>
+
+uint32_t SimulationScheduler::PlanIterations(uint32_t requested) const
+{
+    requested = std::max(requested, 1u);
+    if (m_IterationCost <= 0.0)
+        return requested;
+
+    double affordable = std::floor(m_Budget / m_IterationCost);
+    if (affordable >= (double)requested)
+        return requested;
+    return (uint32_t)std::max(affordable, 1.0);
+}
+
+void SimulationScheduler::RecordIterations(uint32_t iterations, double seconds)
+{
+    if (iterations == 0)
+        return;
+
+    double cost = seconds / (double)iterations;
+    if (m_IterationCost <= 0.0)
+        m_IterationCost = cost;
+    else
+        m_IterationCost += (cost - m_IterationCost) * COST_SMOOTHING;
+}
+
+void SimulationScheduler::RecordTick(uint32_t requested, uint32_t iterations, double simulatedSeconds, double tickInterval)
+{
+    m_Limited = iterations < requested;
+    m_Warp = simulatedSeconds / tickInterval;
+    m_RequestedWarp = iterations > 0 ? m_Warp * (double)requested / (double)iterations : m_Warp;
+}
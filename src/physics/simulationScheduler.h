@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Keeps simulation work per tick inside a wall clock budget. Cost of one iteration is measured
+ * as it runs, when the requested speed doesn't fit the budget fewer iterations are planned and the
+ * warp that can actually be sustained is reported instead of falling further and further behind.
+ */
+class SimulationScheduler
+{
+public:
+    /**
+     * @brief Iterations to run this tick, never more than requested and never less than one
+     */
+    uint32_t PlanIterations(uint32_t requested) const;
+    /**
+     * @brief Feeds measured cost back, iterations is how many ran and seconds how long they took
+     */
+    void RecordIterations(uint32_t iterations, double seconds);
+    /**
+     * @brief Updates warp figures after a tick that advanced simulated time by simulatedSeconds
+     */
+    void RecordTick(uint32_t requested, uint32_t iterations, double simulatedSeconds, double tickInterval);
+
+    inline void SetBudget(double seconds) { m_Budget = seconds; }
+    inline double GetBudget() const { return m_Budget; }
+    inline double GetIterationCost() const { return m_IterationCost; } // seconds, 0 until measured
+    inline double GetWarp() const { return m_Warp; } // simulated seconds per real second
+    inline double GetRequestedWarp() const { return m_RequestedWarp; }
+    inline bool IsLimited() const { return m_Limited; }
+private:
+    // weight of the newest measurement, smooths out a single slow step without lagging for seconds
+    static constexpr double COST_SMOOTHING = 0.2;
+
+    double m_Budget = 0.012;
+    double m_IterationCost = 0.0;
+    double m_Warp = 0.0;
+    double m_RequestedWarp = 0.0;
+    bool m_Limited = false;
+};
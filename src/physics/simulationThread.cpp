@@ -0,0 +1,457 @@
+#include "simulationThread.h"
+#include "patchedConicIntegrator.h"
+#include "diagnostics.h"
+#include "kepler.h"
+
+#include <algorithm>
+#include <iostream>
+
+SimulationThread::SimulationThread(Simulation& simulation)
+    : m_Simulation(simulation)
+{
+
+}
+
+SimulationThread::~SimulationThread()
+{
+    Stop();
+}
+
+void SimulationThread::Start()
+{
+    if (m_Thread.joinable())
+        return;
+
+    ApplyPending();
+    Publish();
+    m_Quit = false;
+    m_Thread = std::thread(&SimulationThread::Run, this);
+}
+
+void SimulationThread::Stop()
+{
+    if (!m_Thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_Wake.notify_one();
+    m_Thread.join();
+    CloseRecording();
+}
+
+void SimulationThread::SetSettings(const SimulationSettings& settings, const SimulationPacing& pacing)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_PendingSettings = settings;
+        m_PendingPacing = pacing;
+        m_SettingsChanged = true;
+        m_HasPending = true;
+    }
+    m_Wake.notify_one();
+}
+
+void SimulationThread::Enqueue(Command command)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Commands.push_back(std::move(command));
+        m_HasPending = true;
+    }
+    m_Wake.notify_one();
+}
+
+void SimulationThread::SetTraceInterval(BodyHandle handle, uint32_t interval, uint32_t length)
+{
+    Enqueue([this, handle, interval, length](Simulation&)
+    {
+        auto iter = std::find_if(m_Traces.begin(), m_Traces.end(), [&](const Trace& trace) { return trace.handle == handle; });
+        if (iter != m_Traces.end())
+            *iter = {handle, interval, length};
+        else
+            m_Traces.push_back({handle, interval, length});
+    });
+}
+
+void SimulationThread::WarpTo(double targetTime)
+{
+    m_CancelWarp = false;
+    m_WarpActive = true;
+    Enqueue([this, targetTime](Simulation& simulation)
+    {
+        if (targetTime <= simulation.GetTime())
+        {
+            m_WarpActive = false;
+            return;
+        }
+        m_Warping = true;
+        m_WarpStart = simulation.GetTime();
+        m_WarpTarget = targetTime;
+    });
+}
+
+void SimulationThread::CancelWarp()
+{
+    m_CancelWarp = true;
+}
+
+void SimulationThread::RebuildTrails()
+{
+    Enqueue([this](Simulation&)
+    {
+        SeedTrails();
+        Publish();
+    });
+}
+
+void SimulationThread::StartRecording(const std::string& filepath, double cadence)
+{
+    Enqueue([this, filepath, cadence](Simulation& simulation)
+    {
+        CloseRecording();
+        try
+        {
+            m_Recorder.Open(filepath, cadence);
+            m_Recorder.Record(simulation.GetBodies(), simulation.GetTime());
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    });
+}
+
+void SimulationThread::StopRecording()
+{
+    Enqueue([this](Simulation&)
+    {
+        CloseRecording();
+    });
+}
+
+void SimulationThread::TakeEvents(SimulationEvents& events)
+{
+    events.traces.clear();
+    events.merges.clear();
+    events.trails.clear();
+
+    std::lock_guard<std::mutex> lock(m_EventMutex);
+    std::swap(events, m_Events);
+}
+
+void SimulationThread::Run()
+{
+    Clock::time_point nextTick = Clock::now();
+    while (!m_Quit)
+    {
+        // commands change state the renderer should see even while paused
+        if (ApplyPending())
+            Publish();
+
+        if (m_Warping)
+        {
+            Warp();
+            nextTick = Clock::now();
+            m_LastTick = Clock::time_point{};
+            continue;
+        }
+
+        if (m_Pacing.pause)
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait(lock, [&]{ return m_Quit || m_HasPending; });
+            nextTick = Clock::now();
+            m_LastTick = Clock::time_point{};
+            continue;
+        }
+
+        if (Clock::now() < nextTick)
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Wake.wait_until(lock, nextTick, [&]{ return m_Quit || m_HasPending; });
+            continue;
+        }
+
+        Tick();
+        nextTick += TICK_INTERVAL;
+        // a tick that can't be split overran, start over from now instead of queuing up more work
+        if (Clock::now() > nextTick)
+            nextTick = Clock::now();
+        Publish();
+    }
+}
+
+/**
+ * @brief Applies settings and runs queued commands, returns true if any command ran
+ */
+bool SimulationThread::ApplyPending()
+{
+    if (!m_HasPending.exchange(false))
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_SettingsChanged)
+        {
+            m_Simulation.GetSettings() = m_PendingSettings;
+            m_Pacing = m_PendingPacing;
+            m_ThreadCount = m_PendingSettings.threadCount;
+            m_SettingsChanged = false;
+        }
+        std::swap(m_Commands, m_RunningCommands);
+    }
+
+    for (Command& command : m_RunningCommands)
+        command(m_Simulation);
+
+    bool ran = !m_RunningCommands.empty();
+    m_RunningCommands.clear();
+    return ran;
+}
+
+/**
+ * @brief One TICK_INTERVAL worth of simulated time, or as much of it as fits into the budget
+ */
+void SimulationThread::Tick()
+{
+    // patched conics covers the whole warp in a single analytic jump instead of gameSpeed separate steps
+    int integrator = m_Simulation.GetSettings().integrator;
+    bool fastForward = integrator == IntegratorType::PatchedConics;
+    uint32_t requested = fastForward ? 1 : (uint32_t)std::max(m_Pacing.gameSpeed, 1);
+    int stepCount = integrator == IntegratorType::Ias15 || fastForward ? 1 : std::max(m_Pacing.stepCount, 1);
+    double substepDelta = (fastForward ? m_Pacing.delta * m_Pacing.gameSpeed : m_Pacing.delta) / (double)stepCount;
+
+    Clock::time_point start = Clock::now();
+    m_Scheduler.SetBudget(m_Pacing.budget / 1000.0);
+    uint32_t iterations = m_Scheduler.PlanIterations(requested);
+    // cost estimate lags behind sudden changes (collisions, more particles), deadline keeps the budget anyway
+    Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_Scheduler.GetBudget()));
+    double startTime = m_Simulation.GetTime();
+
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (int j = 0; j < stepCount; j++)
+        {
+            m_Simulation.Step(substepDelta);
+        }
+        RecordTraces();
+        RecordTrajectory();
+        done++;
+
+        if (m_HasPending)
+        {
+            if (ApplyPending())
+                Publish();
+            if (m_Pacing.pause)
+                break;
+        }
+        if (m_Quit)
+            break;
+        // long ticks still show motion instead of jumping once they finish
+        Clock::time_point now = Clock::now();
+        if (now > deadline)
+            break;
+        if (now - m_LastPublish > PUBLISH_INTERVAL)
+            Publish();
+    }
+
+    Clock::time_point end = Clock::now();
+    m_Scheduler.RecordIterations(done, std::chrono::duration<double>(end - start).count());
+
+    // warp over real time between ticks, that's longer than TICK_INTERVAL when a tick overran
+    double tickInterval = std::chrono::duration<double>(TICK_INTERVAL).count();
+    if (m_LastTick != Clock::time_point{})
+        tickInterval = std::max(tickInterval, std::chrono::duration<double>(start - m_LastTick).count());
+    m_LastTick = start;
+    m_Scheduler.RecordTick(requested, done, m_Simulation.GetTime() - startTime, tickInterval);
+}
+
+/**
+ * @brief Hands trace samples and merges of the last iteration over to the owner
+ */
+void SimulationThread::RecordTraces()
+{
+    m_IterationCount = (m_IterationCount + 1) % uint32_t(0-1);
+    uint32_t burst = (uint32_t)std::max(int(m_Pacing.delta/60.0), 1);
+
+    const BodyStore& bodies = m_Simulation.GetBodies();
+    auto& positions = bodies.GetPositions();
+
+    {
+        std::lock_guard<std::mutex> lock(m_EventMutex);
+        for (const Trace& trace : m_Traces)
+        {
+            if (trace.interval == 0 || !bodies.IsValid(trace.handle))
+                continue;
+            // Update orbits less frequently to make them longer
+            if (m_IterationCount % trace.interval / burst == 0)
+                m_Events.traces.push_back({trace.handle, positions[bodies.GetIndex(trace.handle)]});
+        }
+    }
+    RecordMerges();
+}
+
+void SimulationThread::RecordMerges()
+{
+    auto& merges = m_Simulation.GetMerges();
+    if (merges.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_EventMutex);
+    m_Events.merges.insert(m_Events.merges.end(), merges.begin(), merges.end());
+    m_Simulation.ClearMerges();
+}
+
+void SimulationThread::RecordTrajectory()
+{
+    if (!m_Recorder.IsOpen())
+        return;
+
+    try
+    {
+        m_Recorder.Record(m_Simulation.GetBodies(), m_Simulation.GetTime());
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void SimulationThread::CloseRecording()
+{
+    try
+    {
+        m_Recorder.Close();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief Steps with the usual iteration and substep sizes until the target time, the last iteration is
+ * shortened to land on it exactly. Settings and commands are still applied on the way.
+ */
+void SimulationThread::Warp()
+{
+    int allThreads = (int)std::max(std::thread::hardware_concurrency(), 1u);
+    Clock::time_point lastPublish = Clock::now();
+    while (m_Warping && !m_Quit && !m_CancelWarp)
+    {
+        double remaining = m_WarpTarget - m_Simulation.GetTime();
+        if (remaining <= 0.0)
+            break;
+
+        m_Simulation.GetSettings().threadCount = std::max(m_ThreadCount, allThreads);
+        int integrator = m_Simulation.GetSettings().integrator;
+        if (integrator == IntegratorType::PatchedConics)
+        {
+            m_Simulation.Step(remaining);
+        }
+        else
+        {
+            int stepCount = integrator == IntegratorType::Ias15 ? 1 : std::max(m_Pacing.stepCount, 1);
+            double substepDelta = std::min(m_Pacing.delta, remaining) / (double)stepCount;
+            for (int j = 0; j < stepCount; j++)
+                m_Simulation.Step(substepDelta);
+        }
+        RecordMerges();
+        RecordTrajectory();
+
+        if (m_HasPending)
+            ApplyPending();
+        if (Clock::now() - lastPublish > WARP_PUBLISH_INTERVAL)
+        {
+            Publish();
+            lastPublish = Clock::now();
+        }
+    }
+
+    m_Simulation.GetSettings().threadCount = m_ThreadCount;
+    m_Warping = false;
+    m_CancelWarp = false;
+    SeedTrails();
+    Publish();
+    m_WarpActive = false;
+}
+
+/**
+ * @brief Trails recorded before the warp show where bodies were years ago. New ones are drawn back
+ * along the osculating orbit around the heaviest body, with the spacing regular recording would have.
+ */
+void SimulationThread::SeedTrails()
+{
+    const BodyStore& bodies = m_Simulation.GetBodies();
+    if (bodies.GetCount() == 0)
+        return;
+
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    uint32_t center = FindHeaviestBody(bodies);
+    uint32_t burst = (uint32_t)std::max(int(m_Pacing.delta/60.0), 1);
+
+    std::vector<TrailSeed> trails;
+    for (const Trace& trace : m_Traces)
+    {
+        if (trace.interval == 0 || trace.length == 0 || !bodies.IsValid(trace.handle))
+            continue;
+
+        uint32_t index = bodies.GetIndex(trace.handle);
+        TrailSeed seed{trace.handle, std::vector<glm::dvec3>(trace.length, positions[index])};
+        if (index != center)
+        {
+            double spacing = m_Pacing.delta * (double)trace.interval / (double)burst;
+            double mu = (masses[center] + masses[index]) * GRAVITATIONAL_CONSTANT;
+            glm::dvec3 position = positions[index] - positions[center];
+            glm::dvec3 velocity = velocities[index] - velocities[center];
+            for (uint32_t i = trace.length - 1; i > 0; i--)
+            {
+                if (!KeplerDrift(position, velocity, mu, -spacing))
+                    break;
+                seed.positions[i - 1] = positions[center] + position;
+            }
+        }
+        trails.push_back(std::move(seed));
+    }
+
+    std::lock_guard<std::mutex> lock(m_EventMutex);
+    // samples taken before the warp would land on top of the new trails
+    m_Events.traces.clear();
+    for (TrailSeed& seed : trails)
+        m_Events.trails.push_back(std::move(seed));
+}
+
+void SimulationThread::Publish()
+{
+    SimulationSnapshot& snapshot = m_Snapshots.GetWriteBuffer();
+    snapshot.bodies = m_Simulation.GetBodies();
+    snapshot.particlePositions = m_Simulation.GetParticles().GetPositions();
+    snapshot.particleVelocities = m_Simulation.GetParticles().GetVelocities();
+    snapshot.time = m_Simulation.GetTime();
+
+    snapshot.analyticCount = 0;
+    snapshot.numericCount = 0;
+    if (auto* conics = dynamic_cast<PatchedConicIntegrator*>(m_Simulation.GetCurrentIntegrator()))
+    {
+        snapshot.analyticCount = conics->GetAnalyticCount();
+        snapshot.numericCount = conics->GetNumericCount();
+    }
+
+    snapshot.warp = m_Scheduler.GetWarp();
+    snapshot.requestedWarp = m_Scheduler.GetRequestedWarp();
+    snapshot.iterationCost = m_Scheduler.GetIterationCost();
+    snapshot.budgetLimited = m_Scheduler.IsLimited();
+    snapshot.recording = m_Recorder.IsOpen();
+    snapshot.recordedFrames = m_Recorder.GetFrameCount();
+    snapshot.recordedBytes = m_Recorder.GetBytesWritten();
+    snapshot.warpProgress = m_Warping && m_WarpTarget > m_WarpStart ? (m_Simulation.GetTime() - m_WarpStart) / (m_WarpTarget - m_WarpStart) : 0.0;
+
+    m_Snapshots.Publish();
+    m_LastPublish = Clock::now();
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "simulation.h"
+#include "tripleBuffer.h"
+#include "simulationScheduler.h"
+#include "trajectory.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+/**
+ * @brief How fast simulated time runs. Every TICK_INTERVAL of real time advances the simulation by
+ * delta * gameSpeed seconds, split into gameSpeed iterations of stepCount substeps. Iterations that
+ * don't fit into the budget are dropped, not carried over.
+ */
+struct SimulationPacing
+{
+    double delta = 300.0; // seconds per iteration
+    int gameSpeed = 1; // iterations per tick
+    int stepCount = 1; // substeps per iteration, delta stays double all the way down so this can go high
+    float budget = 12.0f; // ms of simulation work per tick
+    bool pause = true;
+
+    bool operator==(const SimulationPacing& other) const = default;
+};
+
+/**
+ * @brief Immutable copy of everything the renderer and UI read, published by the simulation thread
+ */
+struct SimulationSnapshot
+{
+    BodyStore bodies;
+    std::vector<glm::dvec3> particlePositions;
+    std::vector<glm::dvec3> particleVelocities;
+    double time = 0.0; // seconds
+    uint32_t analyticCount = 0; // patched conics only
+    uint32_t numericCount = 0;
+    double warp = 0.0; // simulated seconds per real second over the last tick
+    double requestedWarp = 0.0; // what pacing asked for
+    double iterationCost = 0.0; // seconds
+    bool budgetLimited = false;
+    double warpProgress = 0.0; // 0 - 1 while warping
+    bool recording = false;
+    uint64_t recordedFrames = 0;
+    uint64_t recordedBytes = 0;
+};
+
+/**
+ * @brief Body position recorded at the iteration its orbit trace asked for
+ */
+struct TraceSample
+{
+    BodyHandle handle;
+    glm::dvec3 position;
+};
+
+/**
+ * @brief Whole orbit trace rebuilt after a warp, oldest position first
+ */
+struct TrailSeed
+{
+    BodyHandle handle;
+    std::vector<glm::dvec3> positions;
+};
+
+/**
+ * @brief Things that must not be skipped the way snapshots can be, handed over in order under a lock
+ */
+struct SimulationEvents
+{
+    std::vector<TraceSample> traces;
+    std::vector<BodyMerge> merges;
+    std::vector<TrailSeed> trails;
+};
+
+/**
+ * @brief Runs Simulation on its own thread so frame rate and simulation throughput don't drag each other
+ * down. State goes out through a lock free triple buffer, settings and commands come in under a mutex
+ * and are applied between iterations.
+ * @note Simulation must not be touched from other threads after Start, use Enqueue instead.
+ */
+class SimulationThread
+{
+public:
+    using Command = std::function<void(Simulation&)>;
+
+    SimulationThread(Simulation& simulation);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    /**
+     * @brief Publishes the initial state and starts the thread, first snapshot is available right away
+     */
+    void Start();
+    void Stop();
+
+    /**
+     * @brief Settings and pacing are picked up before the next iteration
+     */
+    void SetSettings(const SimulationSettings& settings, const SimulationPacing& pacing);
+    /**
+     * @brief Runs command on the simulation thread before the next iteration, in submission order
+     */
+    void Enqueue(Command command);
+    /**
+     * @brief Records body position every interval iterations for its orbit trace, 0 turns it off.
+     * Length is how many positions the trace keeps, used to rebuild it after a warp.
+     */
+    void SetTraceInterval(BodyHandle handle, uint32_t interval, uint32_t length);
+    /**
+     * @brief Runs flat out on every core until simulation time reaches targetTime, ignoring pause,
+     * pacing and budget. No trace samples are recorded on the way, trails are rebuilt at the end.
+     */
+    void WarpTo(double targetTime);
+    void CancelWarp();
+    /**
+     * @brief Redraws every orbit trace back along its current orbit the way a warp ends, for states
+     * that appear out of nowhere like a restored checkpoint
+     */
+    void RebuildTrails();
+    /**
+     * @brief Records a frame every cadence simulated seconds into filepath, warps included, until
+     * StopRecording. A recording already running is closed first. Failures are printed to std::cerr.
+     */
+    void StartRecording(const std::string& filepath, double cadence);
+    void StopRecording();
+    /**
+     * @brief True from WarpTo until trails were rebuilt, nothing in snapshots is worth drawing meanwhile
+     */
+    inline bool IsWarping() const { return m_WarpActive; }
+
+    /**
+     * @brief Swaps in the newest snapshot if one was published, returns false if it's still the same
+     */
+    inline bool AcquireSnapshot() { return m_Snapshots.Acquire(); }
+    inline const SimulationSnapshot& GetSnapshot() { return m_Snapshots.GetReadBuffer(); }
+    /**
+     * @brief Moves events gathered since the last call into events, its old content is dropped
+     */
+    void TakeEvents(SimulationEvents& events);
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::chrono::microseconds TICK_INTERVAL{16000};
+    static constexpr std::chrono::microseconds PUBLISH_INTERVAL{8000};
+    static constexpr std::chrono::microseconds WARP_PUBLISH_INTERVAL{100000};
+
+    struct Trace
+    {
+        BodyHandle handle;
+        uint32_t interval;
+        uint32_t length;
+    };
+
+    void Run();
+    bool ApplyPending();
+    void Tick();
+    void RecordTraces();
+    void RecordMerges();
+    void RecordTrajectory();
+    void CloseRecording();
+    void Warp();
+    void SeedTrails();
+    void Publish();
+
+    Simulation& m_Simulation;
+    std::thread m_Thread;
+    TripleBuffer<SimulationSnapshot> m_Snapshots;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::vector<Command> m_Commands;
+    std::vector<Command> m_RunningCommands;
+    SimulationSettings m_PendingSettings;
+    SimulationPacing m_PendingPacing;
+    bool m_SettingsChanged = false;
+    std::atomic<bool> m_HasPending{false};
+    std::atomic<bool> m_Quit{false};
+    std::atomic<bool> m_CancelWarp{false};
+    std::atomic<bool> m_WarpActive{false};
+
+    std::mutex m_EventMutex;
+    SimulationEvents m_Events;
+
+    // only touched by the simulation thread once started
+    SimulationPacing m_Pacing;
+    std::vector<Trace> m_Traces;
+    TrajectoryRecorder m_Recorder;
+    int m_ThreadCount = 1; // from settings, warp overrides it with every core
+    bool m_Warping = false;
+    double m_WarpStart = 0.0;
+    double m_WarpTarget = 0.0;
+    uint32_t m_IterationCount = 0;
+    Clock::time_point m_LastPublish;
+    Clock::time_point m_LastTick;
+    SimulationScheduler m_Scheduler;
+};
@@ -0,0 +1,505 @@
+#include "stateFile.h"
+#include "kepler.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <limits>
+#include <charconv>
+#include <string_view>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <numeric>
+#include <filesystem>
+
+#define STATE_READ_BLOCK (1 << 20) // bytes read at once by the text parser
+
+static_assert(sizeof(glm::dvec3) == 3 * sizeof(double), "Position columns are read straight into dvec3 arrays");
+
+namespace
+{
+    constexpr char MAGIC[8] = { 'G', 'R', 'A', 'V', 'S', 'C', 'E', 'N' };
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct BinaryHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint64_t bodyCount;
+        uint64_t orbitCount;
+        uint64_t particleCount;
+        double time;
+    };
+
+    /**
+     * @brief Bodies added as orbits, their state is filled in once every parent is known
+     */
+    struct PendingOrbits
+    {
+        OrbitalElementArrays elements; // mu is filled in by ResolveOrbits
+        std::vector<uint32_t> bodies; // dense index of the orbiting body
+        std::vector<uint32_t> parents; // dense index of the parent
+        std::vector<uint32_t> depths; // 1 around a state vector body, 2 around one of those and so on
+
+        void Add(uint32_t body, uint32_t parent, uint32_t depth)
+        {
+            bodies.push_back(body);
+            parents.push_back(parent);
+            depths.push_back(depth);
+        }
+    };
+
+    /**
+     * @brief Converts orbits a level at a time, parents always have their state before their children
+     * do. Orbits of a level are contiguous after sorting, so each level is one pass over the arrays.
+     */
+    void ResolveOrbits(BodyStore& bodies, PendingOrbits& orbits)
+    {
+        size_t count = orbits.bodies.size();
+        if (count == 0)
+            return;
+
+        if (!std::is_sorted(orbits.depths.begin(), orbits.depths.end()))
+        {
+            std::vector<uint32_t> order(count);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return orbits.depths[a] < orbits.depths[b]; });
+            auto permute = [&order](auto& values)
+            {
+                auto copy = values;
+                for (size_t i = 0; i < order.size(); i++)
+                    values[i] = copy[order[i]];
+            };
+            permute(orbits.bodies);
+            permute(orbits.parents);
+            permute(orbits.depths);
+            permute(orbits.elements.semiMajorAxis);
+            permute(orbits.elements.eccentricity);
+            permute(orbits.elements.inclination);
+            permute(orbits.elements.node);
+            permute(orbits.elements.periapsis);
+            permute(orbits.elements.meanAnomaly);
+        }
+
+        auto& positions = bodies.GetPositions();
+        auto& velocities = bodies.GetVelocities();
+        auto& masses = bodies.GetMasses();
+        orbits.elements.mu.resize(count);
+        for (size_t i = 0; i < count; i++)
+            orbits.elements.mu[i] = (masses[orbits.parents[i]] + masses[orbits.bodies[i]]) * GRAVITATIONAL_CONSTANT;
+
+        std::vector<glm::dvec3> relativePositions(count), relativeVelocities(count);
+        size_t first = 0;
+        while (first < count)
+        {
+            size_t last = first;
+            while (last < count && orbits.depths[last] == orbits.depths[first])
+                last++;
+
+            ElementsToState(orbits.elements, first, last - first, relativePositions.data() + first, relativeVelocities.data() + first);
+            for (size_t i = first; i < last; i++)
+            {
+                positions[orbits.bodies[i]] = positions[orbits.parents[i]] + relativePositions[i];
+                velocities[orbits.bodies[i]] = velocities[orbits.parents[i]] + relativeVelocities[i];
+            }
+            first = last;
+        }
+    }
+
+    /**
+     * @brief Line by line parser working on the read buffer in place, no string per line or token
+     */
+    class TextParser
+    {
+    public:
+        TextParser(const std::string& filepath, Simulation& simulation, std::vector<BodyStyle>* styles)
+            : m_Filepath(filepath), m_Simulation(simulation), m_Styles(styles), m_FirstBody(simulation.GetBodies().GetCount())
+        {
+
+        }
+
+        void ParseLine(const char* begin, const char* end)
+        {
+            m_LineNumber++;
+            std::string_view line(begin, end - begin);
+            m_Cursor = begin;
+            m_End = begin + std::min(line.find('#'), line.size());
+
+            std::string_view record = ReadWord();
+            if (record.empty())
+                return;
+
+            BodyStore& bodies = m_Simulation.GetBodies();
+            double values[9];
+            if (record == "time")
+            {
+                ReadNumbers(values, 1, "time value");
+                m_Simulation.SetTime(values[0]);
+            }
+            else if (record == "body")
+            {
+                ReadNumbers(values, 8, "body x y z vx vy vz mass radius");
+                bodies.Add({values[0], values[1], values[2]}, {values[3], values[4], values[5]}, values[6], values[7]);
+                m_Depths.push_back(0);
+            }
+            else if (record == "orbit")
+            {
+                ReadNumbers(values, 9, "orbit parent a e i node periapsis anomaly mass radius");
+                uint32_t parent = (uint32_t)values[0];
+                if (values[0] != (double)parent || parent >= m_Depths.size())
+                    Fail("orbit parent has to be the index of an earlier body");
+                if (!(values[1] > 0.0) || !(values[2] >= 0.0 && values[2] < 1.0))
+                    Fail("orbit needs a positive semi-major axis and eccentricity from 0 up to 1");
+
+                uint32_t body = m_FirstBody + (uint32_t)m_Depths.size();
+                bodies.Add(glm::dvec3(0.0), glm::dvec3(0.0), values[7], values[8]);
+                uint32_t depth = m_Depths[parent] + 1;
+                m_Depths.push_back(depth);
+                m_Orbits.Add(body, m_FirstBody + parent, depth);
+                OrbitalElementArrays& elements = m_Orbits.elements;
+                elements.semiMajorAxis.push_back(values[1]);
+                elements.eccentricity.push_back(values[2]);
+                elements.inclination.push_back(glm::radians(values[3]));
+                elements.node.push_back(glm::radians(values[4]));
+                elements.periapsis.push_back(glm::radians(values[5]));
+                elements.meanAnomaly.push_back(glm::radians(values[6]));
+            }
+            else if (record == "spin")
+            {
+                ReadNumbers(values, 6, "spin rx ry rz sx sy sz");
+                uint32_t body = LastBody("spin");
+                bodies.GetRotations()[body] = glm::radians(glm::dvec3(values[0], values[1], values[2]));
+                bodies.GetRotationSpeeds()[body] = glm::radians(glm::dvec3(values[3], values[4], values[5])) / 3600.0;
+            }
+            else if (record == "style")
+            {
+                BodyStyle style{};
+                style.handle = bodies.GetHandle(LastBody("style"));
+                style.label = std::string(ReadWord());
+                std::string_view type = ReadWord();
+                std::string_view texture = ReadWord();
+                if (style.label.empty() || (type != "star" && type != "planet") || texture.empty())
+                    Fail("expected style label star|planet texture|- r g b trail_length trail_interval");
+                style.star = type == "star";
+                if (texture != "-")
+                    style.texture = std::string(texture);
+                ReadNumbers(values, 5, "style label star|planet texture|- r g b trail_length trail_interval");
+                style.color = {(float)values[0], (float)values[1], (float)values[2]};
+                style.trailLength = (uint32_t)std::max(values[3], 0.0);
+                style.trailInterval = (uint32_t)std::max(values[4], 1.0);
+                if (m_Styles)
+                    m_Styles->push_back(std::move(style));
+            }
+            else if (record == "particle")
+            {
+                ReadNumbers(values, 6, "particle x y z vx vy vz");
+                m_Simulation.GetParticles().Add({values[0], values[1], values[2]}, {values[3], values[4], values[5]});
+            }
+            else
+            {
+                Fail("unknown record " + std::string(record));
+            }
+        }
+
+        void Finish()
+        {
+            ResolveOrbits(m_Simulation.GetBodies(), m_Orbits);
+        }
+    private:
+        std::string_view ReadWord()
+        {
+            while (m_Cursor < m_End && std::isspace((unsigned char)*m_Cursor))
+                m_Cursor++;
+            const char* start = m_Cursor;
+            while (m_Cursor < m_End && !std::isspace((unsigned char)*m_Cursor))
+                m_Cursor++;
+            return std::string_view(start, m_Cursor - start);
+        }
+
+        void ReadNumbers(double* values, int count, const char* expected)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                std::string_view word = ReadWord();
+                // from_chars doesn't take a leading plus
+                if (!word.empty() && word.front() == '+')
+                    word.remove_prefix(1);
+                auto result = std::from_chars(word.data(), word.data() + word.size(), values[i]);
+                if (word.empty() || result.ec != std::errc() || result.ptr != word.data() + word.size())
+                    Fail(std::string("expected ") + expected);
+            }
+        }
+
+        uint32_t LastBody(const char* record)
+        {
+            if (m_Depths.empty())
+                Fail(std::string(record) + " has to follow a body or orbit");
+            return m_FirstBody + (uint32_t)m_Depths.size() - 1;
+        }
+
+        [[noreturn]] void Fail(const std::string& message)
+        {
+            throw std::runtime_error(m_Filepath + ":" + std::to_string(m_LineNumber) + " " + message);
+        }
+
+        const std::string& m_Filepath;
+        Simulation& m_Simulation;
+        std::vector<BodyStyle>* m_Styles;
+        uint32_t m_FirstBody; // dense index of the first body of this file
+        uint32_t m_LineNumber = 0;
+        const char* m_Cursor = nullptr;
+        const char* m_End = nullptr;
+        std::vector<uint32_t> m_Depths; // per body of this file, 0 for state vectors
+        PendingOrbits m_Orbits;
+    };
+
+    template<typename T>
+    void ReadColumn(std::ifstream& file, T* values, uint64_t count)
+    {
+        file.read(reinterpret_cast<char*>(values), (std::streamsize)(count * sizeof(T)));
+    }
+
+    template<typename T>
+    void WriteColumn(std::ofstream& file, const T* values, uint64_t count)
+    {
+        file.write(reinterpret_cast<const char*>(values), (std::streamsize)(count * sizeof(T)));
+    }
+}
+
+void LoadStateText(const std::string& filepath, Simulation& simulation, std::vector<BodyStyle>* styles)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open state file " + filepath);
+
+    TextParser parser(filepath, simulation, styles);
+    std::vector<char> buffer;
+    size_t carried = 0; // start of a line cut off by the end of the last block
+    bool done = false;
+    while (!done)
+    {
+        buffer.resize(carried + STATE_READ_BLOCK);
+        file.read(buffer.data() + carried, STATE_READ_BLOCK);
+        size_t size = carried + (size_t)file.gcount();
+        done = !file;
+
+        const char* line = buffer.data();
+        const char* end = buffer.data() + size;
+        while (line < end)
+        {
+            const char* newline = (const char*)std::memchr(line, '\n', end - line);
+            if (!newline && !done)
+                break;
+            const char* lineEnd = newline ? newline : end;
+            parser.ParseLine(line, lineEnd > line && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd);
+            line = newline ? newline + 1 : end;
+        }
+        carried = (size_t)(end - line);
+        std::memmove(buffer.data(), line, carried);
+    }
+    parser.Finish();
+}
+
+void SaveStateText(const std::string& filepath, const Simulation& simulation)
+{
+    std::ofstream file(filepath);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open state file " + filepath);
+
+    file.precision(std::numeric_limits<double>::max_digits10);
+    file << "# km, km/s, kg, s\n";
+    file << "time " << simulation.GetTime() << "\n";
+
+    const BodyStore& bodies = simulation.GetBodies();
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    auto& radii = bodies.GetRadii();
+    for (uint32_t i = 0; i < bodies.GetCount(); i++)
+    {
+        file << "body " << positions[i].x << " " << positions[i].y << " " << positions[i].z << " "
+            << velocities[i].x << " " << velocities[i].y << " " << velocities[i].z << " "
+            << masses[i] << " " << radii[i] << "\n";
+
+        glm::dvec3 rotation = glm::degrees(bodies.GetRotations()[i]);
+        glm::dvec3 rotationSpeed = glm::degrees(bodies.GetRotationSpeeds()[i]) * 3600.0;
+        if (rotation != glm::dvec3(0.0) || rotationSpeed != glm::dvec3(0.0))
+        {
+            file << "spin " << rotation.x << " " << rotation.y << " " << rotation.z << " "
+                << rotationSpeed.x << " " << rotationSpeed.y << " " << rotationSpeed.z << "\n";
+        }
+    }
+
+    const TestParticles& particles = simulation.GetParticles();
+    for (uint32_t i = 0; i < particles.GetCount(); i++)
+    {
+        auto& position = particles.GetPositions()[i];
+        auto& velocity = particles.GetVelocities()[i];
+        file << "particle " << position.x << " " << position.y << " " << position.z << " "
+            << velocity.x << " " << velocity.y << " " << velocity.z << "\n";
+    }
+
+    if (!file.good())
+        throw std::runtime_error("Failed to write state file " + filepath);
+}
+
+void LoadStateBinary(const std::string& filepath, Simulation& simulation)
+{
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open scenario " + filepath);
+
+    BinaryHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error(filepath + " is not a binary scenario");
+    if (header.byteOrder != BYTE_ORDER_MARK)
+        throw std::runtime_error(filepath + " was written on a machine with different byte order");
+    if (header.version < 1 || header.version > SCENARIO_VERSION)
+        throw std::runtime_error(filepath + " is scenario version " + std::to_string(header.version) + ", expected up to " + std::to_string(SCENARIO_VERSION));
+
+    // everything is checked before the first body is added, version 1 has no rotation columns
+    bool spin = header.version >= 2;
+    uint64_t n = header.bodyCount, m = header.orbitCount, p = header.particleCount;
+    uint64_t bodyValues = spin ? 14 : 8;
+    uint64_t bodyBytes = n * bodyValues * sizeof(double);
+    uint64_t elementBytes = m * (sizeof(uint32_t) + 6 * sizeof(double));
+    uint64_t expected = sizeof(header) + bodyBytes + elementBytes + m * (bodyValues - 6) * sizeof(double) + p * 6 * sizeof(double);
+    std::error_code error;
+    if (std::filesystem::file_size(filepath, error) != expected)
+        throw std::runtime_error(filepath + " is truncated");
+    BodyStore& bodies = simulation.GetBodies();
+    if ((uint64_t)bodies.GetCount() + n + m > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error(filepath + " has more bodies than fit into a simulation");
+
+    // orbit elements don't go into the store, they are read and checked first
+    PendingOrbits orbits;
+    orbits.elements.Resize(m);
+    std::vector<uint32_t> parents(m);
+    file.seekg((std::streamoff)(sizeof(header) + bodyBytes));
+    ReadColumn(file, parents.data(), m);
+    ReadColumn(file, orbits.elements.semiMajorAxis.data(), m);
+    ReadColumn(file, orbits.elements.eccentricity.data(), m);
+    ReadColumn(file, orbits.elements.inclination.data(), m);
+    ReadColumn(file, orbits.elements.node.data(), m);
+    ReadColumn(file, orbits.elements.periapsis.data(), m);
+    ReadColumn(file, orbits.elements.meanAnomaly.data(), m);
+    if (!file)
+        throw std::runtime_error("Failed to read scenario " + filepath);
+
+    // parents only ever point back, depth of every orbit is known once its parent's is
+    std::vector<uint32_t> depths(m);
+    for (uint64_t i = 0; i < m; i++)
+    {
+        uint32_t parent = parents[i];
+        if (parent >= n + i)
+            throw std::runtime_error(filepath + " orbit " + std::to_string(i) + " has a parent that isn't before it");
+        double semiMajorAxis = orbits.elements.semiMajorAxis[i];
+        double eccentricity = orbits.elements.eccentricity[i];
+        if (!(semiMajorAxis > 0.0) || !(eccentricity >= 0.0 && eccentricity < 1.0))
+            throw std::runtime_error(filepath + " orbit " + std::to_string(i) + " needs a positive semi-major axis and eccentricity from 0 up to 1");
+        depths[i] = parent < n ? 1 : depths[parent - n] + 1;
+    }
+
+    uint32_t first = bodies.Append((uint32_t)(n + m));
+    TestParticles& particles = simulation.GetParticles();
+    uint32_t firstParticle = particles.GetCount();
+    particles.Resize(firstParticle + (uint32_t)p);
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    auto& radii = bodies.GetRadii();
+    auto& rotations = bodies.GetRotations();
+    auto& rotationSpeeds = bodies.GetRotationSpeeds();
+
+    file.seekg((std::streamoff)sizeof(header));
+    ReadColumn(file, positions.data() + first, n);
+    ReadColumn(file, velocities.data() + first, n);
+    ReadColumn(file, masses.data() + first, n);
+    ReadColumn(file, radii.data() + first, n);
+    if (spin)
+    {
+        ReadColumn(file, rotations.data() + first, n);
+        ReadColumn(file, rotationSpeeds.data() + first, n);
+    }
+
+    file.seekg((std::streamoff)elementBytes, std::ios::cur);
+    ReadColumn(file, masses.data() + first + n, m);
+    ReadColumn(file, radii.data() + first + n, m);
+    if (spin)
+    {
+        ReadColumn(file, rotations.data() + first + n, m);
+        ReadColumn(file, rotationSpeeds.data() + first + n, m);
+    }
+
+    ReadColumn(file, particles.GetPositions().data() + firstParticle, p);
+    ReadColumn(file, particles.GetVelocities().data() + firstParticle, p);
+    if (!file)
+    {
+        // simulation is left as it was, newest bodies go first so nothing gets swapped around
+        while (bodies.GetCount() > first)
+            bodies.Remove(bodies.GetHandle(bodies.GetCount() - 1));
+        particles.Resize(firstParticle);
+        throw std::runtime_error("Failed to read scenario " + filepath);
+    }
+
+    for (uint64_t i = 0; i < m; i++)
+        orbits.Add(first + (uint32_t)(n + i), first + parents[i], depths[i]);
+    ResolveOrbits(bodies, orbits);
+    simulation.SetTime(header.time);
+}
+
+void SaveStateBinary(const std::string& filepath, const Simulation& simulation)
+{
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to create scenario " + filepath);
+
+    const BodyStore& bodies = simulation.GetBodies();
+    const TestParticles& particles = simulation.GetParticles();
+    BinaryHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = SCENARIO_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.bodyCount = bodies.GetCount();
+    header.orbitCount = 0;
+    header.particleCount = particles.GetCount();
+    header.time = simulation.GetTime();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    WriteColumn(file, bodies.GetPositions().data(), header.bodyCount);
+    WriteColumn(file, bodies.GetVelocities().data(), header.bodyCount);
+    WriteColumn(file, bodies.GetMasses().data(), header.bodyCount);
+    WriteColumn(file, bodies.GetRadii().data(), header.bodyCount);
+    WriteColumn(file, bodies.GetRotations().data(), header.bodyCount);
+    WriteColumn(file, bodies.GetRotationSpeeds().data(), header.bodyCount);
+    WriteColumn(file, particles.GetPositions().data(), header.particleCount);
+    WriteColumn(file, particles.GetVelocities().data(), header.particleCount);
+    if (!file.good())
+        throw std::runtime_error("Failed to write scenario " + filepath);
+}
+
+void LoadScenario(const std::string& filepath, Simulation& simulation, std::vector<BodyStyle>* styles)
+{
+    char magic[sizeof(MAGIC)] = {};
+    {
+        std::ifstream file(filepath, std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open scenario " + filepath);
+        file.read(magic, sizeof(magic));
+    }
+
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0)
+        LoadStateBinary(filepath, simulation);
+    else
+        LoadStateText(filepath, simulation, styles);
+}
+
+void SaveScenario(const std::string& filepath, const Simulation& simulation)
+{
+    if (std::filesystem::path(filepath).extension() == ".bin")
+        SaveStateBinary(filepath, simulation);
+    else
+        SaveStateText(filepath, simulation);
+}
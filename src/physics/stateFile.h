@@ -0,0 +1,92 @@
+#pragma once
+
+#include "simulation.h"
+
+#include <string>
+#include <vector>
+
+#define SCENARIO_VERSION 2 // binary, 1 had no rotation columns and still loads
+
+/**
+ * @brief Plain text simulation state, one record per line, '#' starts a comment. Units are km, km/s, kg, s.
+ *
+ *     time <t>
+ *     body <x> <y> <z> <vx> <vy> <vz> <mass> <radius>
+ *     orbit <parent> <a> <e> <i> <node> <periapsis> <mean anomaly> <mass> <radius>
+ *     spin <rx> <ry> <rz> <sx> <sy> <sz>
+ *     style <label> <star|planet> <texture|-> <r> <g> <b> <trail length> <trail interval>
+ *     particle <x> <y> <z> <vx> <vy> <vz>
+ *
+ * Orbit adds a body on an elliptic orbit around parent, the index of an earlier body or orbit line of the
+ * same file counting from 0. Angles are degrees, zero inclination is the XZ plane. Spin sets starting
+ * rotation in degrees and spin in degrees per hour of the body above it, style how the viewer draws it.
+ * Bodies without style are drawn as points, so a scenario can hold millions of them.
+ *
+ * @note Written with full double precision so a saved state loads back bit exact.
+ */
+
+/**
+ * @brief Binary columnar scenario for large inputs, the header is followed by every column in turn so
+ * each one is a single read straight into its array.
+ *
+ *     header
+ *     bodies     position[3n] velocity[3n] mass[n] radius[n] rotation[3n] spin[3n]
+ *     orbits     parent[m] (uint32) a[m] e[m] i[m] node[m] periapsis[m] meanAnomaly[m] mass[m] radius[m]
+ *                rotation[3m] spin[3m]
+ *     particles  position[3p] velocity[3p]
+ *
+ * Orbit parents count bodies first, then orbits. Angles are radians and spin radians per second here,
+ * everything else is double in the units of the text format and native byte order.
+ */
+
+/**
+ * @brief How the viewer shows a body, only the handful of bodies that get a mesh and a trail carry one
+ */
+struct BodyStyle
+{
+    BodyHandle handle;
+    std::string label;
+    bool star = false; // lights the scene
+    std::string texture; // file name in assets/textures, empty for none
+    glm::vec3 color{1.0f}; // icon and orbit trace
+    uint32_t trailLength = 0; // points
+    uint32_t trailInterval = 1; // iterations between trail points
+};
+
+/**
+ * @brief Appends bodies and particles from file to the simulation, time is set if the file has it. The
+ * file is read in blocks and parsed in place, orbits are converted together once everything is read.
+ * @param styles receives styles of the bodies that have one, may be null
+ * @throws std::runtime_error when the file can't be opened or a line can't be parsed
+ */
+void LoadStateText(const std::string& filepath, Simulation& simulation, std::vector<BodyStyle>* styles = nullptr);
+
+/**
+ * @throws std::runtime_error when the file can't be written
+ */
+void SaveStateText(const std::string& filepath, const Simulation& simulation);
+
+/**
+ * @brief Appends bodies and particles of a binary scenario and sets time
+ * @throws std::runtime_error when the file can't be opened, is from a newer version, is truncated or has an
+ * orbit that can't be resolved, simulation is left untouched then
+ */
+void LoadStateBinary(const std::string& filepath, Simulation& simulation);
+
+/**
+ * @brief Writes bodies as state vectors, a text scenario with orbits saved like this loads without any conversion
+ * @throws std::runtime_error when the file can't be written
+ */
+void SaveStateBinary(const std::string& filepath, const Simulation& simulation);
+
+/**
+ * @brief Binary or text depending on what the file starts with
+ * @throws std::runtime_error like the loaders above
+ */
+void LoadScenario(const std::string& filepath, Simulation& simulation, std::vector<BodyStyle>* styles = nullptr);
+
+/**
+ * @brief Binary when filepath ends in .bin, text otherwise
+ * @throws std::runtime_error when the file can't be written
+ */
+void SaveScenario(const std::string& filepath, const Simulation& simulation);
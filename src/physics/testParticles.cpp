@@ -0,0 +1,204 @@
+#include "testParticles.h"
+#include "gravitySolver.h"
+#include "kepler.h"
+
+#include <cmath>
+#include <algorithm>
+
+void TestParticles::Add(const glm::dvec3& position, const glm::dvec3& velocity)
+{
+    m_Positions.push_back(position);
+    m_Velocities.push_back(velocity);
+    m_Accelerations.push_back(glm::dvec3(0.0));
+    m_Absorbed.push_back(0);
+    m_AccelerationsValid = false;
+}
+
+void TestParticles::Clear()
+{
+    m_Positions.clear();
+    m_Velocities.clear();
+    m_Accelerations.clear();
+    m_Absorbed.clear();
+    m_AccelerationsValid = false;
+    m_HasAbsorbed = false;
+}
+
+void TestParticles::Reserve(uint32_t count)
+{
+    m_Positions.reserve(count);
+    m_Velocities.reserve(count);
+    m_Accelerations.reserve(count);
+    m_Absorbed.reserve(count);
+}
+
+void TestParticles::Resize(uint32_t count)
+{
+    m_Positions.resize(count, glm::dvec3(0.0));
+    m_Velocities.resize(count, glm::dvec3(0.0));
+    m_Accelerations.resize(count, glm::dvec3(0.0));
+    m_Absorbed.resize(count, 0);
+    m_AccelerationsValid = false;
+}
+
+void TestParticles::BeginStep(const BodyStore& bodies, double delta)
+{
+    if (!m_AccelerationsValid || m_SourceCount != bodies.GetCount())
+        ComputeAccelerations(bodies);
+
+    Kick(delta * 0.5);
+    for (uint32_t i = 0; i < GetCount(); i++)
+        m_Positions[i] += m_Velocities[i] * delta;
+}
+
+void TestParticles::EndStep(const BodyStore& bodies, double delta)
+{
+    ComputeAccelerations(bodies);
+    Kick(delta * 0.5);
+}
+
+static glm::dvec3 TwoBodyAcceleration(const glm::dvec3& position, double mu)
+{
+    double distanceSquared = glm::dot(position, position);
+    if (distanceSquared <= 0.0)
+        return glm::dvec3(0.0);
+    return -position * (mu / (distanceSquared * std::sqrt(distanceSquared)));
+}
+
+void TestParticles::KeplerStep(const glm::dvec3& centerBefore, const glm::dvec3& centerVelocityBefore,
+    const glm::dvec3& centerAfter, const glm::dvec3& centerVelocityAfter, double mu, double delta)
+{
+    uint32_t count = GetCount();
+    auto drift = [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            glm::dvec3 position = m_Positions[i] - centerBefore;
+            glm::dvec3 velocity = m_Velocities[i] - centerVelocityBefore;
+            if (!KeplerDrift(position, velocity, mu, delta))
+            {
+                // solver gave up on this orbit, kick drift kick in the same two body field instead
+                velocity += TwoBodyAcceleration(position, mu) * (delta * 0.5);
+                position += velocity * delta;
+                velocity += TwoBodyAcceleration(position, mu) * (delta * 0.5);
+            }
+            m_Positions[i] = centerAfter + position;
+            m_Velocities[i] = centerVelocityAfter + velocity;
+        }
+    };
+
+    if (m_ThreadPool && count > CHUNK_SIZE)
+    {
+        uint32_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        m_ThreadPool->ParallelFor(chunks, [&](uint32_t chunk)
+        {
+            drift(chunk * CHUNK_SIZE, std::min((chunk + 1) * CHUNK_SIZE, count));
+        });
+    }
+    else
+    {
+        drift(0, count);
+    }
+
+    m_AccelerationsValid = false;
+}
+
+void TestParticles::Kick(double delta)
+{
+    for (uint32_t i = 0; i < GetCount(); i++)
+        m_Velocities[i] += m_Accelerations[i] * delta;
+}
+
+void TestParticles::ComputeAccelerations(const BodyStore& bodies)
+{
+    auto& positions = bodies.GetPositions();
+    auto& masses = bodies.GetMasses();
+    auto& radii = bodies.GetRadii();
+
+    // only bodies that actually pull, massless ones in the store would just burn cycles
+    m_SourcePositions.clear();
+    m_SourceMasses.clear();
+    m_SourceRadiiSquared.clear();
+    for (uint32_t i = 0; i < bodies.GetCount(); i++)
+    {
+        if (masses[i] <= 0.0)
+            continue;
+        m_SourcePositions.push_back(positions[i]);
+        m_SourceMasses.push_back(masses[i] * GRAVITATIONAL_CONSTANT);
+        m_SourceRadiiSquared.push_back(radii[i] * radii[i]);
+    }
+    m_SourceCount = bodies.GetCount();
+    m_AccelerationsValid = true;
+
+    uint32_t count = GetCount();
+    if (m_ThreadPool && count > CHUNK_SIZE)
+    {
+        uint32_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        m_ThreadPool->ParallelFor(chunks, [&](uint32_t chunk)
+        {
+            ComputeChunk(chunk * CHUNK_SIZE, std::min((chunk + 1) * CHUNK_SIZE, count));
+        });
+    }
+    else
+    {
+        ComputeChunk(0, count);
+    }
+
+    m_HasAbsorbed = std::find(m_Absorbed.begin(), m_Absorbed.end(), 1) != m_Absorbed.end();
+}
+
+void TestParticles::ComputeChunk(uint32_t begin, uint32_t end)
+{
+    uint32_t sourceCount = (uint32_t)m_SourcePositions.size();
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const glm::dvec3& position = m_Positions[i];
+        glm::dvec3 acceleration{0.0};
+        uint8_t absorbed = 0;
+        for (uint32_t j = 0; j < sourceCount; j++)
+        {
+            glm::dvec3 offset = m_SourcePositions[j] - position;
+            double distanceSquared = glm::dot(offset, offset);
+            if (distanceSquared <= m_SourceRadiiSquared[j])
+            {
+                // inside the body, pulling it further would only blow up the velocity
+                absorbed = 1;
+                continue;
+            }
+            double inverseDistance = 1.0 / std::sqrt(distanceSquared);
+            acceleration += offset * (m_SourceMasses[j] * inverseDistance * inverseDistance * inverseDistance);
+        }
+        m_Accelerations[i] = acceleration;
+        m_Absorbed[i] = absorbed;
+    }
+}
+
+uint32_t TestParticles::RemoveAbsorbed()
+{
+    if (!m_HasAbsorbed)
+        return 0;
+
+    uint32_t removed = 0;
+    uint32_t i = 0;
+    while (i < GetCount())
+    {
+        if (!m_Absorbed[i])
+        {
+            i++;
+            continue;
+        }
+
+        m_Positions[i] = m_Positions.back();
+        m_Velocities[i] = m_Velocities.back();
+        m_Accelerations[i] = m_Accelerations.back();
+        m_Absorbed[i] = m_Absorbed.back();
+        m_Positions.pop_back();
+        m_Velocities.pop_back();
+        m_Accelerations.pop_back();
+        m_Absorbed.pop_back();
+        removed++;
+    }
+
+    m_HasAbsorbed = false;
+    return removed;
+}
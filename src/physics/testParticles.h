@@ -0,0 +1,73 @@
+#pragma once
+
+#include "bodyStore.h"
+#include "threadPool.h"
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Massless bodies that feel gravity of everything in BodyStore but pull on nothing,
+ * cost is O(N_massive * N_particles) instead of O(N^2). Meant for asteroid belts and debris fields.
+ * @note Only positions and velocities are kept, there is no Object, mesh or texture per particle.
+ * Removing a particle moves the last one into its place, indices are not stable.
+ */
+class TestParticles
+{
+public:
+    void Add(const glm::dvec3& position, const glm::dvec3& velocity);
+    void Clear();
+    void Reserve(uint32_t count);
+    /**
+     * @brief New particles start at the origin at rest, meant for filling positions and velocities in bulk
+     */
+    void Resize(uint32_t count);
+
+    /**
+     * @brief Kick drift kick around the massive step, call Begin before the massive bodies move and
+     * End after they did. Accelerations from End are reused by the next Begin while the body count stays the same.
+     */
+    void BeginStep(const BodyStore& bodies, double delta);
+    void EndStep(const BodyStore& bodies, double delta);
+    /**
+     * @brief Two body jump around the dominant body for steps too long to kick, center state is taken
+     * before and after the massive step so particles follow it. A particle the Kepler solver fails on
+     * gets a kick drift kick step in the same field.
+     */
+    void KeplerStep(const glm::dvec3& centerBefore, const glm::dvec3& centerVelocityBefore,
+        const glm::dvec3& centerAfter, const glm::dvec3& centerVelocityAfter, double mu, double delta
+    );
+    /**
+     * @brief Drops particles that ended up inside a massive body during the last evaluation
+     */
+    uint32_t RemoveAbsorbed();
+    inline void Invalidate() { m_AccelerationsValid = false; }
+
+    inline void SetThreadPool(ThreadPool* threadPool) { m_ThreadPool = threadPool; }
+    inline uint32_t GetCount() const { return (uint32_t)m_Positions.size(); }
+    inline std::vector<glm::dvec3>& GetPositions() { return m_Positions; }
+    inline std::vector<glm::dvec3>& GetVelocities() { return m_Velocities; }
+    inline const std::vector<glm::dvec3>& GetPositions() const { return m_Positions; }
+    inline const std::vector<glm::dvec3>& GetVelocities() const { return m_Velocities; }
+private:
+    static constexpr uint32_t CHUNK_SIZE = 1024;
+
+    void ComputeAccelerations(const BodyStore& bodies);
+    void ComputeChunk(uint32_t begin, uint32_t end);
+    void Kick(double delta);
+
+    std::vector<glm::dvec3> m_Positions;
+    std::vector<glm::dvec3> m_Velocities;
+    std::vector<glm::dvec3> m_Accelerations;
+    std::vector<uint8_t> m_Absorbed;
+
+    // massive bodies repacked once per evaluation, G folded into masses
+    std::vector<glm::dvec3> m_SourcePositions;
+    std::vector<double> m_SourceMasses;
+    std::vector<double> m_SourceRadiiSquared;
+
+    ThreadPool* m_ThreadPool = nullptr;
+    uint32_t m_SourceCount = 0;
+    bool m_AccelerationsValid = false;
+    bool m_HasAbsorbed = false;
+};
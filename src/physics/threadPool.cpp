@@ -0,0 +1,105 @@
+#include "threadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    Start(threadCount);
+}
+
+ThreadPool::~ThreadPool()
+{
+    Stop();
+}
+
+void ThreadPool::Resize(uint32_t threadCount)
+{
+    if (std::max(threadCount, 1u) == GetThreadCount())
+        return;
+
+    Stop();
+    Start(threadCount);
+}
+
+void ThreadPool::Start(uint32_t threadCount)
+{
+    m_Quit = false;
+    threadCount = std::max(threadCount, 1u);
+    for (uint32_t i = 1; i < threadCount; i++)
+        m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, m_Generation);
+}
+
+void ThreadPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_WorkReady.notify_all();
+    for (std::thread& worker : m_Workers)
+        worker.join();
+    m_Workers.clear();
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task)
+{
+    if (count == 0)
+        return;
+
+    if (m_Workers.empty() || count == 1)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Task = &task;
+        m_TaskCount = count;
+        m_NextTask.store(0, std::memory_order_relaxed);
+        m_BusyWorkers = (uint32_t)m_Workers.size();
+        m_Generation++;
+    }
+    m_WorkReady.notify_all();
+
+    RunTasks();
+
+    // task lives on the caller's stack, every worker has to let go of it before returning
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_WorkDone.wait(lock, [this]() { return m_BusyWorkers == 0; });
+    m_Task = nullptr;
+}
+
+void ThreadPool::RunTasks()
+{
+    while (true)
+    {
+        uint32_t index = m_NextTask.fetch_add(1, std::memory_order_relaxed);
+        if (index >= m_TaskCount)
+            break;
+        (*m_Task)(index);
+    }
+}
+
+void ThreadPool::WorkerLoop(uint32_t seenGeneration)
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkReady.wait(lock, [&]() { return m_Quit || m_Generation != seenGeneration; });
+            if (m_Quit)
+                return;
+            seenGeneration = m_Generation;
+        }
+
+        RunTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_BusyWorkers--;
+        }
+        m_WorkDone.notify_one();
+    }
+}
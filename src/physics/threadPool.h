@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Fixed set of worker threads for data parallel loops. Calling thread takes part in
+ * the work too, so a pool of size 1 has no background threads and runs everything inline.
+ */
+class ThreadPool
+{
+public:
+    ThreadPool(uint32_t threadCount = 1);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Calls task(index) for every index in [0, count) spread across all threads,
+     * returns once every call finished. Acts as a barrier between consecutive calls.
+     */
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task);
+
+    void Resize(uint32_t threadCount);
+    inline uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size() + 1; }
+private:
+    void WorkerLoop(uint32_t seenGeneration);
+    void RunTasks();
+    void Start(uint32_t threadCount);
+    void Stop();
+
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkReady;
+    std::condition_variable m_WorkDone;
+
+    const std::function<void(uint32_t)>* m_Task = nullptr;
+    uint32_t m_TaskCount = 0;
+    std::atomic<uint32_t> m_NextTask{0};
+    uint32_t m_Generation = 0;
+    uint32_t m_BusyWorkers = 0;
+    bool m_Quit = false;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ * @brief Wall clock stopwatch, runs from construction or the last Reset
+ */
+class Timer
+{
+public:
+    Timer() : m_Start(Clock::now()) {}
+
+    inline void Reset() { m_Start = Clock::now(); }
+    inline double GetSeconds() const { return std::chrono::duration<double>(Clock::now() - m_Start).count(); }
+private:
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point m_Start;
+};
@@ -0,0 +1,485 @@
+#include "trajectory.h"
+#include "compression.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+static_assert(sizeof(glm::dvec3) == 3 * sizeof(uint64_t), "Frames are XORed as packed 64 bit words");
+
+namespace
+{
+    constexpr char MAGIC[8] = { 'G', 'R', 'A', 'V', 'T', 'R', 'A', 'J' };
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr uint32_t CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+    constexpr uint32_t INDEX_MAGIC = 0x58444954; // "TIDX"
+    constexpr uint32_t FLAG_COMPRESSED = 0x1;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t keyframeInterval;
+        uint32_t padding;
+        double cadence;
+    };
+
+    struct ChunkHeader
+    {
+        uint32_t magic;
+        uint32_t flags;
+        uint32_t frameCount;
+        uint32_t bodyCount;
+        double startTime;
+        double endTime;
+        double rotationTime;
+        uint64_t rawSize;
+        uint64_t payloadSize;
+        uint64_t checksum;
+    };
+
+    struct IndexFooter
+    {
+        uint64_t indexOffset;
+        uint32_t chunkCount;
+        uint32_t magic;
+    };
+
+    /**
+     * @brief Turns previous frame into the guess for the next one, p + (p - before) when there is a frame
+     * before it. Written without multiplication so it can't be contracted into FMA differently on the reading side.
+     */
+    void PredictFrame(std::vector<glm::dvec3>& previous, const std::vector<glm::dvec3>* before)
+    {
+        if (!before)
+            return;
+        for (size_t i = 0; i < previous.size(); i++)
+            previous[i] = previous[i] + (previous[i] - (*before)[i]);
+    }
+
+    template<typename T>
+    void Append(std::vector<uint8_t>& bytes, const std::vector<T>& values)
+    {
+        const uint8_t* begin = reinterpret_cast<const uint8_t*>(values.data());
+        bytes.insert(bytes.end(), begin, begin + values.size() * sizeof(T));
+    }
+
+    template<typename T>
+    void Take(const std::vector<uint8_t>& bytes, size_t& offset, std::vector<T>& values, size_t count)
+    {
+        values.resize(count);
+        if (count > 0)
+            std::memcpy(values.data(), bytes.data() + offset, count * sizeof(T));
+        offset += count * sizeof(T);
+    }
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    if (IsOpen())
+    {
+        try
+        {
+            Close();
+        }
+        catch (...)
+        {
+            // destructor can't report it, whatever chunks made it to disk are still readable
+        }
+    }
+}
+
+void TrajectoryRecorder::Open(const std::string& filepath, double cadence, uint32_t keyframeInterval)
+{
+    if (IsOpen())
+        Close();
+
+    m_File.open(filepath, std::ios::binary | std::ios::trunc);
+    if (!m_File.is_open())
+        throw std::runtime_error("Failed to create trajectory file " + filepath);
+
+    m_Filepath = filepath;
+    m_Cadence = std::max(cadence, 0.0);
+    m_KeyframeInterval = std::max(keyframeInterval, 2u);
+    m_NextTime = -std::numeric_limits<double>::infinity();
+    m_FrameCount = 0;
+    m_Index.clear();
+    m_Times.clear();
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = TRAJECTORY_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.keyframeInterval = m_KeyframeInterval;
+    header.cadence = m_Cadence;
+    m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_BytesWritten = sizeof(header);
+}
+
+void TrajectoryRecorder::Record(const BodyStore& bodies, double time)
+{
+    if (!IsOpen() || time < m_NextTime)
+        return;
+    m_NextTime = time + m_Cadence;
+
+    const std::vector<BodyHandle>& handles = bodies.GetHandles();
+    bool sameBodies = !m_Times.empty() && handles == m_Handles;
+    if (!sameBodies)
+    {
+        // merged or added bodies, nothing to interpolate across
+        if (!m_Times.empty())
+            FlushChunk();
+        BeginChunk(bodies, time);
+    }
+    else if (m_Times.size() >= m_KeyframeInterval)
+    {
+        double lastTime = m_Times.back();
+        std::vector<glm::dvec3> last = m_Previous;
+        FlushChunk();
+        BeginChunk(bodies, time);
+        AddFrame(last, lastTime);
+    }
+    AddFrame(bodies.GetPositions(), time);
+    m_FrameCount++;
+}
+
+void TrajectoryRecorder::Close()
+{
+    if (!IsOpen())
+        return;
+
+    if (!m_Times.empty())
+        FlushChunk();
+
+    IndexFooter footer{};
+    footer.indexOffset = m_BytesWritten;
+    footer.chunkCount = (uint32_t)m_Index.size();
+    footer.magic = INDEX_MAGIC;
+    std::vector<uint8_t> bytes;
+    Append(bytes, m_Index);
+    m_File.write(reinterpret_cast<const char*>(bytes.data()), (std::streamsize)bytes.size());
+    m_File.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    m_BytesWritten += bytes.size() + sizeof(footer);
+    bool good = m_File.good();
+    m_File.close();
+    if (!good)
+        throw std::runtime_error("Failed to write trajectory index " + m_Filepath);
+}
+
+void TrajectoryRecorder::BeginChunk(const BodyStore& bodies, double time)
+{
+    m_Times.clear();
+    m_Frames.clear();
+    m_Previous.clear();
+    m_BeforePrevious.clear();
+    m_Handles = bodies.GetHandles();
+    m_Masses = bodies.GetMasses();
+    m_Radii = bodies.GetRadii();
+    m_Rotations = bodies.GetRotations();
+    m_RotationSpeeds = bodies.GetRotationSpeeds();
+    m_RotationTime = time;
+}
+
+void TrajectoryRecorder::AddFrame(const std::vector<glm::dvec3>& positions, double time)
+{
+    size_t offset = m_Frames.size();
+    size_t words = positions.size() * 3;
+    m_Frames.resize(offset + words);
+    std::memcpy(m_Frames.data() + offset, positions.data(), words * sizeof(uint64_t));
+    if (!m_Times.empty())
+    {
+        // bits shared with the prediction cancel out, the better it guesses the more leading bytes are zero
+        std::vector<glm::dvec3> prediction = m_Previous;
+        PredictFrame(prediction, m_Times.size() > 1 ? &m_BeforePrevious : nullptr);
+        const uint64_t* predicted = reinterpret_cast<const uint64_t*>(prediction.data());
+        for (size_t i = 0; i < words; i++)
+            m_Frames[offset + i] ^= predicted[i];
+    }
+    std::swap(m_BeforePrevious, m_Previous);
+    m_Previous = positions;
+    m_Times.push_back(time);
+}
+
+void TrajectoryRecorder::FlushChunk()
+{
+    std::vector<uint8_t> raw;
+    Append(raw, m_Times);
+    Append(raw, m_Masses);
+    Append(raw, m_Radii);
+    Append(raw, m_Rotations);
+    Append(raw, m_RotationSpeeds);
+    Append(raw, m_Frames);
+    Append(raw, m_Handles);
+
+    ChunkHeader header{};
+    header.magic = CHUNK_MAGIC;
+    header.frameCount = (uint32_t)m_Times.size();
+    header.bodyCount = (uint32_t)m_Handles.size();
+    header.startTime = m_Times.front();
+    header.endTime = m_Times.back();
+    header.rotationTime = m_RotationTime;
+    header.rawSize = raw.size();
+    header.checksum = HashBytes(raw.data(), raw.size());
+
+    std::vector<uint8_t> compressed = CompressRuns(ShuffleBytes(raw.data(), raw.size()));
+    const std::vector<uint8_t>& payload = compressed.size() < raw.size() ? compressed : raw;
+    if (&payload == &compressed)
+        header.flags |= FLAG_COMPRESSED;
+    header.payloadSize = payload.size();
+
+    m_Index.push_back({header.startTime, header.endTime, m_BytesWritten});
+    m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_File.write(reinterpret_cast<const char*>(payload.data()), (std::streamsize)payload.size());
+    m_File.flush();
+    m_BytesWritten += sizeof(header) + payload.size();
+    m_Times.clear();
+
+    if (!m_File.good())
+    {
+        m_File.close();
+        throw std::runtime_error("Failed to write trajectory file " + m_Filepath);
+    }
+}
+
+void TrajectoryReader::Open(const std::string& filepath)
+{
+    Close();
+    m_File.open(filepath, std::ios::binary | std::ios::ate);
+    if (!m_File.is_open())
+        throw std::runtime_error("Failed to open trajectory file " + filepath);
+    m_Filepath = filepath;
+
+    uint64_t fileSize = (uint64_t)m_File.tellg();
+    FileHeader header{};
+    m_File.seekg(0);
+    if (fileSize < sizeof(header) || !m_File.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        Close();
+        throw std::runtime_error(filepath + " is not a trajectory recording");
+    }
+    if (header.byteOrder != BYTE_ORDER_MARK || header.version != TRAJECTORY_VERSION)
+    {
+        Close();
+        throw std::runtime_error(filepath + " has trajectory version " + std::to_string(header.version)
+            + " or byte order this build can't read");
+    }
+    m_Cadence = header.cadence;
+
+    // index is only trusted when it ends exactly at the end of the file
+    IndexFooter footer{};
+    if (fileSize >= sizeof(header) + sizeof(footer))
+    {
+        m_File.seekg(fileSize - sizeof(footer));
+        m_File.read(reinterpret_cast<char*>(&footer), sizeof(footer));
+    }
+    if (footer.magic == INDEX_MAGIC && footer.indexOffset + footer.chunkCount * sizeof(IndexEntry) + sizeof(footer) == fileSize)
+    {
+        m_Index.resize(footer.chunkCount);
+        m_File.seekg(footer.indexOffset);
+        m_File.read(reinterpret_cast<char*>(m_Index.data()), footer.chunkCount * sizeof(IndexEntry));
+    }
+    else
+    {
+        m_File.clear();
+        RebuildIndex();
+    }
+
+    if (m_Index.empty())
+    {
+        Close();
+        throw std::runtime_error(filepath + " has no recorded frames");
+    }
+}
+
+void TrajectoryReader::Close()
+{
+    if (m_File.is_open())
+        m_File.close();
+    m_File.clear();
+    m_Index.clear();
+    m_LoadedChunk = 0xFFFFFFFF;
+}
+
+/**
+ * @brief Walks chunk headers of a recording that was cut short, stops at the first one that doesn't fit
+ */
+void TrajectoryReader::RebuildIndex()
+{
+    m_File.seekg(0, std::ios::end);
+    uint64_t fileSize = (uint64_t)m_File.tellg();
+    uint64_t offset = sizeof(FileHeader);
+    while (offset + sizeof(ChunkHeader) <= fileSize)
+    {
+        ChunkHeader header{};
+        m_File.seekg(offset);
+        if (!m_File.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != CHUNK_MAGIC)
+            break;
+        if (offset + sizeof(header) + header.payloadSize > fileSize)
+            break;
+        m_Index.push_back({header.startTime, header.endTime, offset});
+        offset += sizeof(header) + header.payloadSize;
+    }
+    m_File.clear();
+}
+
+uint32_t TrajectoryReader::FindChunk(double time) const
+{
+    auto iter = std::upper_bound(m_Index.begin(), m_Index.end(), time,
+        [](double value, const IndexEntry& entry) { return value < entry.startTime; });
+    return iter == m_Index.begin() ? 0 : (uint32_t)(iter - m_Index.begin() - 1);
+}
+
+void TrajectoryReader::LoadChunk(uint32_t chunk)
+{
+    if (chunk == m_LoadedChunk)
+        return;
+
+    ChunkHeader header{};
+    m_File.seekg(m_Index[chunk].offset);
+    m_File.read(reinterpret_cast<char*>(&header), sizeof(header));
+    std::vector<uint8_t> payload(header.payloadSize);
+    m_File.read(reinterpret_cast<char*>(payload.data()), (std::streamsize)payload.size());
+    if (!m_File || header.magic != CHUNK_MAGIC)
+        throw std::runtime_error("Failed to read chunk " + std::to_string(chunk) + " of " + m_Filepath);
+
+    std::vector<uint8_t> raw;
+    if (header.flags & FLAG_COMPRESSED)
+    {
+        std::vector<uint8_t> unpacked = DecompressRuns(payload.data(), payload.size(), header.rawSize);
+        raw = UnshuffleBytes(unpacked.data(), unpacked.size());
+    }
+    else
+    {
+        raw = std::move(payload);
+    }
+
+    size_t frames = header.frameCount;
+    size_t bodies = header.bodyCount;
+    size_t expected = frames * sizeof(double) + bodies * (2 * sizeof(double) + 2 * sizeof(glm::dvec3) + sizeof(BodyHandle))
+        + frames * bodies * sizeof(glm::dvec3);
+    if (raw.size() != expected || header.rawSize != expected || HashBytes(raw.data(), raw.size()) != header.checksum)
+        throw std::runtime_error("Chunk " + std::to_string(chunk) + " of " + m_Filepath + " is damaged");
+
+    std::vector<uint64_t> words;
+    size_t offset = 0;
+    Take(raw, offset, m_Times, frames);
+    Take(raw, offset, m_Masses, bodies);
+    Take(raw, offset, m_Radii, bodies);
+    Take(raw, offset, m_Rotations, bodies);
+    Take(raw, offset, m_RotationSpeeds, bodies);
+    Take(raw, offset, words, frames * bodies * 3);
+    Take(raw, offset, m_Handles, bodies);
+
+    // same predictions as while recording, frame by frame from the decoded ones before
+    m_Positions.resize(frames * bodies);
+    if (!words.empty())
+        std::memcpy(m_Positions.data(), words.data(), bodies * sizeof(glm::dvec3));
+    std::vector<glm::dvec3> previous, before;
+    for (size_t frame = 1; frame < frames; frame++)
+    {
+        previous.assign(m_Positions.begin() + (frame - 1) * bodies, m_Positions.begin() + frame * bodies);
+        if (frame > 1)
+            before.assign(m_Positions.begin() + (frame - 2) * bodies, m_Positions.begin() + (frame - 1) * bodies);
+        PredictFrame(previous, frame > 1 ? &before : nullptr);
+
+        const uint64_t* predicted = reinterpret_cast<const uint64_t*>(previous.data());
+        uint64_t* decoded = words.data() + frame * bodies * 3;
+        for (size_t i = 0; i < bodies * 3; i++)
+            decoded[i] ^= predicted[i];
+        std::memcpy(m_Positions.data() + frame * bodies, decoded, bodies * sizeof(glm::dvec3));
+    }
+
+    m_BodyCount = (uint32_t)bodies;
+    m_RotationTime = header.rotationTime;
+    m_LoadedChunk = chunk;
+}
+
+TrajectoryReader::Stencil TrajectoryReader::ComputeStencil(double time) const
+{
+    // bodies changed between chunks, hold the last frame instead of extrapolating
+    uint32_t frames = (uint32_t)m_Times.size();
+    time = std::clamp(time, m_Times.front(), m_Times.back());
+    uint32_t frame = (uint32_t)(std::upper_bound(m_Times.begin(), m_Times.end(), time) - m_Times.begin());
+    frame = frame > 0 ? frame - 1 : 0;
+
+    Stencil stencil{};
+    stencil.count = std::min(frames, 4u);
+    stencil.first = (uint32_t)std::clamp((int)frame - 1, 0, (int)(frames - stencil.count));
+    const double* times = m_Times.data() + stencil.first;
+    for (uint32_t j = 0; j < stencil.count; j++)
+    {
+        double weight = 1.0;
+        double derivative = 0.0;
+        for (uint32_t k = 0; k < stencil.count; k++)
+        {
+            if (k == j)
+                continue;
+            double term = 1.0 / (times[j] - times[k]);
+            // derivative of the product, one factor differentiated at a time
+            double product = term;
+            for (uint32_t m = 0; m < stencil.count; m++)
+            {
+                if (m != j && m != k)
+                    product *= (time - times[m]) / (times[j] - times[m]);
+            }
+            derivative += product;
+            weight *= (time - times[k]) * term;
+        }
+        stencil.position[j] = weight;
+        stencil.velocity[j] = derivative;
+    }
+    return stencil;
+}
+
+void TrajectoryReader::Sample(double time, BodyStore& bodies)
+{
+    time = std::clamp(time, GetStartTime(), GetEndTime());
+    LoadChunk(FindChunk(time));
+    Stencil stencil = ComputeStencil(time);
+
+    uint32_t count = m_BodyCount;
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& rotations = bodies.GetRotations();
+    positions.resize(count);
+    velocities.resize(count);
+    rotations.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        glm::dvec3 position{0.0}, velocity{0.0};
+        for (uint32_t j = 0; j < stencil.count; j++)
+        {
+            const glm::dvec3& frame = m_Positions[(size_t)(stencil.first + j) * count + i];
+            position += frame * stencil.position[j];
+            velocity += frame * stencil.velocity[j];
+        }
+        positions[i] = position;
+        velocities[i] = velocity;
+        rotations[i] = m_Rotations[i] + m_RotationSpeeds[i] * (time - m_RotationTime);
+    }
+    bodies.GetMasses() = m_Masses;
+    bodies.GetRadii() = m_Radii;
+    bodies.GetRotationSpeeds() = m_RotationSpeeds;
+
+    // generations are whatever they were while recording
+    bodies.RestoreSlots(m_Handles);
+}
+
+std::vector<double> TrajectoryReader::GetFrameTimes()
+{
+    std::vector<double> times;
+    for (uint32_t chunk = 0; chunk < (uint32_t)m_Index.size(); chunk++)
+    {
+        LoadChunk(chunk);
+        for (double time : m_Times)
+        {
+            // chunks share their boundary frame
+            if (times.empty() || time > times.back())
+                times.push_back(time);
+        }
+    }
+    return times;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "bodyStore.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+#define TRAJECTORY_VERSION 1
+
+/**
+ * @brief Body positions recorded at a fixed cadence of simulation time, for replaying a run without
+ * integrating it again.
+ *
+ * Frames are grouped into chunks of at most keyframeInterval frames. The first frame of a chunk is
+ * stored as is, later ones as the XOR of their bits with a linear extrapolation of the two frames before.
+ * Sign, exponent and leading mantissa bytes of that XOR are zero, so after shuffling and run length
+ * encoding a chunk shrinks the more the finer the cadence is. Masses, radii and spins are stored once
+ * per chunk, rotation grows linearly with time so it needs no frames. A chunk ends early when bodies
+ * merge or get added, and chunks share their boundary frame so playback can interpolate across them.
+ *
+ * An index of chunk start times and file offsets is appended on Close, seeking is a binary search on
+ * it plus decoding a single chunk. A recording that was never closed is still readable, its index is
+ * rebuilt by walking the chunks.
+ */
+class TrajectoryRecorder
+{
+public:
+    ~TrajectoryRecorder();
+
+    /**
+     * @brief Starts a new file, cadence is simulation seconds between frames
+     * @throws std::runtime_error when the file can't be created
+     */
+    void Open(const std::string& filepath, double cadence, uint32_t keyframeInterval = 64);
+    /**
+     * @brief Records a frame once cadence passed since the last one, cheap to call every step
+     * @throws std::runtime_error when writing fails, recording is closed then
+     */
+    void Record(const BodyStore& bodies, double time);
+    /**
+     * @brief Writes the last chunk and the index
+     */
+    void Close();
+
+    inline bool IsOpen() const { return m_File.is_open(); }
+    inline uint64_t GetFrameCount() const { return m_FrameCount; }
+    inline uint64_t GetBytesWritten() const { return m_BytesWritten; }
+private:
+    void BeginChunk(const BodyStore& bodies, double time);
+    void AddFrame(const std::vector<glm::dvec3>& positions, double time);
+    void FlushChunk();
+
+    struct IndexEntry
+    {
+        double startTime;
+        double endTime;
+        uint64_t offset;
+    };
+
+    std::ofstream m_File;
+    std::string m_Filepath;
+    double m_Cadence = 0.0;
+    uint32_t m_KeyframeInterval = 64;
+    double m_NextTime = 0.0;
+    uint64_t m_FrameCount = 0;
+    uint64_t m_BytesWritten = 0;
+    std::vector<IndexEntry> m_Index;
+
+    // chunk being built
+    std::vector<double> m_Times;
+    std::vector<uint64_t> m_Frames; // first frame raw bits, later ones XOR with the prediction
+    std::vector<glm::dvec3> m_Previous;
+    std::vector<glm::dvec3> m_BeforePrevious;
+    std::vector<BodyHandle> m_Handles;
+    std::vector<double> m_Masses;
+    std::vector<double> m_Radii;
+    std::vector<glm::dvec3> m_Rotations;
+    std::vector<glm::dvec3> m_RotationSpeeds;
+    double m_RotationTime = 0.0; // rotations above are at this time
+};
+
+/**
+ * @brief Seekable playback of a TrajectoryRecorder file, any time inside the recording can be sampled
+ * in any order. The last decoded chunk is kept, so playing forwards decodes each chunk once.
+ */
+class TrajectoryReader
+{
+public:
+    /**
+     * @throws std::runtime_error when the file can't be opened or isn't a recording
+     */
+    void Open(const std::string& filepath);
+    void Close();
+
+    /**
+     * @brief State at time, clamped to the recording. Positions and velocities come from a cubic through
+     * the four frames around time, recorded frames are returned exactly. Handles are the ones bodies had
+     * while recording.
+     */
+    void Sample(double time, BodyStore& bodies);
+    /**
+     * @brief Times of every recorded frame in increasing order, decodes the whole recording once
+     */
+    std::vector<double> GetFrameTimes();
+
+    inline bool IsOpen() const { return m_File.is_open(); }
+    inline double GetStartTime() const { return m_Index.empty() ? 0.0 : m_Index.front().startTime; }
+    inline double GetEndTime() const { return m_Index.empty() ? 0.0 : m_Index.back().endTime; }
+    inline double GetCadence() const { return m_Cadence; }
+private:
+    struct IndexEntry
+    {
+        double startTime;
+        double endTime;
+        uint64_t offset;
+    };
+
+    uint32_t FindChunk(double time) const;
+    void LoadChunk(uint32_t chunk);
+    void RebuildIndex();
+    // up to four frames of the loaded chunk around time with Lagrange weights for position and velocity
+    struct Stencil
+    {
+        uint32_t first;
+        uint32_t count;
+        double position[4];
+        double velocity[4];
+    };
+
+    Stencil ComputeStencil(double time) const;
+
+    std::ifstream m_File;
+    std::string m_Filepath;
+    double m_Cadence = 0.0;
+    std::vector<IndexEntry> m_Index;
+
+    // decoded chunk, positions are frame after frame
+    uint32_t m_LoadedChunk = 0xFFFFFFFF;
+    uint32_t m_BodyCount = 0;
+    std::vector<double> m_Times;
+    std::vector<glm::dvec3> m_Positions;
+    std::vector<BodyHandle> m_Handles;
+    std::vector<double> m_Masses;
+    std::vector<double> m_Radii;
+    std::vector<glm::dvec3> m_Rotations;
+    std::vector<glm::dvec3> m_RotationSpeeds;
+    double m_RotationTime = 0.0;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Lock free single producer single consumer exchange of whole values. Writer and reader each
+ * own one slot, the third one sits in the middle and is swapped atomically, so neither side ever
+ * waits and the reader always gets the newest finished value. Values in between may be skipped.
+ * @note Slots are reused, writer has to overwrite everything it publishes.
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+    inline T& GetWriteBuffer() { return m_Buffers[m_WriteIndex]; }
+    inline T& GetReadBuffer() { return m_Buffers[m_ReadIndex]; }
+
+    /**
+     * @brief Hands the write slot over to the reader, writer continues with whatever was in the middle
+     */
+    void Publish()
+    {
+        uint8_t previous = m_Middle.exchange(m_WriteIndex | FRESH_BIT, std::memory_order_acq_rel);
+        m_WriteIndex = previous & INDEX_MASK;
+    }
+
+    /**
+     * @brief Takes the newest published value if there is one
+     * @return false when nothing was published since the last call, read slot stays the same
+     */
+    bool Acquire()
+    {
+        if (!(m_Middle.load(std::memory_order_relaxed) & FRESH_BIT))
+            return false;
+
+        uint8_t previous = m_Middle.exchange(m_ReadIndex, std::memory_order_acq_rel);
+        m_ReadIndex = previous & INDEX_MASK;
+        return true;
+    }
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH_BIT = 0x4;
+
+    T m_Buffers[3];
+    uint8_t m_WriteIndex = 0;
+    std::atomic<uint8_t> m_Middle{1};
+    uint8_t m_ReadIndex = 2;
+};
@@ -0,0 +1,479 @@
+#include "wisdomHolmanIntegrator.h"
+#include "kepler.h"
+
+#include <cmath>
+#include <algorithm>
+
+#define WISDOM_HOLMAN_SATELLITE_HILL_RADII 0.5 // satellites further out are perturbed too much by the central body to nest
+
+WisdomHolmanIntegrator::WisdomHolmanIntegrator(double encounterHillRadii)
+    : m_EncounterHillRadii(encounterHillRadii)
+{
+
+}
+
+void WisdomHolmanIntegrator::Reset()
+{
+    m_AccelerationsValid = false;
+    m_FallbackActive = false;
+    m_Primaries.clear();
+    m_Fallback.Reset();
+}
+
+/**
+ * @brief Whether the fallback took the last step, then accelerations for the next first kick with the
+ * satellite assignment they were computed for, then state of the fallback. Accelerations are computed
+ * at heliocentric positions that don't survive the round trip through barycentric ones exactly.
+ */
+void WisdomHolmanIntegrator::SaveState(std::vector<double>& state) const
+{
+    bool accelerationsSaved = m_AccelerationsValid && !m_FallbackActive;
+    state.push_back(m_FallbackActive ? 1.0 : 0.0);
+    state.push_back(accelerationsSaved ? 1.0 : 0.0);
+    if (accelerationsSaved)
+    {
+        for (size_t i = 0; i < m_Accelerations.size(); i++)
+        {
+            double primary = m_Primaries[i] == NO_PRIMARY ? -1.0 : (double)m_Primaries[i];
+            state.insert(state.end(), { m_Accelerations[i].x, m_Accelerations[i].y, m_Accelerations[i].z, primary });
+        }
+    }
+    if (m_FallbackActive)
+        m_Fallback.SaveState(state);
+}
+
+bool WisdomHolmanIntegrator::LoadState(const std::vector<double>& state, uint32_t bodyCount)
+{
+    Reset();
+    if (state.size() < 2)
+        return state.empty();
+
+    bool fallbackActive = state[0] != 0.0;
+    bool accelerationsSaved = state[1] != 0.0;
+    size_t accelerationsEnd = 2 + (accelerationsSaved ? 4 * (size_t)bodyCount : 0);
+    if (state.size() < accelerationsEnd || (fallbackActive && accelerationsSaved))
+        return false;
+
+    std::vector<double> fallbackState(state.begin() + accelerationsEnd, state.end());
+    if (fallbackActive != !fallbackState.empty() || !m_Fallback.LoadState(fallbackState, bodyCount))
+    {
+        Reset();
+        return false;
+    }
+
+    if (accelerationsSaved)
+    {
+        m_Accelerations.resize(bodyCount);
+        m_Primaries.resize(bodyCount);
+        const double* value = state.data() + 2;
+        for (uint32_t i = 0; i < bodyCount; i++, value += 4)
+        {
+            if (value[3] >= (double)bodyCount)
+            {
+                Reset();
+                return false;
+            }
+            m_Accelerations[i] = {value[0], value[1], value[2]};
+            m_Primaries[i] = value[3] < 0.0 ? NO_PRIMARY : (uint32_t)value[3];
+        }
+        m_AccelerationsValid = true;
+    }
+    m_FallbackActive = fallbackActive;
+    return true;
+}
+
+/**
+ * @brief Kick, jump, Kepler drift, jump, kick. Converts to democratic heliocentric
+ * coordinates and back every step so the BodyStore always holds barycentric state.
+ */
+void WisdomHolmanIntegrator::Step(BodyStore& bodies, GravitySolver& solver, double delta)
+{
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    uint32_t count = bodies.GetCount();
+    if (count < 2)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            positions[i] += velocities[i] * delta;
+        return;
+    }
+
+    uint32_t central = FindCentralBody(bodies);
+    if (FindSatellites(bodies, central))
+        m_AccelerationsValid = false;
+    if (DetectEncounter(bodies, central, delta))
+    {
+        m_EncounterSteps++;
+        m_FallbackActive = true;
+        m_AccelerationsValid = false;
+        m_Fallback.SetThreadPool(m_ThreadPool);
+        m_Fallback.Step(bodies, solver, delta);
+        return;
+    }
+    // Hermite keeps derivatives from its last step, they are stale once we move bodies here
+    m_Fallback.Reset();
+    m_FallbackActive = false;
+
+    double totalMass = 0.0;
+    glm::dvec3 centerOfMass{0.0};
+    glm::dvec3 centerOfMassVelocity{0.0};
+    for (uint32_t i = 0; i < count; i++)
+    {
+        totalMass += masses[i];
+        centerOfMass += positions[i] * masses[i];
+        centerOfMassVelocity += velocities[i] * masses[i];
+    }
+    centerOfMass /= totalMass;
+    centerOfMassVelocity /= totalMass;
+
+    m_Positions.resize(count);
+    m_Velocities.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_Positions[i] = positions[i] - positions[central];
+        m_Velocities[i] = velocities[i] - centerOfMassVelocity;
+    }
+    m_Positions[central] = glm::dvec3(0.0);
+    m_Velocities[central] = glm::dvec3(0.0);
+
+    // central body doesn't take part in interaction kicks, its pull is in the Kepler part
+    m_InteractionMasses.assign(masses.begin(), masses.end());
+    m_InteractionMasses[central] = 0.0;
+    if (m_Accelerations.size() != count)
+        m_AccelerationsValid = false;
+
+    double mu = GRAVITATIONAL_CONSTANT * masses[central];
+    Kick(solver, mu, central, delta * 0.5);
+    Jump(masses, central, delta * 0.5);
+    if (!Drift(masses, central, delta))
+    {
+        // only the scratch copies moved so far, the fallback takes the step from where it started
+        m_EncounterSteps++;
+        m_FallbackActive = true;
+        m_AccelerationsValid = false;
+        m_Fallback.SetThreadPool(m_ThreadPool);
+        m_Fallback.Step(bodies, solver, delta);
+        return;
+    }
+    Jump(masses, central, delta * 0.5);
+    m_AccelerationsValid = false;
+    Kick(solver, mu, central, delta * 0.5);
+
+    // back to barycentric, center of mass moves in a straight line
+    centerOfMass += centerOfMassVelocity * delta;
+    glm::dvec3 weightedPosition{0.0};
+    glm::dvec3 weightedVelocity{0.0};
+    for (uint32_t i = 0; i < count; i++)
+    {
+        weightedPosition += m_Positions[i] * masses[i];
+        weightedVelocity += m_Velocities[i] * masses[i];
+    }
+    glm::dvec3 centralPosition = centerOfMass - weightedPosition / totalMass;
+    glm::dvec3 centralVelocity = centerOfMassVelocity - weightedVelocity / masses[central];
+    for (uint32_t i = 0; i < count; i++)
+    {
+        positions[i] = centralPosition + m_Positions[i];
+        velocities[i] = centerOfMassVelocity + m_Velocities[i];
+    }
+    velocities[central] = centralVelocity;
+}
+
+uint32_t WisdomHolmanIntegrator::FindCentralBody(const BodyStore& bodies) const
+{
+    auto& masses = bodies.GetMasses();
+    return (uint32_t)(std::max_element(masses.begin(), masses.end()) - masses.begin());
+}
+
+/**
+ * @brief Assigns every body bound to a heavier non central body, well inside its Hill sphere,
+ * to that body. Only one level deep, satellites of satellites stay with the central body.
+ * @return true when the assignment changed since the last step
+ */
+bool WisdomHolmanIntegrator::FindSatellites(const BodyStore& bodies, uint32_t central)
+{
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    uint32_t count = bodies.GetCount();
+
+    std::vector<uint32_t> previous = std::move(m_Primaries);
+    m_Primaries.assign(count, NO_PRIMARY);
+    m_HillRadii.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+        m_HillRadii[i] = glm::length(positions[i] - positions[central]) * std::cbrt(masses[i] / (3.0 * masses[central]));
+
+    for (uint32_t s = 0; s < count; s++)
+    {
+        if (s == central)
+            continue;
+
+        for (uint32_t p = 0; p < count; p++)
+        {
+            if (p == central || masses[p] <= masses[s])
+                continue;
+            if (m_Primaries[s] != NO_PRIMARY && masses[p] <= masses[m_Primaries[s]])
+                continue;
+
+            double distance = glm::length(positions[s] - positions[p]);
+            if (distance > WISDOM_HOLMAN_SATELLITE_HILL_RADII * m_HillRadii[p])
+                continue;
+
+            glm::dvec3 relativeVelocity = velocities[s] - velocities[p];
+            double energy = 0.5 * glm::dot(relativeVelocity, relativeVelocity) - GRAVITATIONAL_CONSTANT * (masses[p] + masses[s]) / distance;
+            if (energy < 0.0)
+                m_Primaries[s] = p;
+        }
+    }
+
+    m_Satellites.clear();
+    m_SatelliteCounts.assign(count, 0);
+    for (uint32_t s = 0; s < count; s++)
+    {
+        uint32_t primary = m_Primaries[s];
+        if (primary == NO_PRIMARY)
+            continue;
+        if (m_Primaries[primary] != NO_PRIMARY)
+        {
+            m_Primaries[s] = NO_PRIMARY;
+            continue;
+        }
+        m_Satellites.push_back(s);
+        m_SatelliteCounts[primary]++;
+        m_HillRadii[s] = glm::length(positions[s] - positions[primary]) * std::cbrt(masses[s] / (3.0 * masses[primary]));
+    }
+    return m_Primaries != previous;
+}
+
+/**
+ * @brief True when some pair will come within the switching radius during the step,
+ * or some body will get within a few radii of the central body or its primary.
+ * Satellites are expected to stay close to their primary and don't count as encounters.
+ */
+bool WisdomHolmanIntegrator::DetectEncounter(const BodyStore& bodies, uint32_t central, double delta)
+{
+    auto& positions = bodies.GetPositions();
+    auto& velocities = bodies.GetVelocities();
+    auto& masses = bodies.GetMasses();
+    auto& radii = bodies.GetRadii();
+    uint32_t count = bodies.GetCount();
+
+    for (uint32_t a = 0; a < count; a++)
+    {
+        if (a == central)
+            continue;
+
+        glm::dvec3 offset = positions[a] - positions[central];
+        double reach = glm::length(velocities[a] - velocities[central]) * delta;
+        if (glm::length(offset) - reach < 3.0 * (radii[central] + radii[a]))
+            return true;
+
+        // a satellite goes around many times in a long step, its periapsis is what gets closest
+        uint32_t primary = m_Primaries[a];
+        if (primary != NO_PRIMARY)
+        {
+            glm::dvec3 relativePosition = positions[a] - positions[primary];
+            glm::dvec3 relativeVelocity = velocities[a] - velocities[primary];
+            double mu = GRAVITATIONAL_CONSTANT * (masses[primary] + masses[a]);
+            double energy = 0.5 * glm::dot(relativeVelocity, relativeVelocity) - mu / glm::length(relativePosition);
+            glm::dvec3 angularMomentum = glm::cross(relativePosition, relativeVelocity);
+            double semiLatusRectum = glm::dot(angularMomentum, angularMomentum) / mu;
+            double eccentricity = std::sqrt(std::max(0.0, 1.0 + 2.0 * energy * semiLatusRectum / mu));
+            if (semiLatusRectum / (1.0 + eccentricity) < 3.0 * (radii[primary] + radii[a]))
+                return true;
+        }
+
+        for (uint32_t b = a + 1; b < count; b++)
+        {
+            if (b == central || primary == b || m_Primaries[b] == a)
+                continue;
+
+            double switchRadius = m_EncounterHillRadii * std::max(m_HillRadii[a], m_HillRadii[b]);
+            double distance = glm::length(positions[a] - positions[b]);
+            double approach = glm::length(velocities[a] - velocities[b]) * delta;
+            if (distance - approach < switchRadius)
+                return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Mass, heliocentric position and barycentric velocity of every body together with
+ * its satellites, bodies without any are their own system
+ */
+void WisdomHolmanIntegrator::ComputeBarycenters(const std::vector<double>& masses, uint32_t central)
+{
+    uint32_t count = (uint32_t)m_Positions.size();
+    m_SystemMasses.resize(count);
+    m_SystemPositions.resize(count);
+    m_SystemVelocities.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_SystemMasses[i] = masses[i];
+        m_SystemPositions[i] = m_Positions[i] * masses[i];
+        m_SystemVelocities[i] = m_Velocities[i] * masses[i];
+    }
+    for (uint32_t s : m_Satellites)
+    {
+        uint32_t primary = m_Primaries[s];
+        m_SystemMasses[primary] += masses[s];
+        m_SystemPositions[primary] += m_Positions[s] * masses[s];
+        m_SystemVelocities[primary] += m_Velocities[s] * masses[s];
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (i == central || m_Primaries[i] != NO_PRIMARY)
+            continue;
+        m_SystemPositions[i] /= m_SystemMasses[i];
+        m_SystemVelocities[i] /= m_SystemMasses[i];
+    }
+}
+
+/**
+ * @brief Mutual pull between non central bodies, computed by the active solver with the
+ * central mass zeroed out. A satellite and its primary don't pull each other here, that's
+ * in their Kepler orbit, instead both get the central body's tide across their system.
+ * End of step accelerations are reused by the next first kick.
+ */
+void WisdomHolmanIntegrator::Kick(GravitySolver& solver, double centralMu, uint32_t central, double delta)
+{
+    if (!m_AccelerationsValid)
+    {
+        solver.ComputeAccelerations(m_Positions, m_InteractionMasses, m_Accelerations);
+        if (!m_Satellites.empty())
+        {
+            ComputeBarycenters(m_InteractionMasses, central);
+            for (uint32_t s : m_Satellites)
+            {
+                uint32_t primary = m_Primaries[s];
+                glm::dvec3 offset = m_Positions[primary] - m_Positions[s];
+                double distance = glm::length(offset);
+                glm::dvec3 pull = offset * (GRAVITATIONAL_CONSTANT / (distance * distance * distance));
+                m_Accelerations[s] -= pull * m_InteractionMasses[primary];
+                m_Accelerations[primary] += pull * m_InteractionMasses[s];
+            }
+            for (uint32_t i = 0; i < (uint32_t)m_Positions.size(); i++)
+            {
+                uint32_t system = m_Primaries[i] == NO_PRIMARY ? i : m_Primaries[i];
+                if (i == central || m_SatelliteCounts[system] == 0)
+                    continue;
+
+                double distance = glm::length(m_Positions[i]);
+                double systemDistance = glm::length(m_SystemPositions[system]);
+                m_Accelerations[i] += centralMu * (m_SystemPositions[system] / (systemDistance * systemDistance * systemDistance)
+                    - m_Positions[i] / (distance * distance * distance));
+            }
+        }
+        m_AccelerationsValid = true;
+    }
+
+    for (uint32_t i = 0; i < (uint32_t)m_Velocities.size(); i++)
+    {
+        if (i != central)
+            m_Velocities[i] += m_Accelerations[i] * delta;
+    }
+}
+
+/**
+ * @brief Linear drift of heliocentric positions by total barycentric momentum over central mass,
+ * then of satellites relative to their primary by the momentum of the satellites over its mass
+ */
+void WisdomHolmanIntegrator::Jump(const std::vector<double>& masses, uint32_t central, double delta)
+{
+    glm::dvec3 momentum{0.0};
+    for (uint32_t i = 0; i < (uint32_t)m_Velocities.size(); i++)
+        momentum += m_Velocities[i] * masses[i];
+
+    glm::dvec3 shift = momentum * (delta / masses[central]);
+    for (uint32_t i = 0; i < (uint32_t)m_Positions.size(); i++)
+    {
+        if (i != central)
+            m_Positions[i] += shift;
+    }
+
+    if (m_Satellites.empty())
+        return;
+
+    // satellites shift against their primary by their momentum over its mass, which is the primary's
+    // velocity relative to the system barycenter, and the system barycenter stays in place
+    ComputeBarycenters(masses, central);
+    for (uint32_t s : m_Satellites)
+    {
+        uint32_t primary = m_Primaries[s];
+        glm::dvec3 relativeShift = (m_SystemVelocities[primary] - m_Velocities[primary]) * delta;
+        m_Positions[s] += relativeShift * (masses[primary] / m_SystemMasses[primary]);
+    }
+    for (uint32_t i = 0; i < (uint32_t)m_Positions.size(); i++)
+    {
+        if (m_SatelliteCounts[i] == 0)
+            continue;
+        glm::dvec3 relativeShift = (m_SystemVelocities[i] - m_Velocities[i]) * delta;
+        m_Positions[i] -= relativeShift * (1.0 - masses[i] / m_SystemMasses[i]);
+    }
+}
+
+/**
+ * @brief Kepler orbits, of systems around the central body and of satellites around their primary
+ * @return false when the Kepler solver didn't converge for one of them, the scratch state is then unusable
+ */
+bool WisdomHolmanIntegrator::Drift(const std::vector<double>& masses, uint32_t central, double delta)
+{
+    double mu = GRAVITATIONAL_CONSTANT * masses[central];
+    uint32_t count = (uint32_t)m_Positions.size();
+    if (m_Satellites.empty())
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (i != central && !KeplerDrift(m_Positions[i], m_Velocities[i], mu, delta))
+                return false;
+        }
+        return true;
+    }
+
+    ComputeBarycenters(masses, central);
+    // satellites relative to their primary, velocities relative to the system barycenter
+    for (uint32_t s : m_Satellites)
+    {
+        uint32_t primary = m_Primaries[s];
+        m_Positions[s] -= m_Positions[primary];
+        m_Velocities[s] -= m_SystemVelocities[primary];
+        if (!KeplerDrift(m_Positions[s], m_Velocities[s], GRAVITATIONAL_CONSTANT * masses[primary], delta))
+            return false;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (i == central || m_Primaries[i] != NO_PRIMARY)
+            continue;
+        if (m_SatelliteCounts[i] == 0)
+        {
+            if (!KeplerDrift(m_Positions[i], m_Velocities[i], mu, delta))
+                return false;
+            continue;
+        }
+        if (!KeplerDrift(m_SystemPositions[i], m_SystemVelocities[i], mu, delta))
+            return false;
+        m_Positions[i] = m_SystemPositions[i];
+        m_Velocities[i] = m_SystemVelocities[i] * m_SystemMasses[i];
+    }
+
+    // primary goes where it keeps the barycenter, with whatever momentum the satellites don't carry
+    for (uint32_t s : m_Satellites)
+    {
+        uint32_t primary = m_Primaries[s];
+        m_Positions[primary] -= m_Positions[s] * (masses[s] / m_SystemMasses[primary]);
+        m_Velocities[primary] -= (m_Velocities[s] + m_SystemVelocities[primary]) * masses[s];
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (m_SatelliteCounts[i] != 0)
+            m_Velocities[i] /= masses[i];
+    }
+    for (uint32_t s : m_Satellites)
+    {
+        uint32_t primary = m_Primaries[s];
+        m_Positions[s] += m_Positions[primary];
+        m_Velocities[s] += m_SystemVelocities[primary];
+    }
+    return true;
+}
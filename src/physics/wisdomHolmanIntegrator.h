@@ -0,0 +1,61 @@
+#pragma once
+
+#include "integrator.h"
+
+/**
+ * @brief Wisdom-Holman mapping in democratic heliocentric coordinates. The most massive
+ * body is the central one, everyone else follows an exact Kepler orbit around it and
+ * mutual interactions between them are applied as kicks, so steps can be a sizeable
+ * fraction of the innermost orbital period.
+ * Bound satellites deep inside the Hill sphere of a heavier body (the Moon around Earth) are
+ * nested the same way, the barycenter of a planet and its satellites orbits the central body
+ * and every satellite follows a Kepler orbit around its planet.
+ * @note The splitting breaks down when two bodies get close (their interaction is no longer
+ * a small perturbation). When any other pair is within a few Hill radii, or a body is about to
+ * hit the one it orbits, the step is handed to a Hermite block step integrator instead. So is a
+ * step whose Kepler solver doesn't converge.
+ */
+class WisdomHolmanIntegrator : public Integrator
+{
+public:
+    WisdomHolmanIntegrator(double encounterHillRadii = 3.0);
+
+    void Step(BodyStore& bodies, GravitySolver& solver, double delta) override;
+    void Reset() override;
+    void SaveState(std::vector<double>& state) const override;
+    bool LoadState(const std::vector<double>& state, uint32_t bodyCount) override;
+
+    inline uint64_t GetEncounterSteps() const { return m_EncounterSteps; } // steps taken by the fallback
+private:
+    static constexpr uint32_t NO_PRIMARY = UINT32_MAX;
+
+    uint32_t FindCentralBody(const BodyStore& bodies) const;
+    bool FindSatellites(const BodyStore& bodies, uint32_t central);
+    bool DetectEncounter(const BodyStore& bodies, uint32_t central, double delta);
+    void ComputeBarycenters(const std::vector<double>& masses, uint32_t central);
+    void Kick(GravitySolver& solver, double centralMu, uint32_t central, double delta);
+    void Jump(const std::vector<double>& masses, uint32_t central, double delta);
+    bool Drift(const std::vector<double>& masses, uint32_t central, double delta);
+
+    double m_EncounterHillRadii;
+    uint64_t m_EncounterSteps = 0;
+    HermiteIntegrator m_Fallback;
+
+    // heliocentric positions and barycentric velocities, central body entry stays zero
+    std::vector<glm::dvec3> m_Positions;
+    std::vector<glm::dvec3> m_Velocities;
+    std::vector<double> m_InteractionMasses;
+    std::vector<glm::dvec3> m_Accelerations;
+    bool m_AccelerationsValid = false;
+    bool m_FallbackActive = false; // last step was handed to m_Fallback
+
+    // body each satellite orbits, NO_PRIMARY for everyone orbiting the central body directly
+    std::vector<uint32_t> m_Primaries;
+    std::vector<uint32_t> m_Satellites;
+    std::vector<uint32_t> m_SatelliteCounts; // per primary
+    std::vector<double> m_HillRadii; // around the central body, or around the primary for satellites
+    // planet with its satellites, only filled in for bodies that aren't satellites
+    std::vector<double> m_SystemMasses;
+    std::vector<glm::dvec3> m_SystemPositions;
+    std::vector<glm::dvec3> m_SystemVelocities;
+};
@@ -0,0 +1,209 @@
+#include "workPrecision.h"
+#include "diagnostics.h"
+#include "ias15Integrator.h"
+#include "timer.h"
+
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+#define WORK_PRECISION_CHECK_TOLERANCE 0.1 // of the reference tolerance, the run the reference is checked against
+
+WorkPrecisionRunner::WorkPrecisionRunner(const Simulation& base, double endTime)
+    : m_BaseBodies(base.GetBodies()), m_BaseParticlePositions(base.GetParticles().GetPositions()),
+        m_BaseParticleVelocities(base.GetParticles().GetVelocities()), m_BaseTime(base.GetTime()), m_EndTime(endTime),
+        m_InitialEnergy(ComputeTotalEnergy(base.GetBodies())), m_InitialAngularMomentum(ComputeTotalAngularMomentum(base.GetBodies()))
+{
+}
+
+void WorkPrecisionRunner::RunReference(const SimulationSettings& settings, double delta)
+{
+    auto countRoundOff = [](Simulation& simulation) -> uint64_t
+    {
+        if (auto* ias15 = dynamic_cast<Ias15Integrator*>(simulation.GetCurrentIntegrator()))
+            return ias15->GetRoundOffSteps();
+        return 0;
+    };
+
+    Simulation simulation;
+    Prepare(simulation, settings);
+    Timer timer;
+    Integrate(simulation, delta, 1);
+    m_ReferenceSeconds = timer.GetSeconds();
+    m_ReferenceRoundOffSteps = countRoundOff(simulation);
+
+    const BodyStore& bodies = simulation.GetBodies();
+    m_ReferencePositions = bodies.GetPositions();
+    m_ReferenceCenter = bodies.GetCount() > 0 ? FindHeaviestBody(bodies) : 0;
+    if (m_InitialEnergy != 0.0)
+        m_ReferenceEnergyError = std::abs((ComputeTotalEnergy(bodies) - m_InitialEnergy) / m_InitialEnergy);
+
+    SimulationSettings tighter = settings;
+    tighter.tolerance = (float)(settings.tolerance * WORK_PRECISION_CHECK_TOLERANCE);
+    Simulation check;
+    Prepare(check, tighter);
+    Integrate(check, delta, 1);
+    m_CheckRoundOffSteps = countRoundOff(check);
+    double positionError = 0.0;
+    m_ReferencePositionError = ComparePositions(check.GetBodies(), positionError);
+}
+
+void WorkPrecisionRunner::Run(const std::vector<WorkPrecisionConfig>& configs, const ProgressCallback& progress)
+{
+    if (m_ReferencePositions.size() != m_BaseBodies.GetCount())
+        throw std::runtime_error("Work-precision configurations need the reference run first");
+
+    m_Results.clear();
+    for (const WorkPrecisionConfig& config : configs)
+    {
+        WorkPrecisionResult result{};
+        result.config = config;
+
+        Simulation simulation;
+        Prepare(simulation, config.settings);
+        Timer timer;
+        result.steps = Integrate(simulation, config.delta, config.stepCount);
+        result.wallSeconds = timer.GetSeconds();
+
+        const BodyStore& bodies = simulation.GetBodies();
+        if (m_InitialEnergy != 0.0)
+            result.energyError = std::abs((ComputeTotalEnergy(bodies) - m_InitialEnergy) / m_InitialEnergy);
+        double initialAngularMomentum = glm::length(m_InitialAngularMomentum);
+        if (initialAngularMomentum > 0.0)
+            result.angularMomentumError = glm::length(ComputeTotalAngularMomentum(bodies) - m_InitialAngularMomentum) / initialAngularMomentum;
+
+        result.relativePositionError = ComparePositions(bodies, result.positionError);
+        result.resolved = result.relativePositionError > m_ReferencePositionError;
+
+        m_Results.push_back(result);
+        if (progress)
+            progress(result);
+    }
+    MarkParetoFronts();
+}
+
+/**
+ * @brief Largest distance of any body from where the reference has it in km, and relative to the body's
+ * reference distance from the heaviest body as the return value
+ */
+double WorkPrecisionRunner::ComparePositions(const BodyStore& bodies, double& positionError) const
+{
+    const glm::dvec3 center = m_ReferencePositions[m_ReferenceCenter];
+    double relativeError = 0.0;
+    positionError = 0.0;
+    for (uint32_t i = 0; i < bodies.GetCount(); i++)
+    {
+        double error = glm::length(bodies.GetPositions()[i] - m_ReferencePositions[i]);
+        positionError = std::max(positionError, error);
+        double distance = glm::length(m_ReferencePositions[i] - center);
+        if (i != m_ReferenceCenter && distance > 0.0)
+            relativeError = std::max(relativeError, error / distance);
+    }
+    return relativeError;
+}
+
+void WorkPrecisionRunner::Prepare(Simulation& simulation, const SimulationSettings& settings) const
+{
+    simulation.GetBodies() = m_BaseBodies;
+    simulation.GetSettings() = settings;
+    simulation.GetSettings().collisions = false;
+    simulation.SetTime(m_BaseTime);
+    TestParticles& particles = simulation.GetParticles();
+    particles.Reserve((uint32_t)m_BaseParticlePositions.size());
+    for (size_t i = 0; i < m_BaseParticlePositions.size(); i++)
+        particles.Add(m_BaseParticlePositions[i], m_BaseParticleVelocities[i]);
+}
+
+/**
+ * @brief Same pacing as the simulation thread, the last delta is shortened to hit the end time
+ * @return steps taken
+ */
+uint64_t WorkPrecisionRunner::Integrate(Simulation& simulation, double delta, uint32_t stepCount) const
+{
+    if (simulation.GetSettings().integrator == IntegratorType::Ias15)
+        stepCount = 1;
+    stepCount = std::max(stepCount, 1u);
+
+    uint64_t steps = 0;
+    while (simulation.GetTime() < m_EndTime)
+    {
+        double substepDelta = std::min(delta, m_EndTime - simulation.GetTime()) / (double)stepCount;
+        for (uint32_t j = 0; j < stepCount; j++)
+            simulation.Step(substepDelta);
+        steps += stepCount;
+    }
+    return steps;
+}
+
+void WorkPrecisionRunner::MarkParetoFronts()
+{
+    // a result that went non-finite is dominated by everything and dominates nothing
+    auto onFront = [&](const WorkPrecisionResult& result, double WorkPrecisionResult::* error)
+    {
+        if (!std::isfinite(result.*error))
+            return false;
+        for (const WorkPrecisionResult& other : m_Results)
+        {
+            if (!std::isfinite(other.*error))
+                continue;
+            bool noWorse = other.wallSeconds <= result.wallSeconds && other.*error <= result.*error;
+            bool better = other.wallSeconds < result.wallSeconds || other.*error < result.*error;
+            if (noWorse && better)
+                return false;
+        }
+        return true;
+    };
+
+    for (WorkPrecisionResult& result : m_Results)
+    {
+        result.paretoEnergy = onFront(result, &WorkPrecisionResult::energyError);
+        result.paretoAngularMomentum = onFront(result, &WorkPrecisionResult::angularMomentumError);
+        result.paretoPosition = onFront(result, &WorkPrecisionResult::relativePositionError);
+    }
+}
+
+void WorkPrecisionRunner::WriteResults(const std::string& filepath) const
+{
+    std::ofstream file(filepath);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open work-precision file " + filepath);
+
+    file.precision(6);
+    file << "# config delta stepCount tolerance theta steps wallSeconds energyError angularMomentumError positionError"
+        " relativePositionError resolved paretoEnergy paretoAngularMomentum paretoPosition\n";
+    for (const WorkPrecisionResult& result : m_Results)
+    {
+        const WorkPrecisionConfig& config = result.config;
+        file << config.label << " " << config.delta << " " << config.stepCount << " " << config.settings.tolerance << " "
+            << config.settings.openingAngle << " " << result.steps << " " << result.wallSeconds << " " << result.energyError << " "
+            << result.angularMomentumError << " " << result.positionError << " " << result.relativePositionError << " "
+            << result.resolved << " " << result.paretoEnergy << " " << result.paretoAngularMomentum << " " << result.paretoPosition << "\n";
+    }
+
+    // cheapest first, so the first line under the accuracy budget is the configuration to pick
+    std::vector<const WorkPrecisionResult*> front;
+    for (const WorkPrecisionResult& result : m_Results)
+    {
+        if (result.paretoPosition)
+            front.push_back(&result);
+    }
+    std::sort(front.begin(), front.end(), [](const WorkPrecisionResult* a, const WorkPrecisionResult* b)
+    {
+        return a->wallSeconds < b->wallSeconds;
+    });
+
+    file << "# reference " << m_ReferenceSeconds << " s, energy error " << m_ReferenceEnergyError << ", position error "
+        << m_ReferencePositionError << " against a tenth of its tolerance, " << m_ReferenceRoundOffSteps << " and " << m_CheckRoundOffSteps
+        << " round-off limited steps\n";
+    file << "# position front\n";
+    for (const WorkPrecisionResult* result : front)
+    {
+        const WorkPrecisionConfig& config = result->config;
+        file << "# " << config.label << " delta " << config.delta << " x" << config.stepCount << " tolerance " << config.settings.tolerance
+            << " theta " << config.settings.openingAngle << ": " << result->wallSeconds << " s, " << result->relativePositionError << "\n";
+    }
+
+    if (!file.good())
+        throw std::runtime_error("Failed to write work-precision file " + filepath);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "simulation.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+/**
+ * @brief One way of integrating the scenario, delta and stepCount mean what DELTA and StepCount do in the
+ * viewer: steps of delta / stepCount. IAS15 adapts its own steps and always takes one per delta.
+ */
+struct WorkPrecisionConfig
+{
+    std::string label; // written as the first column, no spaces
+    SimulationSettings settings;
+    double delta = 300.0; // seconds
+    uint32_t stepCount = 1;
+};
+
+/**
+ * @brief Cost and error of one configuration at the end time. Energy and angular momentum are compared
+ * with the initial state, positions with the reference run.
+ */
+struct WorkPrecisionResult
+{
+    WorkPrecisionConfig config;
+    uint64_t steps = 0;
+    double wallSeconds = 0.0;
+    double energyError = 0.0; // relative, |E - E0| / |E0|
+    double angularMomentumError = 0.0; // relative, |L - L0| / |L0|
+    double positionError = 0.0; // km, farthest any body ended up from where the reference has it
+    double relativePositionError = 0.0; // largest position error over the body's reference distance from the heaviest body
+    bool resolved = false; // relative position error is above the reference's own, below that it's noise
+    // no other configuration is both faster and more accurate in that error
+    bool paretoEnergy = false;
+    bool paretoAngularMomentum = false;
+    bool paretoPosition = false;
+};
+
+/**
+ * @brief Runs one initial state with many configurations and measures what each one costs against how far
+ * it ends up from a high accuracy reference. Collisions are turned off everywhere, merges would leave
+ * nothing to compare body by body. Configurations run one after another on the calling thread, side by
+ * side they would disturb each others timings.
+ */
+class WorkPrecisionRunner
+{
+public:
+    using ProgressCallback = std::function<void(const WorkPrecisionResult&)>;
+
+    WorkPrecisionRunner(const Simulation& base, double endTime);
+
+    /**
+     * @brief Integrates the base state until the end time and keeps the result as the exact solution,
+     * IAS15 with a tolerance well below anything measured is the usual choice. Runs again at a tenth
+     * of the tolerance, how far the two ended up apart is the error of the reference itself.
+     */
+    void RunReference(const SimulationSettings& settings, double delta);
+    /**
+     * @brief Runs every configuration against the reference and marks the Pareto fronts of the results
+     * @throws std::runtime_error when the reference hasn't run yet
+     */
+    void Run(const std::vector<WorkPrecisionConfig>& configs, const ProgressCallback& progress = nullptr);
+
+    inline const std::vector<WorkPrecisionResult>& GetResults() const { return m_Results; }
+    inline double GetReferenceSeconds() const { return m_ReferenceSeconds; }
+    inline double GetReferenceEnergyError() const { return m_ReferenceEnergyError; } // errors below this aren't resolved
+    inline double GetReferencePositionError() const { return m_ReferencePositionError; } // relative, against the tighter run
+    // IAS15 steps of the reference that stayed above tolerance because round-off didn't allow less, 0 when it converged
+    inline uint64_t GetReferenceRoundOffSteps() const { return m_ReferenceRoundOffSteps; }
+    // same for the tighter run, the position error is then only resolved down to round-off
+    inline uint64_t GetCheckRoundOffSteps() const { return m_CheckRoundOffSteps; }
+
+    /**
+     * @brief One line per configuration followed by the position error front sorted by wall time
+     * @throws std::runtime_error when the file can't be written
+     */
+    void WriteResults(const std::string& filepath) const;
+private:
+    void Prepare(Simulation& simulation, const SimulationSettings& settings) const;
+    uint64_t Integrate(Simulation& simulation, double delta, uint32_t stepCount) const;
+    double ComparePositions(const BodyStore& bodies, double& positionError) const;
+    void MarkParetoFronts();
+
+    BodyStore m_BaseBodies;
+    std::vector<glm::dvec3> m_BaseParticlePositions;
+    std::vector<glm::dvec3> m_BaseParticleVelocities;
+    double m_BaseTime;
+    double m_EndTime;
+    double m_InitialEnergy;
+    glm::dvec3 m_InitialAngularMomentum;
+
+    std::vector<glm::dvec3> m_ReferencePositions; // empty until the reference ran
+    uint32_t m_ReferenceCenter = 0;
+    double m_ReferenceSeconds = 0.0;
+    double m_ReferenceEnergyError = 0.0;
+    double m_ReferencePositionError = 0.0;
+    uint64_t m_ReferenceRoundOffSteps = 0;
+    uint64_t m_CheckRoundOffSteps = 0;
+
+    std::vector<WorkPrecisionResult> m_Results;
+};
@@ -232,12 +232,20 @@ void Renderer::RenderOrbits(FrameInfo& frameInfo, Object* obj)
 
 void Renderer::RenderGameObjects(FrameInfo& frameInfo)
 {
-    for (auto& kv: frameInfo.gameObjects)
+    const BodyStore& bodies = *frameInfo.bodies;
+    auto& positions = bodies.GetPositions();
+    auto& rotations = bodies.GetRotations();
+    auto& radii = bodies.GetRadii();
+    for (uint32_t i = 0; i < bodies.GetCount(); i++)
     {
-        auto& obj = kv.second;
-        auto offset = ((frameInfo.camera->m_Transform.translation*SCALE_DOWN)+frameInfo.offset) - (obj->GetObjectTransform().translation);
+        auto iter = frameInfo.gameObjects->find(bodies.GetHandle(i).index);
+        if (iter == frameInfo.gameObjects->end())
+            continue;
+
+        auto& obj = iter->second;
+        auto offset = ((frameInfo.camera->m_Transform.translation*SCALE_DOWN)+frameInfo.offset) - positions[i];
         double distance = std::sqrt(glm::dot(offset, offset));
-        if (distance < obj->GetObjectProperties().radius*(SCALE_DOWN/1000000))
+        if (distance < radii[i]*(SCALE_DOWN/1000000))
         {
             vkCmdBindDescriptorSets(
                 frameInfo.commandBuffer,
@@ -255,8 +263,13 @@ void Renderer::RenderGameObjects(FrameInfo& frameInfo)
             if (obj->GetObjectType() == OBJ_TYPE_STAR)
                 m_StarsPipeline->Bind(frameInfo.commandBuffer);
 
+            Transform transform{};
+            transform.translation = positions[i];
+            transform.rotation = rotations[i];
+            transform.scale = glm::dvec3{1.0, 1.0, 1.0} * radii[i];
+
             PushConstants push{};
-            push.modelMatrix = obj->GetObjectTransform().mat4();
+            push.modelMatrix = transform.mat4();
             push.offset = frameInfo.offset/SCALE_DOWN;
 
             vkCmdPushConstants(frameInfo.commandBuffer, m_DefaultPipelineLayout, 
@@ -266,7 +279,7 @@ void Renderer::RenderGameObjects(FrameInfo& frameInfo)
         else
         {
             RenderOrbits(frameInfo, obj.get());
-            RenderBillboards(frameInfo, (obj->GetObjectTransform().translation)/SCALE_DOWN, distance*2/(SCALE_DOWN*100), obj->GetObjectColor());
+            RenderBillboards(frameInfo, positions[i]/SCALE_DOWN, distance*2/(SCALE_DOWN*100), obj->GetObjectColor());
         }
     }
 }
@@ -298,6 +311,66 @@ void Renderer::RenderBillboards(FrameInfo& frameInfo, glm::vec3 position, float
     vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
 }
 
+/**
+ * @brief Draws every test particle as a line from its position back along its velocity. Vertices are
+ * rewritten every frame into a host visible buffer owned by the frame in flight.
+ */
+void Renderer::RenderParticles(FrameInfo& frameInfo, const std::vector<glm::dvec3>& positions, 
+    const std::vector<glm::dvec3>& velocities, glm::vec3 color)
+{
+    uint32_t count = (uint32_t)positions.size();
+    if (count == 0)
+        return;
+
+    m_ParticleVertices.resize(count * 2);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_ParticleVertices[i * 2].position = positions[i] / SCALE_DOWN;
+        m_ParticleVertices[i * 2 + 1].position = (positions[i] - velocities[i] * PARTICLE_STREAK_TIME) / SCALE_DOWN;
+    }
+
+    m_ParticleBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    auto& buffer = m_ParticleBuffers[m_CurrentFrameIndex];
+    if (!buffer || buffer->GetInstanceCount() < count * 2)
+    {
+        // grow with some headroom so a slowly filling belt doesn't reallocate every frame
+        buffer = std::make_unique<Buffer>(
+            m_Device,
+            sizeof(CustomModelPosOnly::Vertex),
+            count * 2 + count / 2,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        buffer->Map();
+    }
+    buffer->WriteToBuffer(m_ParticleVertices.data(), m_ParticleVertices.size() * sizeof(CustomModelPosOnly::Vertex));
+
+    vkCmdBindDescriptorSets(
+        frameInfo.commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        m_OrbitsPipelineLayout,
+        0,
+        1,
+        &frameInfo.globalDescriptorSet,
+        0,
+        nullptr
+    );
+
+    m_ParticlesPipeline->Bind(frameInfo.commandBuffer);
+
+    OrbitPushConstants push{};
+    push.offset = frameInfo.offset/SCALE_DOWN;
+    push.color = color;
+
+    vkCmdPushConstants(frameInfo.commandBuffer, m_OrbitsPipelineLayout, 
+        VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(OrbitPushConstants), &push);
+
+    VkBuffer buffers[] = {buffer->GetBuffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, buffers, offsets);
+    vkCmdDraw(frameInfo.commandBuffer, count * 2, 1, 0, 0);
+}
+
 void Renderer::RenderSkybox(FrameInfo& frameInfo, Skybox& skybox, VkDescriptorSet skyboxDescriptorSet)
 {
     m_SkyboxPipeline->Bind(frameInfo.commandBuffer);
@@ -463,6 +536,24 @@ void Renderer::CreatePipelines()
         );
     }
 
+    //
+    // PARTICLES
+    //
+    {
+        auto pipelineConfig = Pipeline::CreatePipelineConfigInfo(m_ViewportSize.x, m_ViewportSize.y,
+            VK_PRIMITIVE_TOPOLOGY_LINE_LIST,
+            VK_CULL_MODE_NONE, false, false
+        );
+        pipelineConfig.renderPass = m_Swapchain->GetGeometryRenderPass();
+        pipelineConfig.pipelineLayout = m_OrbitsPipelineLayout;
+        m_ParticlesPipeline = std::make_unique<Pipeline>(m_Device);
+        m_ParticlesPipeline->CreatePipeline("../shaders/spv/orbits.vert.spv", "../shaders/spv/orbits.frag.spv",
+            pipelineConfig,
+            CustomModelPosOnly::Vertex::GetBindingDescriptions(),
+            CustomModelPosOnly::Vertex::GetAttributeDescriptions()
+        );
+    }
+
     //
     // SKYBOX
     //
@@ -13,6 +13,8 @@
 #include <cassert>
 #include <iostream>
 
+#define PARTICLE_STREAK_TIME 86400.0 // seconds of motion each test particle streak covers
+
 struct PushConstants
 {
     glm::mat4 modelMatrix{1.0f};
@@ -77,6 +79,8 @@ public:
     void RenderOrbits(FrameInfo& frameInfo, Object* obj);
     void RenderSkybox(FrameInfo& frameInfo, Skybox& skybox, VkDescriptorSet skyboxDescriptorSet);
     void RenderBillboards(FrameInfo& frameInfo, glm::vec3 position, float size, glm::vec3 color);
+    void RenderParticles(FrameInfo& frameInfo, const std::vector<glm::dvec3>& positions, 
+        const std::vector<glm::dvec3>& velocities, glm::vec3 color);
 private:
     void CreateCommandBuffers();
     void FreeCommandBuffers();
@@ -106,6 +110,11 @@ private:
     std::unique_ptr<Pipeline> m_OrbitsPipeline;
     VkPipelineLayout m_OrbitsPipelineLayout;
 
+    // test particles share orbits layout and shaders, drawn as short streaks along velocity
+    std::unique_ptr<Pipeline> m_ParticlesPipeline;
+    std::vector<std::unique_ptr<Buffer>> m_ParticleBuffers;
+    std::vector<CustomModelPosOnly::Vertex> m_ParticleVertices;
+
     std::unique_ptr<Pipeline> m_SkyboxPipeline;
     VkPipelineLayout m_SkyboxPipelineLayout;
 